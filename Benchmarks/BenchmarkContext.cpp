@@ -0,0 +1,36 @@
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "BenchmarkContext.h"
+
+namespace Benchmarks {
+
+namespace {
+
+// buffers and shaders log at info level, keep that out of the results
+const bool kQuietLogging = [] {
+  spdlog::set_level(spdlog::level::warn);
+  return true;
+}();
+
+}  // namespace
+
+std::shared_ptr<Peridot::Context> GetHeadlessContext() {
+  static std::shared_ptr<Peridot::Context> context = [] {
+    Peridot::ContextSpecification spec;
+    spec.width = 256;
+    spec.height = 256;
+    spec.title = "PeridotBenchmarks";
+    spec.vsync = Peridot::VSync::Off;
+    spec.visible = false;
+    return Peridot::Context::Create(spec);
+  }();
+  return context;
+}
+
+std::string AssetPath(const char* fileName) {
+  return std::string(PERIDOT_BENCHMARK_DIR) + "/" + fileName;
+}
+
+}  // namespace Benchmarks
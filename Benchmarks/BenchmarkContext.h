@@ -0,0 +1,17 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <Peridot/Core.h>
+
+namespace Benchmarks {
+
+// One hidden window shared by every benchmark that needs GL. Returns nullptr
+// when no context could be created, callers skip in that case.
+std::shared_ptr<Peridot::Context> GetHeadlessContext();
+
+// Absolute path of a file copied next to the benchmark binary.
+std::string AssetPath(const char* fileName);
+
+}  // namespace Benchmarks
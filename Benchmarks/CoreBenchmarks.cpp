@@ -0,0 +1,210 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+
+#include <Peridot/Buffer.h>
+#include <Peridot/Camera.h>
+#include <Peridot/Components.h>
+#include <Peridot/Ecs.h>
+#include <Peridot/FrameAllocator.h>
+#include <Peridot/Frustum.h>
+#include <Peridot/ThreadPool.h>
+#include <Peridot/TransformHierarchy.h>
+#include <Peridot/Utils.h>
+#include <Peridot/VertexLayout.h>
+
+#include "BenchmarkContext.h"
+
+static void BM_BufferLayoutConstruction(benchmark::State& state) {
+  for (auto _ : state) {
+    Peridot::BufferLayout layout = {{Peridot::Utils::Type::Vec3, "aPos"},
+                                    {Peridot::Utils::Type::Vec3, "aNormal"},
+                                    {Peridot::Utils::Type::Vec2, "aUV"},
+                                    {Peridot::Utils::Type::Vec4, "aColor"}};
+    benchmark::DoNotOptimize(layout.stride);
+  }
+}
+BENCHMARK(BM_BufferLayoutConstruction);
+
+struct BenchmarkVertex {
+  glm::vec3 position;
+  Peridot::Normalized<glm::i8vec4> normal;
+  Peridot::Half2 uv;
+  Peridot::Normalized<glm::u8vec4> color;
+};
+PERIDOT_VERTEX(BenchmarkVertex, position, normal, uv, color);
+
+// same layout, described at compile time and built once
+static void BM_VertexLayoutLookup(benchmark::State& state) {
+  for (auto _ : state) {
+    const auto& layout = Peridot::VertexLayout<BenchmarkVertex>();
+    benchmark::DoNotOptimize(layout.stride);
+  }
+}
+BENCHMARK(BM_VertexLayoutLookup);
+
+static void BM_CameraRecalculateViewMatrix(benchmark::State& state) {
+  Peridot::Camera camera(Peridot::Camera::Perspective, glm::radians(45.0f),
+                         16.0f / 9.0f, 0.1f, 100.0f);
+  float angle = 0.0f;
+  for (auto _ : state) {
+    angle += 0.001f;
+    camera.SetRotation({angle, angle * 0.5f, 0.0f});
+    auto view = camera.GetViewMatrix();
+    benchmark::DoNotOptimize(view);
+  }
+}
+BENCHMARK(BM_CameraRecalculateViewMatrix);
+
+static void BM_CameraGetViewMatrix(benchmark::State& state) {
+  // cached, so this measures the steady state of an unmoving camera
+  Peridot::Camera camera(Peridot::Camera::Perspective, glm::radians(45.0f),
+                         16.0f / 9.0f, 0.1f, 100.0f);
+  camera.SetPosition({1.0f, 2.0f, 3.0f});
+  camera.SetRotation({0.1f, 0.2f, 0.3f});
+  for (auto _ : state) {
+    auto view = camera.GetViewMatrix();
+    benchmark::DoNotOptimize(view);
+  }
+}
+BENCHMARK(BM_CameraGetViewMatrix);
+
+static void BM_CameraViewProjection(benchmark::State& state) {
+  Peridot::Camera camera(Peridot::Camera::Perspective, glm::radians(45.0f),
+                         16.0f / 9.0f, 0.1f, 100.0f);
+  camera.SetPosition({1.0f, 2.0f, 3.0f});
+  for (auto _ : state) {
+    const auto& viewProjection = camera.GetViewProjectionMatrix();
+    benchmark::DoNotOptimize(viewProjection);
+  }
+}
+BENCHMARK(BM_CameraViewProjection);
+
+static void BM_ReadFileIntoStringBuffer(benchmark::State& state) {
+  auto filePath = Benchmarks::AssetPath("read_file_benchmark.bin");
+  {
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    std::string contents(static_cast<size_t>(state.range(0)), 'x');
+    file.write(contents.data(), contents.size());
+  }
+
+  for (auto _ : state) {
+    auto buffer = Peridot::Utils::ReadFileIntoStringBuffer(filePath.c_str());
+    benchmark::DoNotOptimize(buffer.data());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+  std::remove(filePath.c_str());
+}
+BENCHMARK(BM_ReadFileIntoStringBuffer)->RangeMultiplier(16)->Range(4 << 10, 16 << 20);
+
+// a short lived vector per "frame", from the heap and from the frame arena
+static void BM_TransientVectorHeap(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    std::vector<uint32_t> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      items.push_back(static_cast<uint32_t>(i));
+    }
+    benchmark::DoNotOptimize(items.data());
+  }
+}
+BENCHMARK(BM_TransientVectorHeap)->Arg(64)->Arg(4096);
+
+static void BM_TransientVectorFrameArena(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    Peridot::ArenaScope scope;
+    Peridot::FrameVector<uint32_t> items;
+    items.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      items.push_back(static_cast<uint32_t>(i));
+    }
+    benchmark::DoNotOptimize(items.data());
+  }
+}
+BENCHMARK(BM_TransientVectorFrameArena)->Arg(64)->Arg(4096);
+
+
+// a loop per batch of an outer loop, the nested ones run inline on
+// whichever thread picked up the batch, the caller included
+static void BM_ThreadPoolNestedParallelFor(benchmark::State& state) {
+  const auto count = static_cast<size_t>(state.range(0));
+  auto& pool = Peridot::ThreadPool::Get();
+  for (auto _ : state) {
+    std::atomic<size_t> total{0};
+    pool.ParallelFor(count, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        pool.ParallelFor(count, 16, [&](size_t innerBegin, size_t innerEnd) {
+          total.fetch_add(innerEnd - innerBegin);
+        });
+      }
+    });
+    benchmark::DoNotOptimize(total.load());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(0));
+}
+BENCHMARK(BM_ThreadPoolNestedParallelFor)->Arg(64)->Arg(1024);
+
+// one moving root with a static child per entity, every copy is needed
+static void BM_UpdateWorldTransforms(benchmark::State& state) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto root = hierarchy.Create();
+  for (int64_t i = 0; i < state.range(0); i++) {
+    auto node = hierarchy.Create(root);
+    hierarchy.SetPosition(node, glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+    world.Create(Peridot::TransformComponent{node});
+  }
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  float x = 0.0f;
+  for (auto _ : state) {
+    x += 1.0f;
+    hierarchy.SetPosition(root, glm::vec3(x, 0.0f, 0.0f));
+    Peridot::UpdateWorldTransforms(world, hierarchy);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateWorldTransforms)->Arg(1000)->Arg(100000);
+
+static void BM_FrustumCullAABBs(benchmark::State& state) {
+  Peridot::Camera camera(Peridot::Camera::Perspective, glm::radians(45.0f),
+                         16.0f / 9.0f, 0.1f, 500.0f);
+  auto frustum = Peridot::Frustum::FromCamera(camera);
+
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+  std::uniform_real_distribution<float> size(0.5f, 4.0f);
+  Peridot::AABBSoA boxes;
+  boxes.Reserve(static_cast<size_t>(state.range(0)));
+  for (int64_t i = 0; i < state.range(0); i++) {
+    glm::vec3 center(position(random), position(random), position(random));
+    glm::vec3 extents(size(random));
+    boxes.Add({center - extents, center + extents});
+  }
+
+  std::vector<uint32_t> visible;
+  visible.reserve(boxes.Size());
+  auto threads = static_cast<uint32_t>(state.range(1));
+  for (auto _ : state) {
+    visible.clear();
+    if (threads == 1) {
+      Peridot::CullAABBs(frustum, boxes, visible);
+    } else {
+      Peridot::CullAABBsParallel(frustum, boxes, visible, threads);
+    }
+    benchmark::DoNotOptimize(visible.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_FrustumCullAABBs)
+    ->Args({200000, 1})
+    ->Args({200000, 4})
+    ->Args({200000, 0});
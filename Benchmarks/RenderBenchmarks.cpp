@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <Peridot/Core.h>
+#include <Peridot/Input.h>
+
+#include "BenchmarkContext.h"
+
+namespace {
+
+struct CubeScene {
+  std::shared_ptr<Peridot::Shader> shader;
+  std::shared_ptr<Peridot::VertexArray> vertexArray;
+  size_t indexCount = 0;
+};
+
+// Built once and kept for the lifetime of the process, alongside the context.
+const CubeScene* GetCubeScene() {
+  static std::unique_ptr<CubeScene> scene = []() -> std::unique_ptr<CubeScene> {
+    if (!Benchmarks::GetHeadlessContext()) {
+      return nullptr;
+    }
+    auto vertexPath = Benchmarks::AssetPath("benchmark.vert");
+    auto fragmentPath = Benchmarks::AssetPath("benchmark.frag");
+    auto shader = Peridot::Shader::Create(
+        {{Peridot::ShaderType::VertexShader, vertexPath.c_str()},
+         {Peridot::ShaderType::FragmentShader, fragmentPath.c_str()}});
+    if (!shader) {
+      return nullptr;
+    }
+
+    std::vector<float> vertices = {
+        0.5f, 0.5f,  0.5f,  -0.5f, 0.5f,  0.5f, -0.5f, -0.5f,
+        0.5f, 0.5f,  -0.5f, 0.5f,  0.5f,  0.5f, -0.5f, -0.5f,
+        0.5f, -0.5f, -0.5f, -0.5f, -0.5f, 0.5f, -0.5f, -0.5f,
+    };
+    std::vector<uint32_t> indices = {0, 1, 2, 0, 3, 2, 4, 5, 6, 4, 7, 6,
+                                     0, 4, 5, 0, 1, 5, 3, 7, 6, 3, 2, 6,
+                                     0, 4, 7, 0, 3, 7, 1, 5, 6, 1, 2, 6};
+
+    auto vertexBuffer = Peridot::VertexBuffer::Create(
+        vertices.data(), vertices.size() * sizeof(float));
+    vertexBuffer->SetBufferLayout({{Peridot::Utils::Type::Vec3, "aPos"}});
+    auto elementBuffer = Peridot::ElementBuffer::Create(
+        indices.data(), indices.size() * sizeof(uint32_t));
+
+    auto result = std::make_unique<CubeScene>();
+    result->shader = shader;
+    result->vertexArray = Peridot::VertexArray::Create();
+    result->vertexArray->AddVertexBuffer(vertexBuffer);
+    result->vertexArray->SetElementBuffer(elementBuffer);
+    result->indexCount = indices.size();
+    return result;
+  }();
+  return scene.get();
+}
+
+}  // namespace
+
+static void BM_SetUniformMat4(benchmark::State& state) {
+  auto scene = GetCubeScene();
+  if (!scene) {
+    state.SkipWithError("no GL context");
+    return;
+  }
+  scene->shader->Bind();
+  glm::mat4 matrix(1.0f);
+  for (auto _ : state) {
+    matrix[3][0] += 0.001f;
+    scene->shader->SetUniform<glm::mat4>("uMVP", matrix);
+  }
+}
+BENCHMARK(BM_SetUniformMat4);
+
+static void BM_SetUniformVec3(benchmark::State& state) {
+  auto scene = GetCubeScene();
+  if (!scene) {
+    state.SkipWithError("no GL context");
+    return;
+  }
+  scene->shader->Bind();
+  glm::vec3 offset(0.0f);
+  for (auto _ : state) {
+    offset.x += 0.001f;
+    scene->shader->SetUniform<glm::vec3>("uOffset", offset);
+  }
+}
+BENCHMARK(BM_SetUniformVec3);
+
+static void BM_InputPollAndInvokeCallbacks(benchmark::State& state) {
+  auto context = Benchmarks::GetHeadlessContext();
+  if (!context) {
+    state.SkipWithError("no GL context");
+    return;
+  }
+  Peridot::PollModeInput input(context);
+  uint64_t invocations = 0;
+  auto keyCount = static_cast<int32_t>(state.range(0));
+  for (int32_t i = 0; i < keyCount; i++) {
+    input.RegisterKeyCallback(
+        static_cast<Peridot::KeyCode>(static_cast<int32_t>(Peridot::KeyCode::A) + i),
+        [&invocations](Peridot::ButtonState) { invocations += 1; });
+  }
+  input.RegisterCursorCallback(
+      [&invocations](double, double, double, double) { invocations += 1; });
+
+  for (auto _ : state) {
+    input.PollAndInvokeCallbacks();
+  }
+  benchmark::DoNotOptimize(invocations);
+}
+BENCHMARK(BM_InputPollAndInvokeCallbacks)->Arg(1)->Arg(8)->Arg(26);
+
+static void BM_DrawSubmission(benchmark::State& state) {
+  auto scene = GetCubeScene();
+  if (!scene) {
+    state.SkipWithError("no GL context");
+    return;
+  }
+  auto drawCount = state.range(0);
+  glm::mat4 viewProjection(1.0f);
+
+  for (auto _ : state) {
+    scene->shader->Bind();
+    scene->vertexArray->Bind();
+    for (int64_t i = 0; i < drawCount; i++) {
+      scene->shader->SetUniform<glm::vec3>(
+          "uOffset", glm::vec3(static_cast<float>(i) * 0.001f, 0.0f, 0.0f));
+      scene->shader->SetUniform<glm::mat4>("uMVP", viewProjection);
+      Peridot::RenderCall::DrawElements(scene->indexCount);
+    }
+    // keep the driver queue from growing without bound, outside the timing
+    state.PauseTiming();
+    glFinish();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * drawCount);
+}
+BENCHMARK(BM_DrawSubmission)->Arg(100)->Arg(1000)->Arg(10000);
@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 uColor;
+
+void main()
+{
+	uColor = vec4(1.0f);
+}
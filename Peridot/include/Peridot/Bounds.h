@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace Peridot {
+
+struct AABB {
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+
+  glm::vec3 Center() const { return (min + max) * 0.5f; }
+  glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+  float SurfaceArea() const {
+    glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+
+  bool Contains(const AABB& other) const {
+    return min.x <= other.min.x && min.y <= other.min.y &&
+           min.z <= other.min.z && max.x >= other.max.x &&
+           max.y >= other.max.y && max.z >= other.max.z;
+  }
+
+  bool Overlaps(const AABB& other) const {
+    return min.x <= other.max.x && max.x >= other.min.x &&
+           min.y <= other.max.y && max.y >= other.min.y &&
+           min.z <= other.max.z && max.z >= other.min.z;
+  }
+
+  static AABB Union(const AABB& a, const AABB& b) {
+    return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+  }
+
+  // bounds of the box after an affine transform, by projecting the extents
+  // onto the absolute rotation-scale axes
+  AABB Transformed(const glm::mat4& transform) const {
+    glm::vec3 center = glm::vec3(transform * glm::vec4(Center(), 1.0f));
+    glm::vec3 extents = Extents();
+    glm::vec3 newExtents(0.0f);
+    for (int axis = 0; axis < 3; axis++) {
+      newExtents += glm::abs(glm::vec3(transform[axis])) * extents[axis];
+    }
+    return {center - newExtents, center + newExtents};
+  }
+};
+
+struct BoundingSphere {
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+};
+
+struct Ray {
+  glm::vec3 origin = glm::vec3(0.0f);
+  // expected to be normalized, distances along the ray are then in world units
+  glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f);
+
+  glm::vec3 At(const float distance) const {
+    return origin + direction * distance;
+  }
+};
+
+}  // namespace Peridot
@@ -9,18 +9,31 @@
 namespace Peridot {
 
 struct BufferElement {
-  BufferElement(const Utils::Type elementType_, const char* name_);
+  BufferElement(const Utils::Type elementType_, const char* name_,
+                const bool normalized_ = false);
   Utils::Type elementType = Utils::Type::None;
   const char* name = nullptr;
   size_t sizeInBytes = 0;
   size_t offset = 0;
+  // integer data is mapped to [0, 1] (unsigned) or [-1, 1] (signed)
+  bool normalized = false;
 };
 
+// Built at runtime from a list, or at compile time from a vertex struct
+// with PERIDOT_VERTEX and VertexLayout<T>().
 struct BufferLayout {
   BufferLayout() = default;
   BufferLayout(const std::initializer_list<BufferElement>& layout_);
   std::vector<BufferElement> layout;
   size_t stride = 0;
+
+  // Compare and hash what the GL attribute setup depends on: stride, and
+  // type, offset and normalization per element. Names are ignored.
+  bool operator==(const BufferLayout& other) const;
+  bool operator!=(const BufferLayout& other) const {
+    return !(*this == other);
+  }
+  size_t Hash() const;
 };
 
 class VertexBuffer {
@@ -35,22 +48,69 @@ class VertexBuffer {
   }
   const BufferLayout& GetBufferLayout() const { return mBufferLayout; }
   void Unbind() const;
+  uint32_t GetRendererId() const { return mRendererId; }
 
  private:
   BufferLayout mBufferLayout;
   uint32_t mRendererId = 0;
 };
 
+enum class BufferTarget {
+  ShaderStorage,
+  Uniform,
+  DrawIndirect,
+  Parameter,
+  CopyRead,
+  CopyWrite
+};
+
+// General purpose GPU buffer for data the shaders read and write directly:
+// SSBOs, indirect draw commands, draw counts.
+class StorageBuffer {
+ public:
+  static std::shared_ptr<StorageBuffer> Create(const void* data,
+                                               const size_t sizeInBytes);
+  StorageBuffer() = default;
+  ~StorageBuffer();
+  void SetData(const void* data, const size_t sizeInBytes,
+               const size_t offset = 0);
+  // reallocates the store, previous contents are lost
+  void Resize(const size_t sizeInBytes);
+  // GPU side copy from source, the ranges may not overlap when source is
+  // this buffer
+  void CopyData(const StorageBuffer& source, const size_t readOffset,
+                const size_t writeOffset, const size_t sizeInBytes);
+  void Bind(const BufferTarget target) const;
+  // indexed binding point, only valid for ShaderStorage and Uniform
+  void BindBase(const BufferTarget target, const uint32_t index) const;
+  void Unbind(const BufferTarget target) const;
+  size_t GetSize() const { return mSizeInBytes; }
+  uint32_t GetRendererId() const { return mRendererId; }
+
+ private:
+  size_t mSizeInBytes = 0;
+  uint32_t mRendererId = 0;
+};
+
 class ElementBuffer {
  public:
   static std::shared_ptr<ElementBuffer> Create(const uint32_t* indices,
                                                const size_t sizeInBytes);
+  static std::shared_ptr<ElementBuffer> Create(const uint16_t* indices,
+                                               const size_t sizeInBytes);
+  static std::shared_ptr<ElementBuffer> Create(const uint8_t* indices,
+                                               const size_t sizeInBytes);
+  static std::shared_ptr<ElementBuffer> Create(
+      const void* indices, const size_t sizeInBytes,
+      const Utils::IndexType indexType);
   ElementBuffer() = default;
   ~ElementBuffer();
   void Bind() const;
   void Unbind() const;
+  Utils::IndexType GetIndexType() const { return mIndexType; }
 
  private:
+  Utils::IndexType mIndexType = Utils::IndexType::UInt32;
   uint32_t mRendererId = 0;
 };
 
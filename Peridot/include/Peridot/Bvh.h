@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "Peridot/Bounds.h"
+#include "Peridot/Frustum.h"
+
+namespace Peridot {
+
+// Dynamic bounding volume hierarchy over object bounds. Each object is a
+// leaf identified by the proxy id returned on insertion, which stays valid
+// until the object is removed. Trees can be bulk built with a binned SAH
+// split, grown incrementally, and refit in place when objects move.
+class Bvh {
+ public:
+  static constexpr uint32_t kNullNode = std::numeric_limits<uint32_t>::max();
+
+  struct RayHit {
+    uint32_t userData = 0;
+    float distance = std::numeric_limits<float>::max();
+    bool hit = false;
+  };
+
+  // Exact intersection for a leaf, returns the hit distance or a negative
+  // value on a miss. Without one, rays hit leaf bounds.
+  using RayIntersector = std::function<float(uint32_t userData, const Ray& ray)>;
+
+  Bvh() = default;
+
+  // Replaces the contents with one leaf per entry, proxy ids are returned in
+  // input order.
+  std::vector<uint32_t> Build(const std::vector<AABB>& bounds,
+                              const std::vector<uint32_t>& userData);
+  void Clear();
+
+  uint32_t Insert(const AABB& bounds, const uint32_t userData);
+  void Remove(const uint32_t proxy);
+  // Changes a leaf's bounds and refits its ancestors, the topology is kept.
+  // Objects that moved far degrade the tree, reinserting them fixes that.
+  void Update(const uint32_t proxy, const AABB& bounds);
+  // Changes a leaf's bounds without touching its ancestors, call Refit once
+  // after moving many of them.
+  void SetBounds(const uint32_t proxy, const AABB& bounds) {
+    mNodes[proxy].bounds = bounds;
+  }
+  // Recomputes every internal node from its children after many updates
+  // made through SetBounds.
+  void Refit();
+
+  const AABB& GetBounds(const uint32_t proxy) const {
+    return mNodes[proxy].bounds;
+  }
+  uint32_t GetUserData(const uint32_t proxy) const {
+    return mNodes[proxy].userData;
+  }
+  size_t GetLeafCount() const { return mLeafCount; }
+  // sum of internal node surface areas relative to the root, lower is better
+  float ComputeCost() const;
+
+  void QueryFrustum(const Frustum& frustum,
+                    std::vector<uint32_t>& userDataOut) const;
+  void QueryAABB(const AABB& box, std::vector<uint32_t>& userDataOut) const;
+  void QuerySphere(const BoundingSphere& sphere,
+                   std::vector<uint32_t>& userDataOut) const;
+  RayHit Raycast(const Ray& ray,
+                 const float maxDistance = std::numeric_limits<float>::max(),
+                 const RayIntersector& intersector = nullptr) const;
+
+ private:
+  struct Node {
+    AABB bounds;
+    uint32_t parent = kNullNode;
+    uint32_t left = kNullNode;
+    uint32_t right = kNullNode;
+    uint32_t userData = 0;
+    bool IsLeaf() const { return left == kNullNode; }
+  };
+
+  uint32_t AllocateNode();
+  void FreeNode(const uint32_t node);
+  void InsertLeaf(const uint32_t leaf);
+  void RemoveLeaf(const uint32_t leaf);
+  uint32_t FindBestSibling(const AABB& bounds) const;
+  void RefitAncestors(uint32_t node);
+  uint32_t BuildRange(std::vector<uint32_t>& leaves, const size_t begin,
+                      const size_t end);
+  void CollectLeaves(const uint32_t node,
+                     std::vector<uint32_t>& userDataOut) const;
+
+  std::vector<Node> mNodes;
+  uint32_t mRoot = kNullNode;
+  uint32_t mFreeList = kNullNode;
+  size_t mLeafCount = 0;
+};
+
+}  // namespace Peridot
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <type_traits>
 
@@ -7,6 +8,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Peridot/Bounds.h"
+
 namespace Peridot {
 
 class Camera {
@@ -36,20 +39,70 @@ class Camera {
   float GetFarClippingPlane() const { return mFarPlane; }
   glm::vec3 GetPosition() const { return mPosition; }
   glm::vec3 GetRotation() const { return mRotation; }
-  glm::mat4 GetTransform() const { return mTransform; }
-  glm::mat4 GetRotationMatrix() const {
-    auto inverseTranslation = glm::translate(glm::mat4(1.0f), -mPosition);
-    return inverseTranslation * mTransform;
+
+  // Matrices are cached and rebuilt on first access after the state they
+  // depend on changes, so moving a camera several times per frame only pays
+  // for one rebuild.
+  const glm::mat4& GetTransform() const {
+    UpdateViewMatrix();
+    return mTransform;
+  }
+  const glm::mat4& GetRotationMatrix() const {
+    UpdateViewMatrix();
+    return mRotationMatrix;
+  }
+  const glm::mat4& GetViewMatrix() const {
+    UpdateViewMatrix();
+    return mViewMatrix;
+  }
+  const glm::mat4& GetProjectionMatrix() const {
+    UpdateProjectionMatrix();
+    return mProjMatrix;
+  }
+  const glm::mat4& GetInverseProjectionMatrix() const {
+    UpdateProjectionMatrix();
+    return mInverseProjMatrix;
+  }
+  const glm::mat4& GetViewProjectionMatrix() const {
+    UpdateViewProjectionMatrix();
+    return mViewProjMatrix;
+  }
+  const glm::mat4& GetInverseViewProjectionMatrix() const {
+    UpdateViewProjectionMatrix();
+    return mInverseViewProjMatrix;
+  }
+
+  // World space ray through a point in window coordinates (origin top left,
+  // as reported by PollModeInput), starting on the near plane.
+  Ray ScreenPointToRay(const double x, const double y, const float width,
+                       const float height) const {
+    const auto& inverseViewProj = GetInverseViewProjectionMatrix();
+    float ndcX = static_cast<float>(2.0 * x / width - 1.0);
+    float ndcY = static_cast<float>(1.0 - 2.0 * y / height);
+    glm::vec4 nearPoint = inverseViewProj * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverseViewProj * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 target = glm::vec3(farPoint) / farPoint.w;
+    return {origin, glm::normalize(target - origin)};
+  }
+
+  // Pixels one world unit covers at the given view distance, for a viewport
+  // viewportHeight pixels tall. Orthographic cameras ignore the distance.
+  float GetPixelsPerUnit(const float distance,
+                         const float viewportHeight) const {
+    float pixels = GetProjectionMatrix()[1][1] * viewportHeight * 0.5f;
+    if (mProjection == Perspective) {
+      pixels /= std::max(distance, std::max(0.1f, mNearPlane));
+    }
+    return pixels;
   }
-  glm::mat4 GetViewMatrix() const { return glm::inverse(mTransform); }
-  glm::mat4 GetProjectionMatrix() const { return mProjMatrix; }
 
   void SetZoomOrPov(const float zoomOrFov) {
     if (glm::abs(mZoomOrFov - zoomOrFov) < glm::epsilon<float>()) {
       return;
     }
     mZoomOrFov = zoomOrFov;
-    RecalculateProjectionMatrix();
+    mProjectionDirty = true;
   }
 
   void SetAspectRatio(const float aspectRatio) {
@@ -57,7 +110,7 @@ class Camera {
       return;
     }
     mAspectRatio = aspectRatio;
-    RecalculateProjectionMatrix();
+    mProjectionDirty = true;
   }
 
   void SetNearClippingPlane(const float nearPlane) {
@@ -65,7 +118,7 @@ class Camera {
       return;
     }
     mNearPlane = nearPlane;
-    RecalculateProjectionMatrix();
+    mProjectionDirty = true;
   }
 
   void SetFarClippingPlane(const float farPlane) {
@@ -73,20 +126,20 @@ class Camera {
       return;
     }
     mFarPlane = farPlane;
-    RecalculateProjectionMatrix();
+    mProjectionDirty = true;
   }
 
   void SetPosition(const glm::vec3& position) {
     mPosition = position;
-    RecalculateViewMatrix();
+    mViewDirty = true;
   }
 
   void SetRotation(const glm::vec3& rotation) {
     mRotation = rotation;
-    RecalculateViewMatrix();
+    mViewDirty = true;
   }
 
-  void RecalculateProjectionMatrix() {
+  void RecalculateProjectionMatrix() const {
     switch (mProjection) {
       case Orthographic:
         mProjMatrix =
@@ -100,29 +153,86 @@ class Camera {
       default:
         break;
     }
+    // only runs when the lens changes, not when the camera moves
+    mInverseProjMatrix = glm::inverse(mProjMatrix);
+    mProjectionDirty = false;
+    mViewProjDirty = true;
   }
 
-  void RecalculateViewMatrix() {
-    glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), mPosition);
-    glm::mat4 rotationMatrix =
-        glm::rotate(glm::mat4(1.0f), mRotation.z, {0.0f, 0.0f, 1.0f}) *
-        glm::rotate(glm::mat4(1.0f), mRotation.y, {0.0f, 1.0f, 0.0f}) *
-        glm::rotate(glm::mat4(1.0f), mRotation.x, {1.0f, 0.0f, 0.0f});
-
-    mTransform = translationMatrix * rotationMatrix;
+  void RecalculateViewMatrix() const {
+    // rotation is Rz * Ry * Rx written out directly
+    const float cx = glm::cos(mRotation.x), sx = glm::sin(mRotation.x);
+    const float cy = glm::cos(mRotation.y), sy = glm::sin(mRotation.y);
+    const float cz = glm::cos(mRotation.z), sz = glm::sin(mRotation.z);
+
+    const glm::vec3 right(cz * cy, sz * cy, -sy);
+    const glm::vec3 up(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx);
+    const glm::vec3 back(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx,
+                         cy * cx);
+
+    mRotationMatrix = glm::mat4(glm::vec4(right, 0.0f), glm::vec4(up, 0.0f),
+                                glm::vec4(back, 0.0f),
+                                glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    mTransform = mRotationMatrix;
+    mTransform[3] = glm::vec4(mPosition, 1.0f);
+
+    // the rotation is orthonormal, so the inverse of T * R is
+    // transpose(R) * T(-position)
+    mViewMatrix = glm::mat4(
+        glm::vec4(right.x, up.x, back.x, 0.0f),
+        glm::vec4(right.y, up.y, back.y, 0.0f),
+        glm::vec4(right.z, up.z, back.z, 0.0f),
+        glm::vec4(-glm::dot(right, mPosition), -glm::dot(up, mPosition),
+                  -glm::dot(back, mPosition), 1.0f));
+
+    mViewDirty = false;
+    mViewProjDirty = true;
   }
 
  private:
+  void UpdateViewMatrix() const {
+    if (mViewDirty) {
+      RecalculateViewMatrix();
+    }
+  }
+
+  void UpdateProjectionMatrix() const {
+    if (mProjectionDirty) {
+      RecalculateProjectionMatrix();
+    }
+  }
+
+  void UpdateViewProjectionMatrix() const {
+    UpdateViewMatrix();
+    UpdateProjectionMatrix();
+    if (!mViewProjDirty) {
+      return;
+    }
+    mViewProjMatrix = mProjMatrix * mViewMatrix;
+    // the camera transform is the inverse view matrix
+    mInverseViewProjMatrix = mTransform * mInverseProjMatrix;
+    mViewProjDirty = false;
+  }
+
  protected:
   Projection mProjection;
   float mZoomOrFov;
   float mAspectRatio;
   float mNearPlane;
   float mFarPlane;
-  glm::mat4 mTransform;
-  glm::mat4 mProjMatrix;
   glm::vec3 mPosition;
   glm::vec3 mRotation;
+
+  mutable glm::mat4 mTransform;
+  mutable glm::mat4 mRotationMatrix;
+  mutable glm::mat4 mViewMatrix;
+  mutable glm::mat4 mProjMatrix;
+  mutable glm::mat4 mInverseProjMatrix;
+  mutable glm::mat4 mViewProjMatrix;
+  mutable glm::mat4 mInverseViewProjMatrix;
+  mutable bool mViewDirty = true;
+  mutable bool mProjectionDirty = true;
+  mutable bool mViewProjDirty = true;
 };
 
 }  // namespace Peridot
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Bounds.h"
+#include "Peridot/Ecs.h"
+#include "Peridot/Mesh.h"
+#include "Peridot/Resources.h"
+#include "Peridot/Shader.h"
+#include "Peridot/TransformHierarchy.h"
+#include "Peridot/VertexArray.h"
+
+namespace Peridot {
+
+// Links an entity to a node of a TransformHierarchy, which owns the local
+// transform and parenting.
+struct TransformComponent {
+  uint32_t node = TransformHierarchy::kNullNode;
+  // copied from the hierarchy by UpdateWorldTransforms, read by the renderer
+  glm::mat4 world = glm::mat4(1.0f);
+  // Makes the next UpdateWorldTransforms copy world even though the node
+  // didn't change. New components start out stale, set it again after
+  // pointing node somewhere else.
+  bool stale = true;
+};
+
+// Resources are referenced by handles into ResourceManager::Get(), copying
+// components costs no reference counting and destroyed resources are
+// skipped by the renderer.
+struct MeshComponent {
+  // a vertex array with its own buffers, used when mesh is null
+  Handle<VertexArray> vertexArray;
+  uint32_t indexCount = 0;
+  // object space bounds, used for culling
+  AABB bounds;
+  // LODs of mesh, whose ranges the renderer reads from the Mesh and picks
+  // from by their projected error. Without any the first indexCount
+  // indices are drawn.
+  uint32_t lodCount = 0;
+  // drawn from its geometry pool
+  Handle<Mesh> mesh;
+
+  // an empty component for a stale handle
+  static MeshComponent FromMesh(const Handle<Mesh> mesh);
+};
+
+struct MaterialComponent {
+  Handle<Shader> shader;
+  // Read by the deferred path: opaque materials are drawn into the G-buffer
+  // by the engine's geometry shader, shader is only used for transparent
+  // ones, which get the albedo as "uAlbedo".
+  glm::vec4 albedo = glm::vec4(1.0f);
+  float roughness = 0.5f;
+  bool transparent = false;
+};
+
+// Point light at the entity's world position, falling off to nothing at
+// radius.
+struct PointLightComponent {
+  glm::vec3 color = glm::vec3(1.0f);
+  float intensity = 1.0f;
+  float radius = 10.0f;
+};
+
+// Light shining along direction everywhere, like the sun. The renderer
+// uses the first one it finds.
+struct DirectionalLightComponent {
+  glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+  glm::vec3 color = glm::vec3(1.0f);
+  float intensity = 1.0f;
+  bool castsShadows = true;
+};
+
+// Entities with a mesh and this are drawn into the shadow maps. Static
+// casters are kept in the cached cascades' static depth, which re-renders
+// on its own when static casters are added, removed, moved or given
+// another mesh. Dynamic casters are drawn into every cascade each frame.
+// Call World::MarkChanged after editing a caster in place.
+struct ShadowCasterComponent {
+  bool isStatic = false;
+};
+
+// Updates the hierarchy, then copies the world matrix of every node that
+// changed into the TransformComponents attached to it, and into stale ones,
+// in parallel over chunks, and marks the chunks it wrote as changed. Leave
+// updating the hierarchy to it, a separate Update would hide which nodes
+// changed.
+void UpdateWorldTransforms(World& world, TransformHierarchy& hierarchy);
+
+}  // namespace Peridot
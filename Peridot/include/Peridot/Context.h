@@ -1,15 +1,30 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
+#include "Peridot/FrameLimiter.h"
+
 struct GLFWwindow;
 
 namespace Peridot {
 
+class Profiler;
+
+// Adaptive syncs when on time and tears instead of waiting a whole extra
+// interval when a frame is late. It falls back to On where the driver lacks
+// the swap_control_tear extension.
+enum class VSync { Off, On, Adaptive };
+
 struct ContextSpecification {
   int32_t width = 1;
   int32_t height = 1;
   const char* title = "LearnOpenGL";
+  VSync vsync = VSync::On;
+  // 0 leaves the frame rate unlimited apart from vsync
+  double maxFrameRate = 0.0;
+  // hidden windows still get a full GL context, used for headless runs
+  bool visible = true;
 };
 
 class Context {
@@ -21,10 +36,21 @@ class Context {
   int32_t GetWidth() const { return currentWidth; }
   int32_t GetHeight() const { return currentHeight; }
   float GetAspectRatio() const { return mAspectRatio; }
+  VSync GetVSync() const { return mVSync; }
+  double GetMaxFrameRate() const { return mFrameLimiter.GetMaxFrameRate(); }
+  // seconds spent in the last buffer swap, with vsync on this includes the
+  // wait for the next vertical blank
+  double GetLastSwapTime() const { return mLastSwapTime; }
+
+  void SetVSync(const VSync vsync);
+  void SetMaxFrameRate(const double maxFrameRate) {
+    mFrameLimiter.SetMaxFrameRate(maxFrameRate);
+  }
 
   bool ShouldRun() const;
   void Update(float delta);
   GLFWwindow* GetRawWindow() const { return mWindow; };
+  const std::shared_ptr<Profiler>& GetProfiler() const { return mProfiler; }
 
  private:
   static void WindowSizeCallback(GLFWwindow* window, int32_t width,
@@ -32,6 +58,10 @@ class Context {
   static void SetCallbacks(GLFWwindow* window);
 
   GLFWwindow* mWindow = nullptr;
+  std::shared_ptr<Profiler> mProfiler;
+  FrameLimiter mFrameLimiter;
+  VSync mVSync = VSync::On;
+  double mLastSwapTime = 0.0;
   int32_t currentWidth = 0;
   int32_t currentHeight = 0;
   float mAspectRatio = 1.0f;
@@ -2,9 +2,16 @@
 
 #include <exception>
 #include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <spdlog/spdlog.h>
 
 #include "Peridot/Buffer.h"
 #include "Peridot/Context.h"
+#include "Peridot/FrameAllocator.h"
+#include "Peridot/Profiler.h"
+#include "Peridot/RenderStats.h"
 #include "Peridot/Shader.h"
 #include "Peridot/TimeTracker.h"
 #include "Peridot/VertexArray.h"
@@ -12,6 +19,26 @@
 
 namespace Peridot {
 
+namespace Utils {
+
+template <typename App, typename = void>
+struct HasFixedUpdate : std::false_type {};
+
+template <typename App>
+struct HasFixedUpdate<
+    App, std::void_t<decltype(std::declval<App&>().FixedUpdate(0.0f))>>
+    : std::true_type {};
+
+template <typename App, typename = void>
+struct HasInterpolatedUpdate : std::false_type {};
+
+template <typename App>
+struct HasInterpolatedUpdate<
+    App, std::void_t<decltype(std::declval<App&>().Update(0.0f, 0.0f))>>
+    : std::true_type {};
+
+}  // namespace Utils
+
 template <typename App>
 class AppRunner {
  public:
@@ -19,9 +46,24 @@ class AppRunner {
   inline AppRunner() = default;
   inline void RunApp();
 
+  // Switches to fixed-step simulation: App::FixedUpdate(step) runs zero or
+  // more times per frame, followed by one App::Update. If the app provides
+  // Update(delta, alpha) it receives the fraction of a step left in the
+  // accumulator to interpolate rendering with. A step of 0 goes back to the
+  // variable timestep loop.
+  void SetFixedTimestep(const double step, const uint32_t maxStepsPerFrame = 8) {
+    mFixedTimestep = step;
+    mMaxStepsPerFrame = maxStepsPerFrame;
+  }
+  double GetFixedTimestep() const { return mFixedTimestep; }
+
  private:
+  inline void UpdateApp(const double delta, const double alpha);
+
   std::shared_ptr<Context> mCtx;
   std::shared_ptr<App> mApp;
+  double mFixedTimestep = 0.0;
+  uint32_t mMaxStepsPerFrame = 8;
 };
 
 template<typename App>
@@ -41,14 +83,59 @@ std::shared_ptr<AppRunner<App>> AppRunner<App>::Create(const ContextSpecificatio
   return runner;
 }
 
+template<typename App>
+void AppRunner<App>::UpdateApp(const double delta, const double alpha) {
+  if constexpr (Utils::HasInterpolatedUpdate<App>::value) {
+    mApp->Update(static_cast<float>(delta), static_cast<float>(alpha));
+  } else {
+    mApp->Update(static_cast<float>(delta));
+  }
+}
+
 template<typename App>
 void AppRunner<App>::RunApp() {
   TimeTracker tracker;
+  const auto& profiler = mCtx->GetProfiler();
+  double accumulator = 0.0;
+
+  if (mFixedTimestep > 0.0 && !Utils::HasFixedUpdate<App>::value) {
+    spdlog::warn("App has no FixedUpdate, running with a variable timestep");
+  }
 
   while (mCtx->ShouldRun() && mApp->ShouldRun()) {
+    // nothing from the last frame's arenas survives into this one
+    FrameArena::ResetAll();
     tracker.Update();
-    mApp->Update(tracker.Delta());
-    mCtx->Update(tracker.Delta());
+    auto delta = tracker.Delta();
+    double alpha = 1.0;
+    profiler->BeginFrame();
+
+    if constexpr (Utils::HasFixedUpdate<App>::value) {
+      if (mFixedTimestep > 0.0) {
+        ProfileScope scope(profiler.get(), "App::FixedUpdate");
+        accumulator += delta;
+        uint32_t steps = 0;
+        while (accumulator >= mFixedTimestep && steps < mMaxStepsPerFrame) {
+          mApp->FixedUpdate(static_cast<float>(mFixedTimestep));
+          accumulator -= mFixedTimestep;
+          steps += 1;
+        }
+        // when simulation can't keep up, drop the backlog rather than
+        // spending ever longer frames trying to catch up
+        if (steps == mMaxStepsPerFrame && accumulator >= mFixedTimestep) {
+          accumulator = 0.0;
+        }
+        alpha = accumulator / mFixedTimestep;
+      }
+    }
+
+    {
+      ProfileScope scope(profiler.get(), "App::Update");
+      UpdateApp(delta, alpha);
+    }
+    profiler->EndFrame();
+    RenderStats::EndFrame(delta);
+    mCtx->Update(static_cast<float>(delta));
   }
 }
 
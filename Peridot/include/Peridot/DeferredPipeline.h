@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Buffer.h"
+#include "Peridot/Camera.h"
+#include "Peridot/Framebuffer.h"
+#include "Peridot/Lights.h"
+#include "Peridot/Shader.h"
+#include "Peridot/ShadowCascades.h"
+#include "Peridot/VertexArray.h"
+
+namespace Peridot {
+
+// std430 layout of one object for GetIndirectGeometryShader
+struct GpuGeometryObject {
+  glm::mat4 model = glm::mat4(1.0f);
+  glm::vec4 albedo = glm::vec4(1.0f);
+  // x is the roughness
+  glm::vec4 material = glm::vec4(0.5f);
+};
+
+// GPU side of deferred shading. Opaque geometry is drawn into a G-buffer
+// holding albedo with roughness (RGBA8) and octahedral encoded normals
+// (RG16F), positions are rebuilt from depth. Lighting then reads it back
+// into the default framebuffer: one full screen pass for ambient and the
+// directional light, one instanced draw of light volumes for every point
+// light, so a light only costs the pixels it covers.
+//
+// The G-buffer depth is Depth24Stencil8 to match the default framebuffer,
+// it is blitted there so light volumes and the forward pass for
+// transparents test against the opaque geometry.
+class DeferredPipeline {
+ public:
+  enum GBufferTarget : uint32_t { AlbedoRoughness = 0, Normal = 1 };
+
+  static std::shared_ptr<DeferredPipeline> Create(const uint32_t width,
+                                                  const uint32_t height);
+  DeferredPipeline() = default;
+  ~DeferredPipeline();
+
+  void Resize(const uint32_t width, const uint32_t height);
+
+  // Binds and clears the G-buffer. Draw opaque geometry with
+  // GetGeometryShader, it takes "uMVP", "uModel", "uNormalMatrix",
+  // "uAlbedo" and "uRoughness", position at location 0 and normal at 1.
+  // Without normals faces are shaded flat.
+  void BeginGeometryPass() const;
+  void EndGeometryPass() const;
+  // lights the G-buffer into the default framebuffer, lights are in world
+  // space
+  void LightingPass(const Camera& camera, const GpuPointLight* lights,
+                    const size_t lightCount);
+  // blending on, depth writes off, for transparents drawn back to front
+  // after lighting; EndForwardPass restores the defaults
+  void BeginForwardPass() const;
+  void EndForwardPass() const;
+
+  void SetAmbient(const glm::vec3& ambient) { mAmbient = ambient; }
+  // direction the light travels in, a zero color turns it off
+  void SetDirectionalLight(const glm::vec3& direction,
+                           const glm::vec3& color) {
+    mLightDirection = direction;
+    mLightColor = color;
+  }
+
+  // the directional light samples these cascades, null turns shadows off
+  void SetShadows(const ShadowCascades* shadows) { mShadows = shadows; }
+
+  const Shader& GetGeometryShader() const { return *mGeometryShader; }
+  // Geometry shader for GPU driven draws, it takes "uViewProjection" and
+  // reads each object's GpuGeometryObject from the SSBO at binding 0 by the
+  // command's baseInstance. Null without RenderCall::SupportsDrawParameters.
+  const Shader* GetIndirectGeometryShader() const {
+    return mIndirectGeometryShader.get();
+  }
+  const Framebuffer& GetGBuffer() const { return *mGBuffer; }
+
+ private:
+  void BindGBufferTextures() const;
+
+  std::shared_ptr<Framebuffer> mGBuffer;
+  std::shared_ptr<Shader> mGeometryShader;
+  std::shared_ptr<Shader> mIndirectGeometryShader;
+  std::shared_ptr<Shader> mDirectionalShader;
+  std::shared_ptr<Shader> mPointLightShader;
+  // attributeless draws still need a vertex array bound
+  std::shared_ptr<VertexArray> mEmptyVertexArray;
+  std::shared_ptr<StorageBuffer> mLightBuffer;
+  const ShadowCascades* mShadows = nullptr;
+  glm::vec3 mAmbient = glm::vec3(0.03f);
+  glm::vec3 mLightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+  glm::vec3 mLightColor = glm::vec3(0.0f);
+};
+
+}  // namespace Peridot
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Shader.h"
+
+namespace Peridot {
+
+// Hierarchical-Z buffer: an R32F mip chain where every texel holds the
+// farthest depth of the texels it covers one level down. Built by compute
+// from the previous frame's depth texture, it lets occlusion tests compare
+// an object's nearest depth against a handful of texels.
+class DepthPyramid {
+ public:
+  static std::shared_ptr<DepthPyramid> Create(const uint32_t depthWidth,
+                                              const uint32_t depthHeight);
+  DepthPyramid() = default;
+  ~DepthPyramid();
+
+  // Downsamples depthTexture into the pyramid. viewProjection is the matrix
+  // the depth was rendered with, occlusion tests project bounds with it.
+  void Build(const uint32_t depthTexture, const glm::mat4& viewProjection);
+  void Resize(const uint32_t depthWidth, const uint32_t depthHeight);
+  void Bind(const uint32_t textureUnit) const;
+
+  // level 0 is the largest power of two not above the depth size
+  uint32_t GetWidth() const { return mWidth; }
+  uint32_t GetHeight() const { return mHeight; }
+  uint32_t GetLevelCount() const { return mLevelCount; }
+  const glm::mat4& GetViewProjection() const { return mViewProjection; }
+  bool IsValid() const { return mBuilt; }
+
+ private:
+  void Allocate(const uint32_t depthWidth, const uint32_t depthHeight);
+
+  std::shared_ptr<Shader> mReduceShader;
+  glm::mat4 mViewProjection = glm::mat4(1.0f);
+  uint32_t mDepthWidth = 0;
+  uint32_t mDepthHeight = 0;
+  uint32_t mWidth = 0;
+  uint32_t mHeight = 0;
+  uint32_t mLevelCount = 0;
+  uint32_t mTexture = 0;
+  bool mBuilt = false;
+};
+
+}  // namespace Peridot
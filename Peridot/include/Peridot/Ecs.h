@@ -0,0 +1,450 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Peridot/FrameAllocator.h"
+#include "Peridot/ThreadPool.h"
+
+namespace Peridot {
+
+struct Entity {
+  static constexpr uint32_t kInvalidIndex =
+      std::numeric_limits<uint32_t>::max();
+
+  uint32_t index = kInvalidIndex;
+  // bumped every time the index is recycled, stale handles stop resolving
+  uint32_t generation = 0;
+
+  bool IsValid() const { return index != kInvalidIndex; }
+  bool operator==(const Entity& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+using ComponentId = uint32_t;
+constexpr uint32_t kMaxComponentTypes = 64;
+using ComponentMask = std::bitset<kMaxComponentTypes>;
+
+// Type erased operations archetypes need to shuffle components between
+// chunks without knowing their types.
+struct ComponentInfo {
+  size_t size = 0;
+  size_t alignment = 0;
+  void (*moveConstruct)(void* destination, void* source) = nullptr;
+  void (*destroy)(void* component) = nullptr;
+};
+
+namespace Utils {
+
+ComponentId RegisterComponent(const ComponentInfo& info);
+const ComponentInfo& GetComponentInfo(const ComponentId id);
+
+template <typename T>
+using ComponentType = std::remove_cv_t<std::remove_reference_t<T>>;
+
+}  // namespace Utils
+
+// Ids are handed out on first use, in whatever order the types are touched.
+template <typename T>
+ComponentId ComponentTypeId() {
+  using Type = Utils::ComponentType<T>;
+  if constexpr (!std::is_same_v<T, Type>) {
+    return ComponentTypeId<Type>();
+  } else {
+    static_assert(std::is_move_constructible_v<Type>,
+                  "components must be move constructible");
+    static const ComponentId id = Utils::RegisterComponent(
+        {sizeof(Type), alignof(Type),
+         [](void* destination, void* source) {
+           new (destination) Type(std::move(*static_cast<Type*>(source)));
+         },
+         [](void* component) { static_cast<Type*>(component)->~Type(); }});
+    return id;
+  }
+}
+
+template <typename... Ts>
+ComponentMask MakeComponentMask() {
+  ComponentMask mask;
+  (mask.set(ComponentTypeId<Ts>()), ...);
+  return mask;
+}
+
+// All entities with exactly the same set of components. Rows live in fixed
+// size chunks, each holding an entity column followed by one tightly packed
+// array per component, so systems walk plain arrays. Removal swaps the last
+// row into the hole, keeping every chunk but the last one full.
+class Archetype {
+ public:
+  static constexpr size_t kChunkBytes = 16 * 1024;
+  static constexpr uint32_t kNoColumn = std::numeric_limits<uint32_t>::max();
+
+  explicit Archetype(const ComponentMask& mask);
+  ~Archetype();
+  Archetype(const Archetype&) = delete;
+  Archetype& operator=(const Archetype&) = delete;
+
+  const ComponentMask& GetMask() const { return mMask; }
+  const std::vector<ComponentId>& GetComponents() const { return mComponents; }
+  bool Has(const ComponentId id) const { return mMask.test(id); }
+
+  uint32_t GetChunkCapacity() const { return mCapacity; }
+  size_t GetChunkCount() const { return mChunks.size(); }
+  uint32_t GetChunkSize(const size_t chunk) const {
+    return mChunks[chunk].count;
+  }
+  // the World's change tick when the chunk was last written, see
+  // World::MarkChanged
+  uint64_t GetChangeTick(const size_t chunk) const {
+    return mChunks[chunk].changeTick;
+  }
+  size_t GetEntityCount() const { return mEntityCount; }
+  // bumped whenever a row is added or removed
+  uint64_t GetVersion() const { return mVersion; }
+
+  Entity* GetEntities(const size_t chunk) const {
+    return reinterpret_cast<Entity*>(mChunks[chunk].data);
+  }
+  void* GetColumn(const size_t chunk, const ComponentId id) const {
+    assert(mColumnOffsets[id] != kNoColumn && "component not in archetype");
+    return mChunks[chunk].data + mColumnOffsets[id];
+  }
+  template <typename T>
+  T* GetColumn(const size_t chunk) const {
+    return static_cast<T*>(GetColumn(chunk, ComponentTypeId<T>()));
+  }
+  void* GetComponent(const uint32_t chunk, const uint32_t row,
+                     const ComponentId id) const {
+    return static_cast<std::byte*>(GetColumn(chunk, id)) +
+           Utils::GetComponentInfo(id).size * row;
+  }
+
+ private:
+  friend class World;
+
+  struct Chunk {
+    std::byte* data = nullptr;
+    uint32_t count = 0;
+    uint64_t changeTick = 0;
+  };
+
+  // Reserves a row for entity, component memory is left uninitialized.
+  std::pair<uint32_t, uint32_t> AllocateRow(const Entity entity);
+  // Destroys every component in the row and fills it with the archetype's
+  // last row. Returns the entity that moved, invalid when none did.
+  Entity RemoveRow(const uint32_t chunk, const uint32_t row);
+  void Clear();
+
+  ComponentMask mMask;
+  std::vector<ComponentId> mComponents;
+  std::array<uint32_t, kMaxComponentTypes> mColumnOffsets;
+  // archetype reached by adding or removing a component, filled lazily
+  std::array<uint32_t, kMaxComponentTypes> mAddEdges;
+  std::array<uint32_t, kMaxComponentTypes> mRemoveEdges;
+  std::vector<Chunk> mChunks;
+  size_t mChunkBytes = kChunkBytes;
+  size_t mChunkAlignment = 64;
+  uint32_t mCapacity = 0;
+  size_t mEntityCount = 0;
+  uint64_t mVersion = 0;
+};
+
+// Owns entities and their components. Structural changes (creating,
+// destroying, adding or removing components) must not happen while a query
+// is iterating.
+class World {
+ public:
+  World();
+  ~World();
+  World(const World&) = delete;
+  World& operator=(const World&) = delete;
+
+  Entity Create();
+  template <typename... Ts>
+  Entity Create(Ts&&... components);
+  void Destroy(const Entity entity);
+  bool IsAlive(const Entity entity) const;
+  void Clear();
+  size_t GetEntityCount() const { return mAliveCount; }
+
+  // Constructs the component in place, or assigns it if already present.
+  template <typename T, typename... Args>
+  T& Add(const Entity entity, Args&&... args);
+  template <typename T>
+  void Remove(const Entity entity);
+  template <typename T>
+  T* Get(const Entity entity);
+  template <typename T>
+  bool Has(const Entity entity) const;
+
+  // number of entities having at least the components in Ts
+  template <typename... Ts>
+  size_t Count() const;
+
+  // fn(Entity, Ts&...) for every entity having at least Ts
+  template <typename... Ts, typename Fn>
+  void Each(Fn&& fn);
+  // fn(const Entity* entities, size_t count, Ts*... columns) once per chunk,
+  // for systems that want to run over the raw arrays
+  template <typename... Ts, typename Fn>
+  void EachChunk(Fn&& fn);
+
+  // Same as above with chunks spread across the shared ThreadPool. Every
+  // chunk is visited by exactly one thread, so fn may write the components it
+  // is handed without synchronization.
+  template <typename... Ts, typename Fn>
+  void ParallelEach(Fn&& fn);
+  template <typename... Ts, typename Fn>
+  void ParallelEachChunk(Fn&& fn);
+
+  // Change tracking for systems keeping derived data, like GPU copies, up
+  // to date without walking every entity. Chunks are stamped with the
+  // current change tick when rows move in or out of them, when Add replaces
+  // a component and on MarkChanged. A system remembers the tick
+  // AdvanceChangeTick returned and next time visits only the chunks stamped
+  // after it. Removed entities leave no stamp behind, they change the
+  // structure version instead.
+  //
+  // Stamps the entity's chunk, call it after writing components in place.
+  // Safe from query callbacks, parallel ones included.
+  void MarkChanged(const Entity entity);
+  // returns the current tick and starts a new one
+  uint64_t AdvanceChangeTick() { return mChangeTick++; }
+  uint64_t GetChangeTick() const { return mChangeTick; }
+  // EachChunk over the chunks stamped after tick
+  template <typename... Ts, typename Fn>
+  void EachChangedChunk(const uint64_t tick, Fn&& fn);
+  // changes whenever entities having at least Ts are created, destroyed,
+  // or gain or lose components
+  template <typename... Ts>
+  uint64_t GetStructureVersion() const;
+
+  const std::vector<std::unique_ptr<Archetype>>& GetArchetypes() const {
+    return mArchetypes;
+  }
+
+ private:
+  struct EntityRecord {
+    uint32_t archetype = 0;
+    uint32_t chunk = 0;
+    uint32_t row = 0;
+    uint32_t generation = 0;
+    bool alive = false;
+  };
+
+  struct ChunkRef {
+    Archetype* archetype;
+    uint32_t chunk;
+  };
+
+  uint32_t GetOrCreateArchetype(const ComponentMask& mask);
+  uint32_t GetAddTarget(const uint32_t archetype, const ComponentId id);
+  uint32_t GetRemoveTarget(const uint32_t archetype, const ComponentId id);
+  Entity AllocateEntity(const uint32_t archetype);
+  // moves the entity's shared components into a row of the target archetype
+  void MoveEntity(const Entity entity, const uint32_t target);
+  void Stamp(Archetype& archetype, const uint32_t chunk) {
+    archetype.mChunks[chunk].changeTick = mChangeTick;
+  }
+  void GatherChunks(const ComponentMask& mask, FrameVector<ChunkRef>& chunks);
+
+  struct IterationGuard {
+    explicit IterationGuard(World& world) : world(world) {
+      world.mIterating += 1;
+    }
+    ~IterationGuard() { world.mIterating -= 1; }
+    World& world;
+  };
+
+  std::vector<std::unique_ptr<Archetype>> mArchetypes;
+  std::unordered_map<ComponentMask, uint32_t> mArchetypeLookup;
+  std::vector<EntityRecord> mRecords;
+  std::vector<uint32_t> mFreeIndices;
+  size_t mAliveCount = 0;
+  uint32_t mIterating = 0;
+  // chunks start out newer than the 0 a system begins with
+  uint64_t mChangeTick = 1;
+};
+
+template <typename... Ts>
+Entity World::Create(Ts&&... components) {
+  assert(mIterating == 0 && "structural change during iteration");
+  auto archetype =
+      GetOrCreateArchetype(MakeComponentMask<Utils::ComponentType<Ts>...>());
+  auto entity = AllocateEntity(archetype);
+  const auto& record = mRecords[entity.index];
+  auto* storage = mArchetypes[archetype].get();
+  (new (storage->GetComponent(record.chunk, record.row,
+                              ComponentTypeId<Ts>()))
+       Utils::ComponentType<Ts>(std::forward<Ts>(components)),
+   ...);
+  return entity;
+}
+
+template <typename T, typename... Args>
+T& World::Add(const Entity entity, Args&&... args) {
+  assert(mIterating == 0 && "structural change during iteration");
+  assert(IsAlive(entity) && "stale entity");
+  auto id = ComponentTypeId<T>();
+  auto& record = mRecords[entity.index];
+  if (mArchetypes[record.archetype]->Has(id)) {
+    auto* component = static_cast<T*>(
+        mArchetypes[record.archetype]->GetComponent(record.chunk, record.row,
+                                                    id));
+    *component = T(std::forward<Args>(args)...);
+    Stamp(*mArchetypes[record.archetype], record.chunk);
+    return *component;
+  }
+
+  MoveEntity(entity, GetAddTarget(record.archetype, id));
+  return *new (mArchetypes[record.archetype]->GetComponent(record.chunk,
+                                                           record.row, id))
+      T(std::forward<Args>(args)...);
+}
+
+template <typename T>
+void World::Remove(const Entity entity) {
+  assert(mIterating == 0 && "structural change during iteration");
+  if (!IsAlive(entity)) {
+    return;
+  }
+  auto id = ComponentTypeId<T>();
+  auto& record = mRecords[entity.index];
+  if (!mArchetypes[record.archetype]->Has(id)) {
+    return;
+  }
+  MoveEntity(entity, GetRemoveTarget(record.archetype, id));
+}
+
+template <typename T>
+T* World::Get(const Entity entity) {
+  if (!IsAlive(entity)) {
+    return nullptr;
+  }
+  auto id = ComponentTypeId<T>();
+  const auto& record = mRecords[entity.index];
+  const auto& archetype = mArchetypes[record.archetype];
+  if (!archetype->Has(id)) {
+    return nullptr;
+  }
+  return static_cast<T*>(archetype->GetComponent(record.chunk, record.row, id));
+}
+
+template <typename T>
+bool World::Has(const Entity entity) const {
+  return IsAlive(entity) &&
+         mArchetypes[mRecords[entity.index].archetype]->Has(
+             ComponentTypeId<T>());
+}
+
+template <typename... Ts>
+size_t World::Count() const {
+  auto mask = MakeComponentMask<Ts...>();
+  size_t count = 0;
+  for (const auto& archetype : mArchetypes) {
+    if ((archetype->GetMask() & mask) == mask) {
+      count += archetype->GetEntityCount();
+    }
+  }
+  return count;
+}
+
+template <typename... Ts, typename Fn>
+void World::EachChunk(Fn&& fn) {
+  IterationGuard guard(*this);
+  auto mask = MakeComponentMask<Ts...>();
+  for (const auto& archetype : mArchetypes) {
+    if ((archetype->GetMask() & mask) != mask) {
+      continue;
+    }
+    for (size_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++) {
+      fn(static_cast<const Entity*>(archetype->GetEntities(chunk)),
+         static_cast<size_t>(archetype->GetChunkSize(chunk)),
+         archetype->template GetColumn<Ts>(chunk)...);
+    }
+  }
+}
+
+template <typename... Ts, typename Fn>
+void World::EachChangedChunk(const uint64_t tick, Fn&& fn) {
+  IterationGuard guard(*this);
+  auto mask = MakeComponentMask<Ts...>();
+  for (const auto& archetype : mArchetypes) {
+    if ((archetype->GetMask() & mask) != mask) {
+      continue;
+    }
+    for (size_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++) {
+      if (archetype->GetChangeTick(chunk) <= tick) {
+        continue;
+      }
+      fn(static_cast<const Entity*>(archetype->GetEntities(chunk)),
+         static_cast<size_t>(archetype->GetChunkSize(chunk)),
+         archetype->template GetColumn<Ts>(chunk)...);
+    }
+  }
+}
+
+template <typename... Ts>
+uint64_t World::GetStructureVersion() const {
+  // versions only grow, so the sum changes whenever one of them does
+  auto mask = MakeComponentMask<Ts...>();
+  uint64_t version = 0;
+  for (const auto& archetype : mArchetypes) {
+    if ((archetype->GetMask() & mask) == mask) {
+      version += archetype->GetVersion();
+    }
+  }
+  return version;
+}
+
+template <typename... Ts, typename Fn>
+void World::Each(Fn&& fn) {
+  EachChunk<Ts...>(
+      [&fn](const Entity* entities, size_t count, Ts*... columns) {
+        for (size_t i = 0; i < count; i++) {
+          fn(entities[i], columns[i]...);
+        }
+      });
+}
+
+template <typename... Ts, typename Fn>
+void World::ParallelEachChunk(Fn&& fn) {
+  IterationGuard guard(*this);
+  ArenaScope scope;
+  FrameVector<ChunkRef> chunks;
+  GatherChunks(MakeComponentMask<Ts...>(), chunks);
+  ThreadPool::Get().ParallelFor(
+      chunks.size(), 1, [&chunks, &fn](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+          auto* archetype = chunks[i].archetype;
+          auto chunk = chunks[i].chunk;
+          fn(static_cast<const Entity*>(archetype->GetEntities(chunk)),
+             static_cast<size_t>(archetype->GetChunkSize(chunk)),
+             archetype->template GetColumn<Ts>(chunk)...);
+        }
+      });
+}
+
+template <typename... Ts, typename Fn>
+void World::ParallelEach(Fn&& fn) {
+  ParallelEachChunk<Ts...>(
+      [&fn](const Entity* entities, size_t count, Ts*... columns) {
+        for (size_t i = 0; i < count; i++) {
+          fn(entities[i], columns[i]...);
+        }
+      });
+}
+
+}  // namespace Peridot
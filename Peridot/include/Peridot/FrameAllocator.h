@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Peridot {
+
+// Bump allocator over a chain of blocks. Allocation is a pointer bump,
+// nothing is freed on its own: Reset drops everything at once and
+// RollBack returns to an earlier Marker. Not thread safe, see FrameArena
+// for one per thread.
+class LinearArena {
+ public:
+  static constexpr size_t kDefaultBlockSize = 1 << 20;
+
+  struct Marker {
+    size_t block = 0;
+    size_t offset = 0;
+  };
+
+  explicit LinearArena(const size_t blockSize = kDefaultBlockSize);
+  LinearArena(const LinearArena&) = delete;
+  LinearArena& operator=(const LinearArena&) = delete;
+
+  void* Allocate(const size_t size, const size_t alignment);
+  // Gives back the most recent allocation so a growing vector can reuse
+  // the space, anything else is only reclaimed by Reset or RollBack.
+  void Deallocate(void* pointer, const size_t size);
+
+  Marker GetMarker() const { return {mBlock, mOffset}; }
+  void RollBack(const Marker marker);
+  // Frees everything. When the last round spilled over into several
+  // blocks they are merged into one that fits it all.
+  void Reset();
+
+  size_t GetUsed() const;
+  size_t GetCapacity() const;
+
+ private:
+  struct Block {
+    std::unique_ptr<std::byte[]> data;
+    size_t size = 0;
+  };
+
+  void AddBlock(const size_t minimumSize);
+
+  std::vector<Block> mBlocks;
+  size_t mBlockSize = kDefaultBlockSize;
+  size_t mBlock = 0;
+  size_t mOffset = 0;
+};
+
+// One LinearArena per thread for data that lives at most a frame: command
+// lists, culling results, temporary vectors. AppRunner::RunApp resets all
+// of them at the top of every frame, so nothing allocated from them may be
+// kept across frames.
+class FrameArena {
+ public:
+  // the calling thread's arena, created on first use
+  static LinearArena& Get();
+  // Resets every thread's arena, only call it while no other thread is
+  // using its arena.
+  static void ResetAll();
+};
+
+// Returns the arena to where it was on construction, for scratch memory
+// that doesn't even need to live to the end of the frame.
+class ArenaScope {
+ public:
+  explicit ArenaScope(LinearArena& arena = FrameArena::Get())
+      : mArena(arena), mMarker(arena.GetMarker()) {}
+  ~ArenaScope() { mArena.RollBack(mMarker); }
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+ private:
+  LinearArena& mArena;
+  LinearArena::Marker mMarker;
+};
+
+// STL allocator on top of a LinearArena, the calling thread's frame arena
+// by default.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+
+  ArenaAllocator() : mArena(&FrameArena::Get()) {}
+  explicit ArenaAllocator(LinearArena& arena) : mArena(&arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : mArena(other.GetArena()) {}
+
+  T* allocate(const size_t count) {
+    return static_cast<T*>(mArena->Allocate(sizeof(T) * count, alignof(T)));
+  }
+  void deallocate(T* pointer, const size_t count) {
+    mArena->Deallocate(pointer, sizeof(T) * count);
+  }
+
+  LinearArena* GetArena() const { return mArena; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return mArena == other.GetArena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return mArena != other.GetArena();
+  }
+
+ private:
+  LinearArena* mArena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace Peridot
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+namespace Peridot {
+
+// Paces frames to a target rate. Most of the wait is spent asleep, the last
+// stretch is spun so wake-up jitter from the OS scheduler does not leak into
+// frame times. The sleep/spin split adapts to the oversleep actually seen.
+class FrameLimiter {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  FrameLimiter() = default;
+  explicit FrameLimiter(const double maxFrameRate) {
+    SetMaxFrameRate(maxFrameRate);
+  }
+
+  // 0 or less disables limiting
+  void SetMaxFrameRate(const double maxFrameRate);
+  double GetMaxFrameRate() const { return mMaxFrameRate; }
+
+  // blocks until one frame period has passed since the previous Wait
+  void Wait();
+
+ private:
+  double mMaxFrameRate = 0.0;
+  Clock::duration mFramePeriod = Clock::duration::zero();
+  Clock::time_point mNextFrame;
+  // how much earlier than the deadline we stop sleeping and start spinning
+  Clock::duration mSpinThreshold = std::chrono::milliseconds(2);
+};
+
+}  // namespace Peridot
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Peridot {
+
+enum class TextureFormat {
+  None,
+  RGBA8,
+  RGBA16F,
+  RG16F,
+  R32F,
+  Depth24Stencil8,
+  Depth32F
+};
+
+struct FramebufferSpecification {
+  uint32_t width = 1;
+  uint32_t height = 1;
+  std::vector<TextureFormat> colorAttachments;
+  // None leaves the framebuffer without depth
+  TextureFormat depthAttachment = TextureFormat::Depth32F;
+};
+
+// Offscreen render target whose attachments are textures, so later passes
+// can sample what was rendered into it.
+class Framebuffer {
+ public:
+  static std::shared_ptr<Framebuffer> Create(
+      const FramebufferSpecification& spec);
+  Framebuffer() = default;
+  ~Framebuffer();
+
+  // binds for drawing and sets the viewport to the framebuffer size
+  void Bind() const;
+  // back to the default framebuffer, the caller restores its viewport
+  void Unbind() const;
+  // recreates every attachment, previous contents are lost
+  void Resize(const uint32_t width, const uint32_t height);
+
+  const FramebufferSpecification& GetSpecification() const { return mSpec; }
+  uint32_t GetWidth() const { return mSpec.width; }
+  uint32_t GetHeight() const { return mSpec.height; }
+  uint32_t GetColorAttachment(const size_t index) const {
+    return mColorAttachments[index];
+  }
+  uint32_t GetDepthAttachment() const { return mDepthAttachment; }
+
+  // copies the default framebuffer's depth into this framebuffer's depth
+  // attachment, formats have to match for the blit to succeed
+  void BlitDepthFromDefault(const uint32_t sourceWidth,
+                            const uint32_t sourceHeight) const;
+  // copies depth into another framebuffer, e.g. a G-buffer's depth into
+  // the target of a later forward pass
+  void BlitDepthTo(const Framebuffer* target) const;
+
+ private:
+  bool Invalidate();
+  void Release();
+
+  FramebufferSpecification mSpec;
+  std::vector<uint32_t> mColorAttachments;
+  uint32_t mDepthAttachment = 0;
+  uint32_t mRendererId = 0;
+};
+
+}  // namespace Peridot
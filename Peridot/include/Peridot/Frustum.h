@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Bounds.h"
+#include "Peridot/Camera.h"
+
+namespace Peridot {
+
+struct Frustum {
+  enum PlaneIndex { Left, Right, Bottom, Top, Near, Far };
+
+  // xyz is the inward facing unit normal, w the distance term, so a point p
+  // is inside a plane when dot(xyz, p) + w >= 0
+  std::array<glm::vec4, 6> planes;
+
+  static Frustum FromMatrix(const glm::mat4& viewProjection);
+  static Frustum FromCamera(const Camera& camera) {
+    return FromMatrix(camera.GetViewProjectionMatrix());
+  }
+
+  bool Intersects(const AABB& box) const;
+  bool Intersects(const BoundingSphere& sphere) const;
+  // true only when the whole box is inside, lets hierarchies accept a
+  // subtree without testing its children
+  bool Contains(const AABB& box) const;
+};
+
+// Bounds kept as structure of arrays so the culling kernels can load eight
+// consecutive objects per register.
+struct AABBSoA {
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  size_t Size() const { return centerX.size(); }
+  void Reserve(const size_t count);
+  void Clear();
+  void Add(const AABB& box);
+  void Set(const size_t index, const AABB& box);
+};
+
+struct SphereSoA {
+  std::vector<float> centerX, centerY, centerZ, radius;
+
+  size_t Size() const { return centerX.size(); }
+  void Reserve(const size_t count);
+  void Clear();
+  void Add(const BoundingSphere& sphere);
+  void Set(const size_t index, const BoundingSphere& sphere);
+};
+
+// Appends the indices of every volume touching the frustum to visible, in
+// ascending order. Uses AVX (8 wide) when the library is built with
+// PERIDOT_ENABLE_AVX2, SSE (4 wide) otherwise.
+void CullAABBs(const Frustum& frustum, const AABBSoA& boxes,
+               std::vector<uint32_t>& visible);
+void CullSpheres(const Frustum& frustum, const SphereSoA& spheres,
+                 std::vector<uint32_t>& visible);
+
+// Same as above with the volumes split into threadCount contiguous ranges
+// culled on the shared ThreadPool. 0 picks one range per pool thread. Small
+// inputs are culled on the calling thread.
+void CullAABBsParallel(const Frustum& frustum, const AABBSoA& boxes,
+                       std::vector<uint32_t>& visible,
+                       uint32_t threadCount = 0);
+void CullSpheresParallel(const Frustum& frustum, const SphereSoA& spheres,
+                         std::vector<uint32_t>& visible,
+                         uint32_t threadCount = 0);
+
+}  // namespace Peridot
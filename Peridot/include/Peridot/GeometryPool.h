@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Peridot/Buffer.h"
+#include "Peridot/Utils.h"
+#include "Peridot/VertexArray.h"
+
+namespace Peridot {
+
+// Best fit free list over [0, capacity) in whatever units the caller uses.
+// Freed ranges merge with free neighbours. Allocate and Free are
+// logarithmic in the number of free ranges.
+class RangeAllocator {
+ public:
+  static constexpr uint32_t kInvalidOffset = UINT32_MAX;
+
+  explicit RangeAllocator(const uint32_t capacity = 0);
+
+  // kInvalidOffset when no free range is large enough
+  uint32_t Allocate(const uint32_t size);
+  void Free(const uint32_t offset);
+  // frees everything and changes the capacity
+  void Reset(const uint32_t capacity);
+
+  uint32_t GetCapacity() const { return mCapacity; }
+  uint32_t GetUsed() const { return mUsed; }
+  uint32_t GetLargestFree() const;
+
+ private:
+  void InsertFree(const uint32_t offset, const uint32_t size);
+  void EraseFree(const std::map<uint32_t, uint32_t>::iterator it);
+
+  uint32_t mCapacity = 0;
+  uint32_t mUsed = 0;
+  // offset to size, for merging with neighbours
+  std::map<uint32_t, uint32_t> mFreeByOffset;
+  // (size, offset), for best fit
+  std::set<std::pair<uint32_t, uint32_t>> mFreeBySize;
+  std::unordered_map<uint32_t, uint32_t> mAllocated;
+};
+
+// Where an allocation lives in its pool, in vertices and indices.
+struct GeometryRange {
+  int32_t baseVertex = 0;
+  uint32_t vertexCount = 0;
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+};
+
+// Geometry of many meshes in one vertex buffer and one index buffer, all
+// with the same layout and index type. Meshes draw with their baseVertex
+// and firstIndex, so the pool binds once for all of them. The buffers grow
+// by copying on the GPU when full, Defragment packs the allocations to the
+// front. Only use it from the thread owning the GL context.
+class GeometryPool {
+ public:
+  static constexpr uint32_t kInvalidAllocation = UINT32_MAX;
+
+  static std::shared_ptr<GeometryPool> Create(
+      const BufferLayout& layout, const Utils::IndexType indexType,
+      const uint32_t vertexCapacity, const uint32_t indexCapacity);
+  GeometryPool() = default;
+  GeometryPool(const GeometryPool&) = delete;
+  GeometryPool& operator=(const GeometryPool&) = delete;
+
+  // Copies the data in, indices are relative to the first vertex.
+  // kInvalidAllocation when the pool can't grow any further.
+  uint32_t Allocate(const void* vertices, const uint32_t vertexCount,
+                    const void* indices, const uint32_t indexCount);
+  void Free(const uint32_t allocation);
+  // changes when the pool is defragmented, look it up when drawing
+  const GeometryRange& GetRange(const uint32_t allocation) const {
+    return mRanges[allocation];
+  }
+  // bumped every time growing or defragmenting moved the ranges, for
+  // caches of them
+  uint32_t GetRepackCount() const { return mRepackCount; }
+
+  // Moves every allocation to the front of fresh buffers, leaving one
+  // contiguous free range at the back of each.
+  void Defragment();
+  // 0 when the free space is in one piece, towards 1 as it scatters
+  float GetFragmentation() const;
+
+  // binds the pool's buffers into the bound shared vertex array
+  void BindBuffers() const;
+  const std::shared_ptr<VertexArray>& GetVertexArray() const {
+    return mVertexArray;
+  }
+  const BufferLayout& GetLayout() const { return mLayout; }
+  Utils::IndexType GetIndexType() const { return mIndexType; }
+  uint32_t GetVertexCapacity() const { return mVertices.GetCapacity(); }
+  uint32_t GetIndexCapacity() const { return mIndices.GetCapacity(); }
+  uint32_t GetAllocationCount() const {
+    return static_cast<uint32_t>(mRanges.size() - mFreeAllocations.size());
+  }
+
+ private:
+  bool Reserve(const uint32_t vertexCount, const uint32_t indexCount);
+  // copies the allocations to the front of new buffers of the given size
+  void Repack(const uint32_t vertexCapacity, const uint32_t indexCapacity);
+
+  BufferLayout mLayout;
+  Utils::IndexType mIndexType = Utils::IndexType::UInt32;
+  std::shared_ptr<VertexArray> mVertexArray;
+  std::shared_ptr<StorageBuffer> mVertexBuffer;
+  std::shared_ptr<StorageBuffer> mIndexBuffer;
+  RangeAllocator mVertices;
+  RangeAllocator mIndices;
+  std::vector<GeometryRange> mRanges;
+  // ids of freed ranges, reused first
+  std::vector<uint32_t> mFreeAllocations;
+  uint32_t mRepackCount = 0;
+};
+
+// A range of a GeometryPool, freed when the last reference goes. Meshes
+// and their components share it, so the geometry outlives either.
+class GeometryAllocation {
+ public:
+  // nullptr when the pool is out of space
+  static std::shared_ptr<GeometryAllocation> Create(
+      const std::shared_ptr<GeometryPool>& pool, const void* vertices,
+      const uint32_t vertexCount, const void* indices,
+      const uint32_t indexCount);
+  GeometryAllocation() = default;
+  GeometryAllocation(const GeometryAllocation&) = delete;
+  GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+  ~GeometryAllocation();
+
+  const GeometryPool& GetPool() const { return *mPool; }
+  const GeometryRange& GetRange() const { return mPool->GetRange(mId); }
+
+ private:
+  std::shared_ptr<GeometryPool> mPool;
+  uint32_t mId = GeometryPool::kInvalidAllocation;
+};
+
+// One GeometryPool per layout and index type, the way VertexArrayCache
+// has one vertex array per layout.
+class GeometryPoolCache {
+ public:
+  static constexpr uint32_t kInitialVertexCapacity = 1 << 16;
+  static constexpr uint32_t kInitialIndexCapacity = 1 << 18;
+
+  static GeometryPoolCache& Get();
+
+  std::shared_ptr<GeometryPool> Acquire(const BufferLayout& layout,
+                                        const Utils::IndexType indexType);
+  // defragments every pool past the fragmentation threshold
+  void Defragment(const float threshold = 0.5f);
+  // drops the cache's references, has to run before the GL context goes
+  void Clear();
+
+ private:
+  GeometryPoolCache() = default;
+
+  std::unordered_map<size_t, std::vector<std::shared_ptr<GeometryPool>>>
+      mPools;
+};
+
+}  // namespace Peridot
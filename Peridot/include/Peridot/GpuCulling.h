@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Buffer.h"
+#include "Peridot/Camera.h"
+#include "Peridot/DepthPyramid.h"
+#include "Peridot/Frustum.h"
+#include "Peridot/Mesh.h"
+#include "Peridot/RenderCalls.h"
+#include "Peridot/Shader.h"
+
+namespace Peridot {
+
+// std430 layout of one object's bounds. scale is the largest axis scale of
+// the object's model matrix, which LOD errors are multiplied with, and
+// lodTable the GpuLodTable to pick the object's index range from, or
+// kNoLodTable to draw its command as is.
+struct GpuObjectBounds {
+  static constexpr uint32_t kNoLodTable = UINT32_MAX;
+
+  glm::vec3 center = glm::vec3(0.0f);
+  float scale = 1.0f;
+  glm::vec3 extents = glm::vec3(0.0f);
+  uint32_t lodTable = kNoLodTable;
+};
+
+// std430 layout of a mesh's LODs, with index ranges in the buffer the
+// commands draw from. The picked LOD replaces firstIndex and count of the
+// object's command.
+struct GpuLodTable {
+  struct Lod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+    uint32_t padding = 0;
+  };
+
+  std::array<Lod, kMaxMeshLods> lods = {};
+  uint32_t lodCount = 0;
+  uint32_t padding[3] = {};
+};
+
+// How Cull picks LODs, the same way Renderer does on the CPU with
+// SelectLod. An object covers pixelsPerUnit * scale / max(distance,
+// minDistance) pixels per object space unit at its distance from the
+// camera, orthographic cameras have a minDistance of 0 and ignore the
+// distance.
+struct GpuLodSelection {
+  glm::vec3 cameraPosition = glm::vec3(0.0f);
+  float pixelsPerUnit = 0.0f;
+  float minDistance = 0.0f;
+  float threshold = 1.0f;
+
+  static GpuLodSelection FromCamera(const Camera& camera,
+                                    const float viewportHeight,
+                                    const float threshold) {
+    const bool perspective = camera.GetProjection() == Camera::Perspective;
+    return {camera.GetPosition(),
+            camera.GetProjectionMatrix()[1][1] * viewportHeight * 0.5f,
+            perspective ? std::max(0.1f, camera.GetNearClippingPlane()) : 0.0f,
+            threshold};
+  }
+};
+
+// GPU driven culling: object bounds and one draw command per object stay
+// resident in SSBOs, a compute pass tests them against the frustum, picks
+// their LOD and appends the survivors to a compacted indirect command
+// buffer together with a draw count. The frame is then submitted with a
+// single MultiDrawElementsIndirectCount, so the CPU does no per-object
+// work. Objects are only uploaded when they change.
+//
+// baseInstance of each command is passed through untouched, use it to look
+// up per-object data (instanced attributes or gl_BaseInstance).
+//
+// Every instance shares one compiled cull program.
+class GpuCulling {
+ public:
+  static std::shared_ptr<GpuCulling> Create(const uint32_t maxObjects);
+  GpuCulling() = default;
+
+  // Grows the buffers to hold at least objectCount objects, keeping what
+  // was uploaded.
+  void Reserve(const uint32_t objectCount);
+  // objects from count on are left out of Cull and Draw
+  void SetObjectCount(const uint32_t count);
+  // uploads objects [first, first + count), which have to fit the capacity
+  void UpdateObjects(const uint32_t first, const uint32_t count,
+                     const GpuObjectBounds* bounds,
+                     const DrawElementsIndirectCommand* commands);
+  void UpdateObject(const uint32_t index, const GpuObjectBounds& bounds,
+                    const DrawElementsIndirectCommand& command) {
+    UpdateObjects(index, 1, &bounds, &command);
+  }
+  // replaces every object
+  void SetObjects(const std::vector<GpuObjectBounds>& bounds,
+                  const std::vector<DrawElementsIndirectCommand>& commands);
+  // uploads tables [first, first + count), growing the table buffer as
+  // needed
+  void UpdateLodTables(const uint32_t first, const uint32_t count,
+                       const GpuLodTable* tables);
+
+  // Without a selection objects with a LOD table draw its first LOD.
+  void SetLodSelection(const GpuLodSelection& selection) {
+    mLodSelection = selection;
+    mSelectLods = true;
+  }
+
+  // With a depth pyramid, objects hidden behind the depth it was built from
+  // are culled too. Build the pyramid from the previous frame's depth after
+  // drawing; objects revealed by camera motion show up a frame late.
+  void Cull(const Frustum& frustum, const DepthPyramid* occlusion = nullptr);
+  // the caller binds the shader and vertex array the commands refer to,
+  // whose element buffer holds indexType values
+  void Draw(const Utils::IndexType indexType = Utils::IndexType::UInt32) const;
+
+  uint32_t GetObjectCount() const { return mObjectCount; }
+  uint32_t GetMaxObjects() const { return mMaxObjects; }
+  const std::shared_ptr<StorageBuffer>& GetBoundsBuffer() const {
+    return mBoundsBuffer;
+  }
+
+ private:
+  std::shared_ptr<Shader> mCullShader;
+  std::shared_ptr<StorageBuffer> mBoundsBuffer;
+  std::shared_ptr<StorageBuffer> mCommandBuffer;
+  std::shared_ptr<StorageBuffer> mVisibleCommandBuffer;
+  std::shared_ptr<StorageBuffer> mDrawCountBuffer;
+  std::shared_ptr<StorageBuffer> mLodTableBuffer;
+  GpuLodSelection mLodSelection;
+  uint32_t mMaxObjects = 0;
+  uint32_t mObjectCount = 0;
+  uint32_t mMaxLodTables = 0;
+  bool mSelectLods = false;
+  // without indirect count support every command is kept in place and
+  // culled ones get an instance count of 0
+  bool mCompact = true;
+};
+
+}  // namespace Peridot
@@ -51,6 +51,9 @@ class PollModeInput {
   ButtonState GetKeyState(const KeyCode key) const;
   ButtonState GetMouseButtonState(const MouseCode mouseButton) const;
   std::tuple<double, double, double, double> GetCursorPos() const;
+  // current position only, unlike GetCursorPos this leaves the previous
+  // position used for cursor deltas untouched
+  std::pair<double, double> GetCurrentCursorPos() const;
 
  private:
 
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Buffer.h"
+#include "Peridot/Camera.h"
+#include "Peridot/Lights.h"
+#include "Peridot/Shader.h"
+
+namespace Peridot {
+
+// Clustered light culling for forward shading. The view frustum is split
+// into a grid of screen tiles and depth slices, logarithmic for
+// perspective cameras, and a compute pass lists the point lights touching
+// every cluster. A fragment then only loops over the lights of its own
+// cluster, so forward shading, MSAA and transparency keep working with
+// thousands of lights.
+//
+// Bind makes the results available to shaders at fixed binding points:
+// shader storage 0 holds the lights, 1 an (offset, count) pair per
+// cluster and 2 the light indices they point into; uniform block 0 holds
+// what a fragment needs to find its cluster. GetShaderSource declares all
+// of it together with helpers.
+class LightClusters {
+ public:
+  static constexpr uint32_t kGridWidth = 16;
+  static constexpr uint32_t kGridHeight = 9;
+  static constexpr uint32_t kGridDepth = 24;
+  // lights past this in one cluster are dropped
+  static constexpr uint32_t kMaxLightsPerCluster = 128;
+
+  static std::shared_ptr<LightClusters> Create();
+  LightClusters() = default;
+  ~LightClusters();
+
+  // uploads the lights and assigns them to the clusters of the camera's
+  // frustum, for a viewport of width x height pixels
+  void Update(const Camera& camera, const GpuPointLight* lights,
+              const size_t lightCount, const uint32_t width,
+              const uint32_t height);
+  void Bind() const;
+
+  size_t GetLightCount() const { return mLightCount; }
+
+  // GLSL to put after the #version line of shaders reading the clusters
+  static const char* GetShaderSource();
+
+ private:
+  std::shared_ptr<Shader> mCullShader;
+  std::shared_ptr<StorageBuffer> mParamsBuffer;
+  std::shared_ptr<StorageBuffer> mLightBuffer;
+  std::shared_ptr<StorageBuffer> mClusterBuffer;
+  std::shared_ptr<StorageBuffer> mIndexBuffer;
+  std::shared_ptr<StorageBuffer> mIndexCountBuffer;
+  size_t mLightCount = 0;
+};
+
+}  // namespace Peridot
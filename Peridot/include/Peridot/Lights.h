@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace Peridot {
+
+// std430 layout of one point light as the lighting shaders read it
+struct GpuPointLight {
+  // xyz world position, w the radius the light falls off to nothing at
+  glm::vec4 position = glm::vec4(0.0f);
+  // rgb color already scaled by the intensity, w is unused
+  glm::vec4 color = glm::vec4(0.0f);
+};
+
+}  // namespace Peridot
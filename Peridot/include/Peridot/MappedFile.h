@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Peridot {
+
+// Read only view of a whole file through the OS page cache, no copy is made.
+// Pages are faulted in on first touch, so threads parsing separate ranges
+// also read them from disk in parallel.
+class MappedFile {
+ public:
+  static std::shared_ptr<MappedFile> Open(const char* filePath);
+
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* GetData() const { return mData; }
+  size_t GetSize() const { return mSize; }
+
+ private:
+  const uint8_t* mData = nullptr;
+  size_t mSize = 0;
+#ifdef _WIN32
+  void* mFile = nullptr;
+  void* mMapping = nullptr;
+#endif
+};
+
+}  // namespace Peridot
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Bounds.h"
+#include "Peridot/Buffer.h"
+#include "Peridot/GeometryPool.h"
+#include "Peridot/VertexArray.h"
+#include "Peridot/VertexLayout.h"
+
+namespace Peridot {
+
+struct MeshVertex {
+  glm::vec3 position = glm::vec3(0.0f);
+  glm::vec3 normal = glm::vec3(0.0f);
+  glm::vec2 texCoord = glm::vec2(0.0f);
+
+  // position, normal, texCoord, same as VertexLayout<MeshVertex>()
+  static const BufferLayout& Layout();
+};
+PERIDOT_VERTEX(MeshVertex, position, normal, texCoord);
+
+constexpr uint32_t kMaxMeshLods = 8;
+
+// A range of the mesh's index buffer. All LODs share the vertex buffer.
+struct MeshLod {
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  // object space distance the LOD may deviate from LOD 0
+  float error = 0.0f;
+};
+
+// Picks the coarsest LOD whose error stays below pixelThreshold once
+// scaled by pixelsPerUnit, see Camera::GetPixelsPerUnit.
+uint32_t SelectLod(const MeshLod* lods, const uint32_t lodCount,
+                   const float pixelsPerUnit, const float pixelThreshold);
+
+// Geometry on the CPU side, as produced by the loaders.
+struct MeshData {
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+  // empty when indices hold a single LOD
+  std::vector<MeshLod> lods;
+  AABB bounds;
+
+  void ComputeBounds();
+  // Fills zero normals with the area weighted sum of the adjacent face
+  // normals, leaves the others alone.
+  void GenerateMissingNormals();
+};
+
+class Mesh {
+ public:
+  // indices are stored as 16-bit whenever the vertex count allows
+  static std::shared_ptr<Mesh> Create(const MeshData& meshData);
+  // Uploads vertices already laid out as described by layout and indices of
+  // indexType, the data is copied straight into the geometry pool for that
+  // layout and index type.
+  static std::shared_ptr<Mesh> Create(const void* vertices,
+                                      const uint32_t vertexCount,
+                                      const BufferLayout& layout,
+                                      const void* indices,
+                                      const uint32_t indexCount,
+                                      const Utils::IndexType indexType,
+                                      const AABB& bounds,
+                                      const std::vector<MeshLod>& lods = {});
+  // .pmesh files are mapped and uploaded as they are, anything else goes
+  // through LoadMeshData
+  static std::shared_ptr<Mesh> Load(const char* filePath);
+
+  Mesh() = default;
+
+  // shared by every mesh with the same layout, see VertexArrayCache. Bind
+  // the pool's buffers into it with GeometryPool::BindBuffers and draw
+  // with the allocation's baseVertex and firstIndex.
+  const std::shared_ptr<VertexArray>& GetVertexArray() const {
+    return mGeometry->GetPool().GetVertexArray();
+  }
+  const std::shared_ptr<GeometryAllocation>& GetGeometry() const {
+    return mGeometry;
+  }
+  uint32_t GetVertexCount() const { return mVertexCount; }
+  uint32_t GetIndexCount() const { return mIndexCount; }
+  Utils::IndexType GetIndexType() const { return mIndexType; }
+  const AABB& GetBounds() const { return mBounds; }
+  // at least one, LOD 0 is the full detail mesh
+  const std::vector<MeshLod>& GetLods() const { return mLods; }
+
+ private:
+  std::shared_ptr<GeometryAllocation> mGeometry;
+  uint32_t mVertexCount = 0;
+  uint32_t mIndexCount = 0;
+  Utils::IndexType mIndexType = Utils::IndexType::UInt32;
+  AABB mBounds;
+  std::vector<MeshLod> mLods;
+};
+
+}  // namespace Peridot
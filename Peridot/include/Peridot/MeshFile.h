@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "Peridot/Mesh.h"
+
+namespace Peridot {
+
+// Peridot's own mesh format (.pmesh). The vertex and index blobs are stored
+// exactly as the GPU consumes them, so loading is a file mapping and one
+// upload per buffer with nothing parsed in between. Little endian only.
+//
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount]
+//   MeshFileLod[lodCount]
+//   vertex blob at vertexOffset, vertexCount * vertexStride bytes
+//   index blob at indexOffset, indexCount * indexSize bytes
+//
+// Both blobs start on a kMeshFileAlignment boundary.
+constexpr uint32_t kMeshFileMagic = 0x48534D50;  // "PMSH"
+// 2 added MeshFileAttribute::normalized
+constexpr uint32_t kMeshFileVersion = 2;
+constexpr uint64_t kMeshFileAlignment = 16;
+
+struct MeshFileHeader {
+  uint32_t magic = kMeshFileMagic;
+  uint32_t version = kMeshFileVersion;
+  uint32_t vertexCount = 0;
+  uint32_t indexCount = 0;
+  uint32_t vertexStride = 0;
+  // bytes per index: 1, 2 or 4
+  uint32_t indexSize = 4;
+  uint32_t attributeCount = 0;
+  // zero when the indices hold a single LOD
+  uint32_t lodCount = 0;
+  float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+  float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+  uint64_t vertexOffset = 0;
+  uint64_t indexOffset = 0;
+};
+
+// one BufferLayout element
+struct MeshFileAttribute {
+  // a Utils::Type value
+  uint32_t type = 0;
+  uint32_t offset = 0;
+  // BufferElement::normalized, 0 or 1
+  uint8_t normalized = 0;
+  uint8_t reserved[3] = {};
+  char name[20] = {};
+};
+
+struct MeshFileLod {
+  uint32_t firstIndex = 0;
+  uint32_t indexCount = 0;
+  float error = 0.0f;
+  uint32_t reserved = 0;
+};
+
+static_assert(sizeof(MeshFileHeader) == 72, "MeshFileHeader layout changed");
+static_assert(sizeof(MeshFileAttribute) == 32,
+              "MeshFileAttribute layout changed");
+static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod layout changed");
+
+// Writes meshData with the MeshVertex layout, with 16-bit indices when the
+// vertex count allows. Logs and returns false on failure.
+bool WriteMeshFile(const char* filePath, const MeshData& meshData);
+
+// Maps a .pmesh file and uploads both blobs straight from the mapping.
+// Returns nullptr if the file is missing or malformed.
+std::shared_ptr<Mesh> LoadMeshFile(const char* filePath);
+
+}  // namespace Peridot
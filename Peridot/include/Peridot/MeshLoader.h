@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Peridot/Mesh.h"
+
+namespace Peridot {
+
+// Loaders read through a MappedFile and split the work over the shared
+// ThreadPool. Vertices without normals get smooth ones. On failure they log
+// the reason and return false, meshData is left in an unspecified state.
+
+// Wavefront OBJ. Polygons are fan triangulated and identical
+// position/texcoord/normal triples are merged into one vertex. Materials are
+// ignored.
+bool LoadObj(const char* filePath, MeshData& meshData);
+
+// Binary glTF 2.0 (.glb). Every triangle primitive reachable from the
+// default scene is flattened into one mesh with its node transform applied.
+// Only the embedded BIN chunk is read, external buffers are rejected.
+bool LoadGlb(const char* filePath, MeshData& meshData);
+
+// picks the loader from the file extension
+bool LoadMeshData(const char* filePath, MeshData& meshData);
+
+}  // namespace Peridot
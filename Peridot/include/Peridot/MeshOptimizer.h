@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Peridot/Mesh.h"
+
+namespace Peridot {
+
+// Entries of the simulated post-transform vertex cache. Real hardware
+// varies, 16 is a good compromise across vendors.
+constexpr uint32_t kVertexCacheSize = 16;
+
+// Reorders triangles for the post-transform vertex cache (Tipsify).
+// Linear in the triangle count.
+void OptimizeVertexCache(std::vector<uint32_t>& indices,
+                         const size_t vertexCount,
+                         const uint32_t cacheSize = kVertexCacheSize);
+
+// Reorders triangles for the vertex cache and then sorts clusters of them
+// so outward facing ones come first, which cuts overdraw from any view.
+// Clusters are only split while their cache miss ratio stays within
+// threshold times the ratio of the whole mesh, 1.05 gives up ~5%.
+void OptimizeOverdraw(std::vector<uint32_t>& indices,
+                      const std::vector<MeshVertex>& vertices,
+                      const float threshold = 1.05f,
+                      const uint32_t cacheSize = kVertexCacheSize);
+
+// Reorders vertices in the order the indices first use them, so vertex
+// fetch walks memory linearly. Unreferenced vertices are dropped.
+void OptimizeVertexFetch(MeshData& meshData);
+
+// Overdraw (and with it vertex cache) for every LOD, then vertex fetch.
+void OptimizeMesh(MeshData& meshData);
+
+// Quadric edge collapse (Garland and Heckbert) down to about
+// targetIndexCount indices. Vertices only collapse onto existing ones, so
+// the result indexes the same vertex buffer. Open borders stay put.
+// resultError receives the estimated deviation in object space units.
+std::vector<uint32_t> SimplifyMesh(const std::vector<MeshVertex>& vertices,
+                                   const std::vector<uint32_t>& indices,
+                                   const size_t targetIndexCount,
+                                   float* resultError = nullptr);
+
+// Appends up to lodCount - 1 simplified versions of LOD 0 to
+// meshData.indices, each with about reduction times the triangles of the
+// one before, and records them in meshData.lods. Stops early once a mesh
+// no longer simplifies.
+void GenerateLods(MeshData& meshData, const uint32_t lodCount = 4,
+                  const float reduction = 0.5f);
+
+// average cache misses per triangle, between 0.5 and 3 for real meshes
+float AverageCacheMissRatio(const std::vector<uint32_t>& indices,
+                            const size_t vertexCount,
+                            const uint32_t cacheSize = kVertexCacheSize);
+
+// true when every index fits in 16 bits
+inline bool Fits16BitIndices(const size_t vertexCount) {
+  return vertexCount <= 0x10000;
+}
+
+// Halves the index memory and bandwidth, callers check Fits16BitIndices.
+std::vector<uint16_t> ConvertTo16BitIndices(
+    const std::vector<uint32_t>& indices);
+
+}  // namespace Peridot
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Peridot {
+
+struct ProfileEvent {
+  enum class Source { Cpu, Gpu };
+  // names are not copied, pass string literals
+  const char* name = nullptr;
+  Source source = Source::Cpu;
+  uint32_t depth = 0;
+  // seconds since the profiler was created, GPU timestamps are shifted onto
+  // the same timeline as the CPU markers
+  double start = 0.0;
+  double end = 0.0;
+  double Duration() const { return end - start; }
+};
+
+struct ProfileFrame {
+  uint64_t frameIndex = 0;
+  double cpuTime = 0.0;
+  double gpuTime = 0.0;
+  std::vector<ProfileEvent> events;
+  bool IsGpuBound() const { return gpuTime > cpuTime; }
+};
+
+// Records CPU markers and GL timestamp queries for nested scopes. Query
+// objects live in a ring of kFramesInFlight slots and are only read back once
+// the GPU reports them as available, so profiling never stalls the pipeline.
+class Profiler {
+ public:
+  static constexpr uint32_t kFramesInFlight = 4;
+  static constexpr uint32_t kMaxScopesPerFrame = 64;
+
+  static std::shared_ptr<Profiler> Create();
+  Profiler() = default;
+  ~Profiler();
+
+  void BeginFrame();
+  void EndFrame();
+  void BeginScope(const char* name);
+  void EndScope();
+
+  // most recent frame whose GPU results have been read back, this lags the
+  // frame being recorded by up to kFramesInFlight - 1 frames
+  const ProfileFrame& GetLastResolvedFrame() const { return mResolvedFrame; }
+  uint64_t GetDroppedFrames() const { return mDroppedFrames; }
+
+ private:
+  struct Scope {
+    const char* name = nullptr;
+    uint32_t depth = 0;
+    double cpuStart = 0.0;
+    double cpuEnd = 0.0;
+    // index into the slot's query pool, kMaxScopesPerFrame means no GPU timing
+    uint32_t query = kMaxScopesPerFrame;
+  };
+
+  struct FrameSlot {
+    std::array<uint32_t, kMaxScopesPerFrame * 2> queries = {};
+    std::vector<Scope> scopes;
+    uint64_t frameIndex = 0;
+    double gpuToCpuOffset = 0.0;
+    uint32_t usedQueries = 0;
+    // the timestamp issued last, the root's end marker once the frame ends
+    uint32_t lastQuery = 0;
+    bool pending = false;
+  };
+
+  double Now() const;
+  bool TryResolve(FrameSlot& slot);
+
+  std::array<FrameSlot, kFramesInFlight> mSlots;
+  std::vector<uint32_t> mScopeStack;
+  ProfileFrame mResolvedFrame;
+  std::chrono::steady_clock::time_point mEpoch;
+  uint64_t mFrameIndex = 0;
+  uint64_t mDroppedFrames = 0;
+  uint32_t mCurrentSlot = 0;
+  bool mInFrame = false;
+};
+
+class ProfileScope {
+ public:
+  ProfileScope(Profiler* profiler, const char* name) : mProfiler(profiler) {
+    if (mProfiler) {
+      mProfiler->BeginScope(name);
+    }
+  }
+  ~ProfileScope() {
+    if (mProfiler) {
+      mProfiler->EndScope();
+    }
+  }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  Profiler* mProfiler = nullptr;
+};
+
+}  // namespace Peridot
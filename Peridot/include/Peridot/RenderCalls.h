@@ -1,13 +1,62 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
+#include "Peridot/Utils.h"
+
 namespace Peridot {
 
 struct RenderCall {
   static void SetClearColor(const float r, const float g, const float b,
                             const float a);
   static void ClearColorAndDepth();
+  static void SetViewport(const uint32_t width, const uint32_t height);
 
   static void DrawElements(const size_t count);
+  // starts firstIndex indices into the bound element buffer, which holds
+  // indexType values
+  static void DrawElements(
+      const size_t count, const size_t firstIndex,
+      const Utils::IndexType indexType = Utils::IndexType::UInt32);
+  // same, with baseVertex added to every index, for geometry pools
+  static void DrawElementsBaseVertex(const size_t count,
+                                     const size_t firstIndex,
+                                     const int32_t baseVertex,
+                                     const Utils::IndexType indexType);
+  // triangles without vertex buffers, for shaders that build their
+  // vertices from gl_VertexID and gl_InstanceID
+  static void DrawArrays(const size_t count, const size_t instanceCount = 1);
+
+  // Draws the DrawElementsIndirectCommand array in the bound
+  // DrawIndirect buffer. The Count variant reads the number of draws from
+  // the uint at offset 0 of the bound Parameter buffer and needs GL 4.6 or
+  // ARB_indirect_parameters, see SupportsIndirectCount.
+  static void MultiDrawElementsIndirect(
+      const size_t drawCount,
+      const Utils::IndexType indexType = Utils::IndexType::UInt32);
+  static void MultiDrawElementsIndirectCount(
+      const size_t maxDrawCount,
+      const Utils::IndexType indexType = Utils::IndexType::UInt32);
+  static bool SupportsIndirectCount();
+  // gl_BaseInstanceARB and gl_DrawIDARB in shaders, GL 4.6 or
+  // ARB_shader_draw_parameters
+  static bool SupportsDrawParameters();
+
+  static void DispatchCompute(const uint32_t groupsX, const uint32_t groupsY,
+                              const uint32_t groupsZ);
+  // makes compute shader SSBO writes visible to later shaders and to
+  // indirect draws sourcing their commands from those buffers
+  static void ShaderStorageBarrier();
+};
+
+// Matches the layout GL reads indirect indexed draws in.
+struct DrawElementsIndirectCommand {
+  uint32_t count = 0;
+  uint32_t instanceCount = 0;
+  uint32_t firstIndex = 0;
+  int32_t baseVertex = 0;
+  uint32_t baseInstance = 0;
 };
 
 }  // namespace Peridot
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Peridot {
+
+struct FrameStats {
+  uint64_t frameIndex = 0;
+  double frameTime = 0.0;
+  uint32_t drawCalls = 0;
+  uint64_t triangles = 0;
+  uint32_t shaderBinds = 0;
+  uint32_t vertexArrayBinds = 0;
+  // vertex buffers swapped into a shared vertex array
+  uint32_t vertexBufferBinds = 0;
+  // binds that actually switched the bound object
+  uint32_t stateChanges = 0;
+  uint64_t bufferBytesUploaded = 0;
+  // live counts are running totals, not reset between frames
+  int64_t liveBuffers = 0;
+  int64_t liveVertexArrays = 0;
+  int64_t liveShaders = 0;
+};
+
+struct FrameTimeSummary {
+  size_t samples = 0;
+  double min = 0.0;
+  double avg = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+};
+
+// Counters are fed by RenderCall and the GL object wrappers. Everything here
+// runs on the thread owning the GL context, so no synchronization is done.
+struct RenderStats {
+  enum class Object { Buffer, VertexArray, Shader };
+  static constexpr size_t kHistorySize = 300;
+
+  static void RecordDrawCall(const uint64_t triangles);
+  static void RecordShaderBind(const uint32_t programId);
+  static void RecordVertexArrayBind(const uint32_t vertexArrayId);
+  static void RecordVertexBufferBind(const uint32_t bufferId);
+  static void RecordBufferUpload(const size_t sizeInBytes);
+  static void RecordObjectCreated(const Object object);
+  static void RecordObjectDestroyed(const Object object);
+
+  // closes the current frame, pushes it into the history and starts a new one
+  static void EndFrame(const double frameTime);
+
+  static const FrameStats& GetCurrentFrame();
+  static const FrameStats& GetLastFrame();
+  // oldest first, at most kHistorySize entries
+  static std::vector<FrameStats> GetHistory();
+  static FrameTimeSummary SummarizeFrameTimes();
+
+  // visits the last completed frame and the frame time summary as flat
+  // name/value pairs for feeding external monitoring
+  static void ForEachMetric(
+      const std::function<void(const char* name, double value)>& callback);
+};
+
+}  // namespace Peridot
@@ -1,20 +1,234 @@
 #pragma once
 
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Bvh.h"
+#include "Peridot/Camera.h"
+#include "Peridot/Components.h"
 #include "Peridot/Core.h"
+#include "Peridot/DeferredPipeline.h"
+#include "Peridot/DepthPyramid.h"
+#include "Peridot/GpuCulling.h"
+#include "Peridot/LightClusters.h"
+#include "Peridot/Lights.h"
+#include "Peridot/ShadowCascades.h"
 
 namespace Peridot {
 
 class Renderer {
  public:
+  static constexpr uint32_t kShadowResolution = 2048;
+
   static std::shared_ptr<Renderer> Create(const std::shared_ptr<Context>& mCtx);
 
   Renderer() = default;
   ~Renderer();
 
+  // Draws every entity with a transform, mesh and material that touches the
+  // camera frustum. Culling runs in parallel over chunks, draws are sorted by
+  // shader, vertex array and geometry pool to keep state changes down.
+  // Shaders get the combined model-view-projection matrix as "uMVP" and the
+  // model matrix as "uModel". Meshes with LODs draw the coarsest one whose
+  // error projects to at most the LOD threshold. Point lights in the
+  // frustum are assigned to LightClusters first, shaders built with its
+  // GetShaderSource can light themselves from it. The same goes for the
+  // shadows of the first DirectionalLightComponent and
+  // ShadowCascades::GetShaderSource.
+  void RenderScene(World& world, const Camera& camera);
+  // Deferred shading for scenes with many lights. Opaque materials are
+  // drawn into a G-buffer with the engine's geometry shader, lit by the
+  // first DirectionalLightComponent with its shadows and every
+  // PointLightComponent in the frustum through light volumes, then
+  // transparent materials are drawn forward with their own shader, back to
+  // front and blended over the result. Transparents see the light clusters
+  // and shadows like in RenderScene.
+  void RenderSceneDeferred(World& world, const Camera& camera);
+
+  // First entity with a transform and mesh whose world bounds the ray
+  // through x, y hits, in window coordinates as PollModeInput::GetCursorPos
+  // reports them; an invalid Entity on a miss. The bounds live in a BVH
+  // synced with the world on every call: refit when entities only moved,
+  // rebuilt when they were created or destroyed.
+  Entity Pick(World& world, const Camera& camera, const double x,
+              const double y);
+
+  // the deferred pipeline, created on the first deferred frame
+  DeferredPipeline* GetDeferredPipeline() const { return mDeferred.get(); }
+  // created on the first frame needing it, null when compute is unsupported
+  LightClusters* GetLightClusters() const { return mClusters.get(); }
+  // created on the first frame with a shadow casting directional light
+  ShadowCascades* GetShadowCascades() const { return mShadows.get(); }
+
+  // Culls and draws opaque meshes from geometry pools in
+  // RenderSceneDeferred on the GPU: one GpuCulling batch per pool, drawn
+  // with a single indirect draw, instead of culling and submitting them one
+  // by one. LODs are picked on the GPU too. The batches stay resident and
+  // only take in entities whose chunks the World stamped since the last
+  // frame, call World::MarkChanged after editing a mesh or material in
+  // place. Off by default, turns itself back off when the driver lacks
+  // RenderCall::SupportsDrawParameters.
+  void SetGpuCulling(const bool enabled) { mGpuCulling = enabled; }
+  bool GetGpuCulling() const { return mGpuCulling; }
+  // With GPU culling, objects hidden behind the depth of the previous
+  // geometry pass are culled too. On by default.
+  void SetOcclusionCulling(const bool enabled) { mOcclusionCulling = enabled; }
+  bool GetOcclusionCulling() const { return mOcclusionCulling; }
+
+  // in pixels, 1 by default
+  void SetLodThreshold(const float pixels) { mLodThreshold = pixels; }
+  float GetLodThreshold() const { return mLodThreshold; }
+
  private:
+  struct DrawItem {
+    // null for opaque materials of the deferred path and shadow casters
+    const Shader* shader;
+    const VertexArray* vertexArray;
+    // null for vertex arrays with their own buffers
+    const GeometryPool* geometry;
+    // points into the world's chunk, valid until its next structural
+    // change, null for shadow casters
+    const MaterialComponent* material;
+    glm::mat4 model;
+    glm::mat4 mvp;
+    // squared, from the camera to the center of the world bounds
+    float distance;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t baseVertex;
+  };
+
+  // The objects of one geometry pool culled and drawn by the GPU. Each
+  // entity owns a slot of the resident buffers, mirrored here so only slots
+  // whose contents changed are uploaded.
+  struct GpuBatch {
+    const VertexArray* vertexArray = nullptr;
+    const GeometryPool* geometry = nullptr;
+    // the pool's repack count when the slots were filled
+    uint32_t repackCount = 0;
+    std::shared_ptr<GpuCulling> culling;
+    std::shared_ptr<StorageBuffer> objectBuffer;
+    std::vector<Entity> entities;
+    std::vector<GpuObjectBounds> bounds;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<GpuGeometryObject> objects;
+    std::vector<uint32_t> dirty;
+    // mesh handle index to its table in lodTables
+    std::unordered_map<uint32_t, uint32_t> lodTableIndices;
+    std::vector<GpuLodTable> lodTables;
+    uint32_t uploadedLodTables = 0;
+  };
+
+  // what a static caster was drawn into the cached cascades with
+  struct StaticCaster {
+    uint32_t generation = 0;
+    Handle<Mesh> mesh;
+    Handle<VertexArray> vertexArray;
+    uint32_t indexCount = 0;
+    AABB bounds;
+    glm::mat4 model = glm::mat4(1.0f);
+  };
+
+  // where an entity's GPU object lives, indexed by the entity's index
+  struct GpuSlot {
+    static constexpr uint32_t kNoBatch = UINT32_MAX;
+
+    uint32_t generation = 0;
+    uint32_t batch = kNoBatch;
+    uint32_t slot = 0;
+  };
+
+  // the first DirectionalLightComponent, null without one
+  const DirectionalLightComponent* FindDirectionalLight(World& world);
+  // Renders the cascades needing it this frame and binds them for
+  // shading, false when light is null or casts no shadows.
+  bool RenderShadows(World& world, const Camera& camera,
+                     const DirectionalLightComponent* light);
+  // Brings mStaticCasters up to date with the casters changed since the
+  // last call, true when the static ones differ from what the cached
+  // cascades were drawn from.
+  bool UpdateStaticCasters(World& world);
+  // the point lights touching the frustum into mLights
+  void GatherPointLights(World& world, const Camera& camera);
+  // assigns mLights to the clusters and binds them for shading
+  void UpdateLightClusters(const Camera& camera);
+  // brings mPickBvh up to date with the world
+  void UpdatePickBvh(World& world);
+  // Culls into mDrawItems. The deferred path takes items without a shader
+  // as long as their material is opaque, with gpuDriven it leaves opaque
+  // meshes from geometry pools to the GPU batches.
+  void CollectDrawItems(World& world, const Camera& camera,
+                        const bool deferred, const bool gpuDriven = false);
+  // Brings mGpuBatches up to date with the opaque pooled meshes changed
+  // since the last call and uploads the slots that differ, false when GPU
+  // culling can't run. Everything is rebuilt after meshes were destroyed or
+  // a pool was repacked.
+  bool SyncGpuBatches(World& world);
+  // Puts the entity's object into its batch's slot, false when a GpuCulling
+  // couldn't be created.
+  bool WriteGpuObject(const Entity entity, const TransformComponent& transform,
+                      const MeshComponent& mesh,
+                      const MaterialComponent& material);
+  // swaps the batch's last object into the entity's slot
+  void RemoveGpuObject(const Entity entity);
+  // the entity's slot, null when it has no GPU object
+  GpuSlot* FindGpuSlot(const Entity entity);
+  // culls the batches, against the depth pyramid when occlusion is on
+  void CullGpuBatches(const Camera& camera);
+  // call inside the geometry pass
+  void DrawGpuBatches(const Camera& camera) const;
+  // the current geometry pass depth, for the next frame's occlusion tests
+  void BuildDepthPyramid(const Camera& camera);
+  // Fills item's geometry pool and index range, the LOD for the mesh's
+  // pixels per object space unit. source is the mesh's Mesh or null.
+  void ResolveIndexRange(const MeshComponent& mesh, const Mesh* source,
+                         const float pixelsPerUnit, DrawItem& item) const;
+  // Draws with state changes only where consecutive items differ. With a
+  // shader every item is drawn with it and gets the material uniforms the
+  // G-buffer needs, otherwise with its own. Items without a material only
+  // get "uMVP".
+  void SubmitDrawItems(const DrawItem* begin, const DrawItem* end,
+                       const Shader* shader = nullptr) const;
+
   std::shared_ptr<Context> mCtx;
   std::shared_ptr<VertexArray> mVertexArray;
   std::shared_ptr<Shader> mShader;
+  std::shared_ptr<DeferredPipeline> mDeferred;
+  std::shared_ptr<LightClusters> mClusters;
+  std::shared_ptr<ShadowCascades> mShadows;
+  std::shared_ptr<DepthPyramid> mDepthPyramid;
+  // don't retry building the cluster and shadow shaders every frame
+  bool mClustersFailed = false;
+  bool mShadowsFailed = false;
+  // the cached cascades re-render when these change, by entity index
+  std::unordered_map<uint32_t, StaticCaster> mStaticCasters;
+  uint64_t mShadowSyncTick = 0;
+  uint64_t mShadowStructureVersion = 0;
+  uint64_t mShadowMeshVersion = 0;
+  std::vector<DrawItem> mDrawItems;
+  std::vector<GpuBatch> mGpuBatches;
+  std::vector<GpuSlot> mGpuSlots;
+  // what the batches were synced against
+  uint64_t mGpuSyncTick = 0;
+  uint64_t mGpuStructureVersion = 0;
+  uint64_t mGpuMeshVersion = 0;
+  std::array<std::vector<DrawItem>, ShadowCascades::kCascadeCount>
+      mShadowItems;
+  // static casters of the cached cascades rendering their static layer
+  std::array<std::vector<DrawItem>, ShadowCascades::kCascadeCount>
+      mStaticShadowItems;
+  std::vector<GpuPointLight> mLights;
+  // leaves hold indices into mPickEntities
+  Bvh mPickBvh;
+  std::vector<Entity> mPickEntities;
+  std::vector<uint32_t> mPickProxies;
+  std::vector<AABB> mPickBounds;
+  float mLodThreshold = 1.0f;
+  bool mGpuCulling = false;
+  bool mOcclusionCulling = true;
 };
 
 }  // namespace Peridot
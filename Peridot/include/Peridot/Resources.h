@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Peridot {
+
+class Mesh;
+class Shader;
+class VertexArray;
+
+// Typed index into a ResourcePool. The generation tells a handle to a
+// destroyed resource apart from one to whatever reused its slot, so stale
+// handles resolve to nullptr instead of the wrong object. Trivially
+// copyable, components hold these instead of shared_ptrs.
+template <typename T>
+struct Handle {
+  static constexpr uint32_t kNullIndex = UINT32_MAX;
+
+  uint32_t index = kNullIndex;
+  uint32_t generation = 0;
+
+  bool IsNull() const { return index == kNullIndex; }
+  bool operator==(const Handle& other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// Runs destructions once the GPU finished every frame that might still
+// use the object, tracked with a fence per frame. Only use it from the
+// thread owning the GL context.
+class DeletionQueue {
+ public:
+  static DeletionQueue& Get();
+
+  void Defer(std::function<void()> destroy);
+  // Fences what was deferred this frame and runs whatever the GPU is done
+  // with. Called by the context after every buffer swap.
+  void EndFrame();
+  // waits for the GPU and runs everything, before the GL context goes
+  void Flush();
+  size_t GetPendingCount() const;
+
+ private:
+  DeletionQueue() = default;
+
+  struct Frame {
+    // GLsync, kept opaque so this header doesn't need GL
+    void* fence = nullptr;
+    std::vector<std::function<void()>> deletions;
+  };
+
+  std::vector<std::function<void()>> mCurrent;
+  std::deque<Frame> mInFlight;
+};
+
+// Owns resources in a dense slot array and hands out handles to them.
+// Lookups are an index and a generation compare, no reference counting.
+// Destroy invalidates the handle right away and hands the resource to the
+// DeletionQueue, so draws already submitted can finish with it.
+template <typename T>
+class ResourcePool {
+ public:
+  // a null handle for a null resource
+  Handle<T> Add(std::shared_ptr<T> resource) {
+    if (!resource) {
+      return {};
+    }
+    uint32_t index;
+    if (!mFreeSlots.empty()) {
+      index = mFreeSlots.back();
+      mFreeSlots.pop_back();
+    } else {
+      index = static_cast<uint32_t>(mObjects.size());
+      mObjects.push_back(nullptr);
+      mOwners.emplace_back();
+      // 0 is never valid, default handles don't match a fresh slot
+      mGenerations.push_back(1);
+    }
+    mObjects[index] = resource.get();
+    mOwners[index] = std::move(resource);
+    return {index, mGenerations[index]};
+  }
+
+  // nullptr for null, stale and destroyed handles
+  T* Get(const Handle<T> handle) const {
+    if (handle.index >= mObjects.size() ||
+        mGenerations[handle.index] != handle.generation) {
+      return nullptr;
+    }
+    return mObjects[handle.index];
+  }
+
+  void Destroy(const Handle<T> handle) {
+    if (Get(handle) == nullptr) {
+      return;
+    }
+    const uint32_t index = handle.index;
+    DeletionQueue::Get().Defer(
+        [resource = std::move(mOwners[index])]() mutable {
+          resource.reset();
+        });
+    mObjects[index] = nullptr;
+    mGenerations[index] += 1;
+    mFreeSlots.push_back(index);
+    mVersion += 1;
+  }
+
+  size_t GetSize() const { return mObjects.size() - mFreeSlots.size(); }
+  // changes whenever resources go away, for caches of what handles resolve
+  // to
+  uint64_t GetVersion() const { return mVersion; }
+
+  // drops every resource at once, for shutdown
+  void Clear() {
+    mObjects.clear();
+    mOwners.clear();
+    mGenerations.clear();
+    mFreeSlots.clear();
+    mVersion += 1;
+  }
+
+ private:
+  // raw pointers for lookups, the owners only for lifetime
+  std::vector<T*> mObjects;
+  std::vector<std::shared_ptr<T>> mOwners;
+  std::vector<uint32_t> mGenerations;
+  std::vector<uint32_t> mFreeSlots;
+  uint64_t mVersion = 0;
+};
+
+// The pools everything the renderer draws is looked up in.
+class ResourceManager {
+ public:
+  static ResourceManager& Get();
+
+  ResourcePool<Mesh>& GetMeshes() { return mMeshes; }
+  const ResourcePool<Mesh>& GetMeshes() const { return mMeshes; }
+  ResourcePool<VertexArray>& GetVertexArrays() { return mVertexArrays; }
+  const ResourcePool<VertexArray>& GetVertexArrays() const {
+    return mVertexArrays;
+  }
+  ResourcePool<Shader>& GetShaders() { return mShaders; }
+  const ResourcePool<Shader>& GetShaders() const { return mShaders; }
+
+  // drops every resource, has to run before the GL context goes
+  void Clear();
+
+ private:
+  ResourceManager() = default;
+
+  ResourcePool<Mesh> mMeshes;
+  ResourcePool<VertexArray> mVertexArrays;
+  ResourcePool<Shader> mShaders;
+};
+
+}  // namespace Peridot
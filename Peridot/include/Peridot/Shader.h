@@ -3,24 +3,33 @@
 #include <cstdint>
 #include <initializer_list>
 #include <map>
+#include <memory>
 #include <vector>
 
 #include "Peridot/RenderCalls.h"
 
 namespace Peridot {
 
-enum class ShaderType { VertexShader = 1, FragmentShader };
+enum class ShaderType { VertexShader = 1, FragmentShader, ComputeShader };
 
 struct ShaderSpecification {
   ShaderType shaderType;
   const char* filePath;
 };
 
+// for shaders the engine ships inside the library instead of as files
+struct ShaderSourceSpecification {
+  ShaderType shaderType;
+  const char* source;
+};
+
 class Shader {
  public:
   enum class State { Init, CompileError, LinkError, Success };
   static std::shared_ptr<Shader> Create(
       const std::vector<ShaderSpecification>& shaderSpec);
+  static std::shared_ptr<Shader> CreateFromSource(
+      const std::vector<ShaderSourceSpecification>& sourceSpecs);
   Shader() = default;
   ~Shader();
   State ShaderState() const { return mShaderState; }
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+#include "Peridot/Buffer.h"
+#include "Peridot/Camera.h"
+#include "Peridot/Shader.h"
+
+namespace Peridot {
+
+// Cascaded shadow maps for one directional light, all cascades layers of a
+// Depth32F array texture.
+//
+// Splits blend a logarithmic and a uniform split of the camera's depth
+// range up to the shadow distance. Each cascade covers the bounding sphere
+// of its slice of the view frustum, which doesn't change size as the
+// camera turns, and its center is snapped to whole texels in light space,
+// so shadow edges don't shimmer while the camera moves.
+//
+// The last cascades are cached: their static casters are rendered into a
+// layer of their own, a little larger than their slice, and kept until the
+// camera leaves the covered area, the light turns or the static casters
+// change. At most SetCachedUpdatesPerFrame of them re-render per frame, the
+// others keep their previous projection until their turn, which bounds the
+// cost of a frame. Every frame the cached depth is copied into the cascade
+// and the dynamic casters are drawn on top.
+//
+// Bind makes the result available to shaders, the sampler at texture unit
+// 3 and the matrices at uniform block 1, GetShaderSource declares both
+// together with GetShadow.
+class ShadowCascades {
+ public:
+  static constexpr uint32_t kCascadeCount = 4;
+
+  static std::shared_ptr<ShadowCascades> Create(const uint32_t resolution);
+  ShadowCascades() = default;
+  ~ShadowCascades();
+
+  // Picks splits and projections for the camera and the direction the
+  // light travels in, decides which cascades render this frame and uploads
+  // what the shaders read.
+  void Update(const Camera& camera, const glm::vec3& lightDirection);
+
+  bool NeedsRender(const uint32_t cascade) const {
+    return mCascades[cascade].render;
+  }
+  // whether the static casters of a cached cascade are drawn this frame
+  bool NeedsStaticRender(const uint32_t cascade) const {
+    return mCascades[cascade].renderStatic;
+  }
+  bool IsCached(const uint32_t cascade) const {
+    return cascade >= kCascadeCount - mCachedCount;
+  }
+  const glm::mat4& GetViewProjection(const uint32_t cascade) const {
+    return mCascades[cascade].viewProjection;
+  }
+  // texels per world unit, for picking caster LODs
+  float GetTexelDensity(const uint32_t cascade) const {
+    return mResolution / (2.0f * mCascades[cascade].radius);
+  }
+
+  // Binds the cascade's layer for depth only drawing with GetDepthShader,
+  // which takes "uMVP" and a position at location 0. Cached cascades start
+  // from their static depth, live ones from a cleared layer.
+  void BeginCascade(const uint32_t cascade) const;
+  // binds the static layer of a cached cascade the same way, call it before
+  // BeginCascade
+  void BeginStaticCascade(const uint32_t cascade) const;
+  // back to the default framebuffer, the caller restores its viewport
+  void EndRender() const;
+  void Bind() const;
+
+  // re-renders the cached cascades, the renderer calls it when its static
+  // casters change
+  void InvalidateCache() { mCacheInvalid = true; }
+
+  // how far from the camera shadows reach, 100 by default
+  void SetShadowDistance(const float distance) { mShadowDistance = distance; }
+  // 0 splits uniformly, 1 logarithmically, 0.75 by default
+  void SetSplitBlend(const float blend) { mSplitBlend = blend; }
+  // 0 to kCascadeCount - 1, 2 by default
+  void SetCachedCascadeCount(const uint32_t count);
+  void SetCachedUpdatesPerFrame(const uint32_t count) {
+    mCachedUpdatesPerFrame = count;
+  }
+
+  const Shader& GetDepthShader() const { return *mDepthShader; }
+  uint32_t GetResolution() const { return mResolution; }
+
+  // GLSL to put after the #version line of shaders sampling the shadows
+  static const char* GetShaderSource();
+
+ private:
+  struct Cascade {
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 1.0f;
+    // view distance the cascade ends at
+    float split = 0.0f;
+    bool valid = false;
+    bool render = false;
+    bool renderStatic = false;
+    // the static layer holds depth for viewProjection
+    bool hasStatic = false;
+  };
+
+  glm::mat4 BuildViewProjection(const glm::vec3& center,
+                                const float radius) const;
+
+  std::shared_ptr<Shader> mDepthShader;
+  std::shared_ptr<StorageBuffer> mParamsBuffer;
+  std::array<Cascade, kCascadeCount> mCascades;
+  glm::mat4 mCameraView = glm::mat4(1.0f);
+  glm::mat4 mLightView = glm::mat4(1.0f);
+  glm::vec3 mLightDirection = glm::vec3(0.0f);
+  float mShadowDistance = 100.0f;
+  float mSplitBlend = 0.75f;
+  uint32_t mCachedCount = 2;
+  uint32_t mCachedUpdatesPerFrame = 1;
+  uint32_t mResolution = 0;
+  uint32_t mTexture = 0;
+  // one layer per cached cascade, cascade 0 is never cached
+  uint32_t mStaticTexture = 0;
+  uint32_t mFramebuffer = 0;
+  bool mCacheInvalid = true;
+};
+
+}  // namespace Peridot
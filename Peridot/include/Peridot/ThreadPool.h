@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Peridot {
+
+// Fixed set of worker threads for data parallel loops. The calling thread
+// joins in on its own loop, so a pool of N workers runs N + 1 wide.
+class ThreadPool {
+ public:
+  // shared pool with one worker per hardware thread minus the caller
+  static ThreadPool& Get();
+
+  explicit ThreadPool(const uint32_t workerCount);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Calls fn(begin, end) over [0, count) in batches of batchSize and returns
+  // once all of them finished. Loops are run one at a time; a ParallelFor
+  // issued from inside fn runs inline on whichever thread is running that
+  // batch, the caller included.
+  void ParallelFor(const size_t count, const size_t batchSize,
+                   const std::function<void(size_t, size_t)>& fn);
+
+  uint32_t GetWorkerCount() const {
+    return static_cast<uint32_t>(mWorkers.size());
+  }
+
+ private:
+  void WorkerLoop();
+  void RunBatches(const std::function<void(size_t, size_t)>& fn,
+                  const size_t count, const size_t batchSize);
+
+  std::vector<std::thread> mWorkers;
+  std::mutex mSubmitMutex;
+  std::mutex mMutex;
+  std::condition_variable mWakeWorkers;
+  std::condition_variable mJobDone;
+
+  // current loop, written under mMutex before the generation bump and
+  // copied by workers under it; null once the caller saw the loop finish
+  const std::function<void(size_t, size_t)>* mJob = nullptr;
+  size_t mCount = 0;
+  size_t mBatchSize = 1;
+  std::atomic<size_t> mNextIndex{0};
+  std::atomic<size_t> mPendingBatches{0};
+  uint64_t mGeneration = 0;
+  uint32_t mActiveWorkers = 0;
+  bool mStopping = false;
+};
+
+}  // namespace Peridot
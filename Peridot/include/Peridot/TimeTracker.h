@@ -1,14 +1,25 @@
 #pragma once
 
+#include <chrono>
+
 namespace Peridot {
+// Frame clock on top of steady_clock. Times are kept as time points and only
+// converted to double seconds on read, so precision does not degrade however
+// long the process runs.
 class TimeTracker {
  public:
+  using Clock = std::chrono::steady_clock;
+
   TimeTracker();
   void Update();
-  float Delta();
+  // seconds between the last two calls to Update
+  double Delta() const;
+  // seconds since construction, as of the last call to Update
+  double Elapsed() const;
 
  private:
-  float mCurrentTime = 0.0f;
-  float mPreviousTime = 0.0f;
+  Clock::time_point mStartTime;
+  Clock::time_point mCurrentTime;
+  Clock::time_point mPreviousTime;
 };
-}  // namespace Peridot
\ No newline at end of file
+}  // namespace Peridot
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Peridot {
+
+// Scene graph transforms kept in flat arrays sorted by depth, so every
+// parent sits before its children and world matrices are computed in one
+// linear pass. Nodes are addressed by ids that stay valid until destroyed.
+// Only nodes whose local transform changed, or whose parent's world matrix
+// changed, are recomputed; static subtrees cost a flag check per node.
+class TransformHierarchy {
+ public:
+  static constexpr uint32_t kNullNode = std::numeric_limits<uint32_t>::max();
+
+  TransformHierarchy() = default;
+
+  uint32_t Create(const uint32_t parent = kNullNode);
+  // destroys the node along with all of its descendants, invalid nodes are
+  // ignored
+  void Destroy(const uint32_t node);
+  void Clear();
+  // Fails when parent is the node itself or one of its descendants.
+  bool SetParent(const uint32_t node, const uint32_t parent);
+  uint32_t GetParent(const uint32_t node) const;
+  size_t GetNodeCount() const { return mHandles.size(); }
+  // false for kNullNode and destroyed nodes
+  bool IsValid(const uint32_t node) const {
+    return node < mDenseIndex.size() && mDenseIndex[node] != kNullNode;
+  }
+
+  // Local transform relative to the parent. Rotation is euler angles in
+  // radians applied as Rz * Ry * Rx, like the cameras.
+  void SetPosition(const uint32_t node, const glm::vec3& position);
+  void SetRotation(const uint32_t node, const glm::vec3& rotation);
+  void SetScale(const uint32_t node, const glm::vec3& scale);
+  const glm::vec3& GetPosition(const uint32_t node) const {
+    return mPosition[mDenseIndex[node]];
+  }
+  const glm::vec3& GetRotation(const uint32_t node) const {
+    return mRotation[mDenseIndex[node]];
+  }
+  const glm::vec3& GetScale(const uint32_t node) const {
+    return mScale[mDenseIndex[node]];
+  }
+
+  // matrices as of the last Update
+  const glm::mat4& GetLocalMatrix(const uint32_t node) const {
+    return mLocal[mDenseIndex[node]];
+  }
+  const glm::mat4& GetWorldMatrix(const uint32_t node) const {
+    return mWorld[mDenseIndex[node]];
+  }
+  // true when the last Update changed the node's world matrix
+  bool WasUpdated(const uint32_t node) const {
+    return mUpdated[mDenseIndex[node]] != 0;
+  }
+
+  // Recomputes changed local and world matrices. Large levels are spread
+  // over the shared ThreadPool, levels themselves run in order.
+  void Update();
+
+ private:
+  void SortByDepth();
+  void MarkDirty(const uint32_t node) { mDirty[mDenseIndex[node]] = 1; }
+  void UpdateRange(const size_t begin, const size_t end);
+
+  // id to dense index and back
+  std::vector<uint32_t> mDenseIndex;
+  std::vector<uint32_t> mHandles;
+  std::vector<uint32_t> mFreeHandles;
+
+  // dense, parent indices point into the same arrays
+  std::vector<uint32_t> mParent;
+  std::vector<glm::vec3> mPosition;
+  std::vector<glm::vec3> mRotation;
+  std::vector<glm::vec3> mScale;
+  std::vector<glm::mat4> mLocal;
+  std::vector<glm::mat4> mWorld;
+  std::vector<uint8_t> mDirty;
+  std::vector<uint8_t> mUpdated;
+
+  // first dense index of every depth, plus one past the end
+  std::vector<size_t> mLevelOffsets;
+  bool mNeedsSort = false;
+};
+
+}  // namespace Peridot
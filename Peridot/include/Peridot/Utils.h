@@ -23,9 +23,39 @@ enum class Type {
   Vec4,
   Mat3x3,
   Mat4x3,
-  Mat4x4
+  Mat4x4,
+  // Compact attribute formats, pair the integer ones with
+  // BufferElement::normalized to read them as [0, 1] or [-1, 1] floats.
+  // glm/gtc/packing.hpp has the matching pack functions.
+  Vec2h,
+  Vec3h,
+  Vec4h,
+  Vec4b,
+  Vec4ub,
+  Vec2s,
+  Vec4s,
+  Vec2us,
+  Vec4us,
+  // xyz 10 bits each, w 2 bits, in one 32-bit word
+  Packed1010102,
+  PackedU1010102
 };
 
+// width of the values in an element buffer
+enum class IndexType { UInt8, UInt16, UInt32 };
+
+inline constexpr size_t IndexSizeInBytes(const IndexType indexType) {
+  switch (indexType) {
+    case IndexType::UInt8:
+      return 1ULL;
+    case IndexType::UInt16:
+      return 2ULL;
+    case IndexType::UInt32:
+    default:
+      return 4ULL;
+  }
+}
+
 inline constexpr const char* TypeName(const Type elementType) {
   switch (elementType) {
     case Peridot::Utils::Type::None:
@@ -60,6 +90,28 @@ inline constexpr const char* TypeName(const Type elementType) {
       return "Type::Mat4x3";
     case Peridot::Utils::Type::Mat4x4:
       return "Type::Mat4x4";
+    case Peridot::Utils::Type::Vec2h:
+      return "Type::Vec2h";
+    case Peridot::Utils::Type::Vec3h:
+      return "Type::Vec3h";
+    case Peridot::Utils::Type::Vec4h:
+      return "Type::Vec4h";
+    case Peridot::Utils::Type::Vec4b:
+      return "Type::Vec4b";
+    case Peridot::Utils::Type::Vec4ub:
+      return "Type::Vec4ub";
+    case Peridot::Utils::Type::Vec2s:
+      return "Type::Vec2s";
+    case Peridot::Utils::Type::Vec4s:
+      return "Type::Vec4s";
+    case Peridot::Utils::Type::Vec2us:
+      return "Type::Vec2us";
+    case Peridot::Utils::Type::Vec4us:
+      return "Type::Vec4us";
+    case Peridot::Utils::Type::Packed1010102:
+      return "Type::Packed1010102";
+    case Peridot::Utils::Type::PackedU1010102:
+      return "Type::PackedU1010102";
     default:
       return "InvalidType";
   }
@@ -71,9 +123,21 @@ inline constexpr size_t SizeInBytes(const Type elementType) {
     case Type::Bool:
     case Type::Int:
     case Type::Float:
+    case Type::Vec2h:
+    case Type::Vec4b:
+    case Type::Vec4ub:
+    case Type::Vec2s:
+    case Type::Vec2us:
+    case Type::Packed1010102:
+    case Type::PackedU1010102:
       return 4ULL;
+    case Type::Vec3h:
+      return 6ULL;
     case Type::Vec2:
     case Type::Vec2i:
+    case Type::Vec4h:
+    case Type::Vec4s:
+    case Type::Vec4us:
       return 8ULL;
     case Type::Vec3:
     case Type::Vec3i:
@@ -106,12 +170,23 @@ inline constexpr size_t TypeSize(const Type elementType) {
       return 1ULL;
     case Type::Vec2:
     case Type::Vec2i:
+    case Type::Vec2h:
+    case Type::Vec2s:
+    case Type::Vec2us:
       return 2ULL;
     case Type::Vec3:
     case Type::Vec3i:
+    case Type::Vec3h:
       return 3ULL;
     case Type::Vec4:
     case Type::Vec4i:
+    case Type::Vec4h:
+    case Type::Vec4b:
+    case Type::Vec4ub:
+    case Type::Vec4s:
+    case Type::Vec4us:
+    case Type::Packed1010102:
+    case Type::PackedU1010102:
       return 4ULL;
     case Type::Mat3x3:
     case Type::Mat3x3i:
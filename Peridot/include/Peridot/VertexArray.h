@@ -2,7 +2,8 @@
 
 #include <cstdint>
 #include <memory>
-#include <unordered_set>
+#include <unordered_map>
+#include <vector>
 
 #include "Peridot/Buffer.h"
 
@@ -11,21 +12,58 @@ namespace Peridot {
 class VertexArray {
  public:
   static std::shared_ptr<VertexArray> Create();
+  // Only the attribute format of format on binding 0, buffers are bound
+  // per draw with BindBuffers. See VertexArrayCache.
+  static std::shared_ptr<VertexArray> Create(const BufferLayout& format);
   VertexArray() = default;
   void AddVertexBuffer(const std::shared_ptr<VertexBuffer>& vertexBuffer);
   void RemoveVertexBuffer(const std::shared_ptr<VertexBuffer>& vertexBuffer);
   void SetElementBuffer(const std::shared_ptr<ElementBuffer>& elementBuffer);
   void UnsetElementBuffer();
+  const std::shared_ptr<ElementBuffer>& GetElementBuffer() const {
+    return mElementBuffer;
+  }
   void Bind() const;
   void Unbind() const;
+  // Points binding 0 at vertexBuffer and sets the element buffer, the
+  // vertex array has to be bound. Meant for format only vertex arrays.
+  void BindBuffers(const StorageBuffer& vertexBuffer,
+                   const StorageBuffer& elementBuffer) const;
+  const BufferLayout& GetFormat() const { return mFormat; }
   ~VertexArray();
 
  private:
-  // probably hash function should assert be equal for different
-  // shader_ptr's pointing to the same VertexBuffer
-  std::unordered_set<std::shared_ptr<VertexBuffer>> mVertexBuffers;
+  void SetFormat(const uint32_t binding, const BufferLayout& layout);
+
+  // indexed by binding point, null once removed
+  std::vector<std::shared_ptr<VertexBuffer>> mVertexBuffers;
   std::shared_ptr<ElementBuffer> mElementBuffer;
   uint32_t mRendererId = 0;
+  uint32_t mBindingCount = 0;
+  uint32_t mAttributeCount = 0;
+  // layout of binding 0 for format only vertex arrays
+  BufferLayout mFormat;
+};
+
+// Hands out one format only vertex array per distinct layout. Meshes with
+// the same layout share it and only swap their buffers in, which keeps
+// vertex array switches down to one per layout. Layouts compare by
+// BufferLayout::operator==, attribute names don't matter. Like everything
+// GL, only use it from the thread owning the context.
+class VertexArrayCache {
+ public:
+  static VertexArrayCache& Get();
+
+  std::shared_ptr<VertexArray> Acquire(const BufferLayout& layout);
+  size_t GetSize() const;
+  // drops the cache's references, has to run before the GL context goes
+  void Clear();
+
+ private:
+  VertexArrayCache() = default;
+
+  std::unordered_map<size_t, std::vector<std::shared_ptr<VertexArray>>>
+      mVertexArrays;
 };
 
-}  // namespace Renderer
\ No newline at end of file
+}  // namespace Peridot
\ No newline at end of file
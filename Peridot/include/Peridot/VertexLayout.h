@@ -0,0 +1,228 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include "Peridot/Buffer.h"
+#include "Peridot/Utils.h"
+
+namespace Peridot {
+
+// Storage for the compact attribute types glm has no vector type for, fill
+// them with glm/gtc/packing.hpp.
+struct Half2 {
+  uint16_t x = 0, y = 0;
+};
+struct Half3 {
+  uint16_t x = 0, y = 0, z = 0;
+};
+struct Half4 {
+  uint16_t x = 0, y = 0, z = 0, w = 0;
+};
+struct Packed1010102 {
+  uint32_t value = 0;
+};
+struct PackedU1010102 {
+  uint32_t value = 0;
+};
+
+// Marks an integer attribute as normalized, it reads as a float in [0, 1]
+// (unsigned) or [-1, 1] (signed). Same size and layout as T.
+template <typename T>
+struct Normalized {
+  T value;
+};
+
+// Utils::Type of a C++ attribute type.
+template <typename T>
+struct VertexAttributeTraits {
+  static_assert(sizeof(T) == 0, "unsupported vertex attribute type");
+};
+
+template <typename T>
+struct VertexAttributeTraits<Normalized<T>> : VertexAttributeTraits<T> {
+  static_assert(!std::is_floating_point<T>::value &&
+                    !std::is_same<T, glm::vec2>::value &&
+                    !std::is_same<T, glm::vec3>::value &&
+                    !std::is_same<T, glm::vec4>::value,
+                "only integer attributes can be normalized");
+  static constexpr bool kNormalized = true;
+};
+
+#define PERIDOT_VERTEX_ATTRIBUTE_TYPE(CppType, AttributeType) \
+  template <>                                                 \
+  struct VertexAttributeTraits<CppType> {                     \
+    static constexpr Utils::Type kType = AttributeType;       \
+    static constexpr bool kNormalized = false;                \
+  }
+
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(float, Utils::Type::Float);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::vec2, Utils::Type::Vec2);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::vec3, Utils::Type::Vec3);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::vec4, Utils::Type::Vec4);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(int32_t, Utils::Type::Int);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::ivec2, Utils::Type::Vec2i);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::ivec3, Utils::Type::Vec3i);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::ivec4, Utils::Type::Vec4i);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(Half2, Utils::Type::Vec2h);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(Half3, Utils::Type::Vec3h);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(Half4, Utils::Type::Vec4h);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::i8vec4, Utils::Type::Vec4b);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::u8vec4, Utils::Type::Vec4ub);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::i16vec2, Utils::Type::Vec2s);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::i16vec4, Utils::Type::Vec4s);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::u16vec2, Utils::Type::Vec2us);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(glm::u16vec4, Utils::Type::Vec4us);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(Packed1010102, Utils::Type::Packed1010102);
+PERIDOT_VERTEX_ATTRIBUTE_TYPE(PackedU1010102, Utils::Type::PackedU1010102);
+
+#undef PERIDOT_VERTEX_ATTRIBUTE_TYPE
+
+struct VertexAttribute {
+  Utils::Type type = Utils::Type::None;
+  const char* name = nullptr;
+  uint32_t offset = 0;
+  bool normalized = false;
+};
+
+// Attribute list and stride of a vertex struct, computed at compile time
+// by PERIDOT_VERTEX.
+template <size_t Count>
+struct VertexLayoutDesc {
+  std::array<VertexAttribute, Count> attributes = {};
+  uint32_t stride = 0;
+};
+
+namespace Utils {
+
+template <typename Vertex, size_t Count>
+constexpr VertexLayoutDesc<Count> MakeVertexLayout(
+    const VertexAttribute (&attributes)[Count]) {
+  static_assert(std::is_standard_layout<Vertex>::value,
+                "vertex types need a standard layout for offsetof");
+  VertexLayoutDesc<Count> desc;
+  for (size_t i = 0; i < Count; i++) {
+    desc.attributes[i] = attributes[i];
+  }
+  desc.stride = static_cast<uint32_t>(sizeof(Vertex));
+  return desc;
+}
+
+// every attribute inside the stride and no two overlapping
+template <size_t Count>
+constexpr bool IsValidVertexLayout(const VertexLayoutDesc<Count>& desc) {
+  for (size_t i = 0; i < Count; i++) {
+    const auto& a = desc.attributes[i];
+    if (a.offset + SizeInBytes(a.type) > desc.stride) {
+      return false;
+    }
+    for (size_t j = i + 1; j < Count; j++) {
+      const auto& b = desc.attributes[j];
+      if (a.offset < b.offset + SizeInBytes(b.type) &&
+          b.offset < a.offset + SizeInBytes(a.type)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace Utils
+
+// BufferLayout of a PERIDOT_VERTEX struct, built once per type.
+template <typename Vertex>
+const BufferLayout& VertexLayout() {
+  static const BufferLayout layout = [] {
+    constexpr auto desc =
+        PeridotVertexLayout(static_cast<const Vertex*>(nullptr));
+    BufferLayout result;
+    result.stride = desc.stride;
+    for (const auto& attribute : desc.attributes) {
+      BufferElement element(attribute.type, attribute.name,
+                            attribute.normalized);
+      element.offset = attribute.offset;
+      result.layout.push_back(element);
+    }
+    return result;
+  }();
+  return layout;
+}
+
+}  // namespace Peridot
+
+// The preprocessor can't loop, PERIDOT_VERTEX supports up to 16 fields.
+#define PERIDOT_EXPAND(x) x
+#define PERIDOT_FOR_EACH_1(m, t, x) m(t, x)
+#define PERIDOT_FOR_EACH_2(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_1(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_3(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_2(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_4(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_3(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_5(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_4(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_6(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_5(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_7(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_6(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_8(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_7(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_9(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_8(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_10(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_9(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_11(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_10(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_12(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_11(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_13(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_12(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_14(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_13(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_15(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_14(m, t, __VA_ARGS__))
+#define PERIDOT_FOR_EACH_16(m, t, x, ...) \
+  m(t, x), PERIDOT_EXPAND(PERIDOT_FOR_EACH_15(m, t, __VA_ARGS__))
+#define PERIDOT_PICK_17(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, \
+                        _13, _14, _15, _16, name, ...)                     \
+  name
+#define PERIDOT_FOR_EACH(m, t, ...)                                        \
+  PERIDOT_EXPAND(PERIDOT_PICK_17(                                          \
+      __VA_ARGS__, PERIDOT_FOR_EACH_16, PERIDOT_FOR_EACH_15,               \
+      PERIDOT_FOR_EACH_14, PERIDOT_FOR_EACH_13, PERIDOT_FOR_EACH_12,       \
+      PERIDOT_FOR_EACH_11, PERIDOT_FOR_EACH_10, PERIDOT_FOR_EACH_9,        \
+      PERIDOT_FOR_EACH_8, PERIDOT_FOR_EACH_7, PERIDOT_FOR_EACH_6,          \
+      PERIDOT_FOR_EACH_5, PERIDOT_FOR_EACH_4, PERIDOT_FOR_EACH_3,          \
+      PERIDOT_FOR_EACH_2, PERIDOT_FOR_EACH_1)(m, t, __VA_ARGS__))
+
+#define PERIDOT_VERTEX_FIELD(Vertex, field)                              \
+  ::Peridot::VertexAttribute {                                           \
+    ::Peridot::VertexAttributeTraits<decltype(Vertex::field)>::kType,    \
+        #field, static_cast<uint32_t>(offsetof(Vertex, field)),          \
+        ::Peridot::VertexAttributeTraits<                                \
+            decltype(Vertex::field)>::kNormalized                        \
+  }
+
+// Describes the vertex struct Vertex to Peridot::VertexLayout<Vertex>().
+// Goes right after the struct, in the same namespace. Fields become
+// attributes 0, 1, ... in the order listed, an unsupported field type or
+// overlapping fields fail to compile.
+//
+//   struct MyVertex {
+//     glm::vec3 position;
+//     Peridot::Normalized<glm::u8vec4> color;
+//   };
+//   PERIDOT_VERTEX(MyVertex, position, color);
+#define PERIDOT_VERTEX(Vertex, ...)                                     \
+  constexpr auto PeridotVertexLayout(const Vertex*) {                   \
+    return ::Peridot::Utils::MakeVertexLayout<Vertex>(                  \
+        {PERIDOT_FOR_EACH(PERIDOT_VERTEX_FIELD, Vertex, __VA_ARGS__)}); \
+  }                                                                     \
+  static_assert(::Peridot::Utils::IsValidVertexLayout(                  \
+                    PeridotVertexLayout(static_cast<const Vertex*>(0))), \
+                "overlapping or out of bounds attributes in " #Vertex)
@@ -5,26 +5,81 @@
 #include <spdlog/spdlog.h>
 
 #include "Peridot/Buffer.h"
+#include "Peridot/RenderStats.h"
+
+// core in GL 4.6, same value as GL_PARAMETER_BUFFER_ARB
+#ifndef GL_PARAMETER_BUFFER
+#define GL_PARAMETER_BUFFER 0x80EE
+#endif
 
 namespace Peridot {
 
-BufferElement::BufferElement(const Utils::Type elementType_, const char* name_)
+namespace Utils {
+
+static GLenum GLBufferTarget(const BufferTarget target) {
+  switch (target) {
+    case BufferTarget::ShaderStorage:
+      return GL_SHADER_STORAGE_BUFFER;
+    case BufferTarget::Uniform:
+      return GL_UNIFORM_BUFFER;
+    case BufferTarget::DrawIndirect:
+      return GL_DRAW_INDIRECT_BUFFER;
+    case BufferTarget::Parameter:
+      return GL_PARAMETER_BUFFER;
+    case BufferTarget::CopyRead:
+      return GL_COPY_READ_BUFFER;
+    case BufferTarget::CopyWrite:
+      return GL_COPY_WRITE_BUFFER;
+    default:
+      assert(false && "Invalid buffer target");
+      return GL_NONE;
+  }
+  return GL_NONE;
+}
+
+}  // namespace Utils
+
+BufferElement::BufferElement(const Utils::Type elementType_, const char* name_,
+                             const bool normalized_)
     : elementType(elementType_),
       name(name_),
       sizeInBytes(Utils::SizeInBytes(elementType_)),
-      offset(0) {}
+      offset(0),
+      normalized(normalized_) {}
 
 BufferLayout::BufferLayout(
     const std::initializer_list<BufferElement>& layout_) {
   layout = std::vector<BufferElement>(layout_.begin(), layout_.end());
-  spdlog::trace(__FUNCTION__ " Creating buffer layout");
   for (auto& item : layout) {
     item.offset = stride;
     stride += item.sizeInBytes;
-    spdlog::trace("item type: {}, offset: {}",
-                  Utils::TypeName(item.elementType), item.offset);
   }
-  spdlog::info("layout stride: {}", stride);
+}
+
+bool BufferLayout::operator==(const BufferLayout& other) const {
+  if (stride != other.stride || layout.size() != other.layout.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < layout.size(); i++) {
+    const auto& a = layout[i];
+    const auto& b = other.layout[i];
+    if (a.elementType != b.elementType || a.offset != b.offset ||
+        a.normalized != b.normalized) {
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t BufferLayout::Hash() const {
+  uint64_t hash = stride;
+  for (const auto& item : layout) {
+    uint64_t key = static_cast<uint64_t>(item.elementType) |
+                   static_cast<uint64_t>(item.offset) << 8 |
+                   static_cast<uint64_t>(item.normalized) << 40;
+    hash = (hash ^ key) * 0x100000001B3ull;
+  }
+  return static_cast<size_t>(hash ^ (hash >> 32));
 }
 
 std::shared_ptr<VertexBuffer> VertexBuffer::Create(const float* vertices,
@@ -33,12 +88,17 @@ std::shared_ptr<VertexBuffer> VertexBuffer::Create(const float* vertices,
   glGenBuffers(1, &buffer->mRendererId);
   glBindBuffer(GL_ARRAY_BUFFER, buffer->mRendererId);
   glBufferData(GL_ARRAY_BUFFER, sizeInBytes, vertices, GL_STATIC_DRAW);
+  RenderStats::RecordObjectCreated(RenderStats::Object::Buffer);
+  RenderStats::RecordBufferUpload(sizeInBytes);
   spdlog::trace(__FUNCTION__ " creating handle: {}", buffer->mRendererId);
   return buffer;
 }
 
 VertexBuffer::~VertexBuffer() {
   spdlog::trace(__FUNCTION__ " destroying handle: {}", mRendererId);
+  if (mRendererId != 0) {
+    RenderStats::RecordObjectDestroyed(RenderStats::Object::Buffer);
+  }
   glDeleteBuffers(1, &mRendererId);
 }
 
@@ -46,18 +106,104 @@ void VertexBuffer::Bind() const { glBindBuffer(GL_ARRAY_BUFFER, mRendererId); }
 
 void VertexBuffer::Unbind() const { glBindBuffer(GL_ARRAY_BUFFER, 0); }
 
+std::shared_ptr<StorageBuffer> StorageBuffer::Create(const void* data,
+                                                     const size_t sizeInBytes) {
+  auto buffer = std::make_shared<StorageBuffer>();
+  glGenBuffers(1, &buffer->mRendererId);
+  buffer->mSizeInBytes = sizeInBytes;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer->mRendererId);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeInBytes, data, GL_DYNAMIC_DRAW);
+  RenderStats::RecordObjectCreated(RenderStats::Object::Buffer);
+  if (data) {
+    RenderStats::RecordBufferUpload(sizeInBytes);
+  }
+  spdlog::trace(__FUNCTION__ " creating handle: {}", buffer->mRendererId);
+  return buffer;
+}
+
+StorageBuffer::~StorageBuffer() {
+  spdlog::trace(__FUNCTION__ " destroying handle: {}", mRendererId);
+  if (mRendererId != 0) {
+    RenderStats::RecordObjectDestroyed(RenderStats::Object::Buffer);
+  }
+  glDeleteBuffers(1, &mRendererId);
+}
+
+void StorageBuffer::SetData(const void* data, const size_t sizeInBytes,
+                            const size_t offset) {
+  assert(offset + sizeInBytes <= mSizeInBytes);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mRendererId);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, offset, sizeInBytes, data);
+  RenderStats::RecordBufferUpload(sizeInBytes);
+}
+
+void StorageBuffer::Resize(const size_t sizeInBytes) {
+  mSizeInBytes = sizeInBytes;
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mRendererId);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeInBytes, nullptr, GL_DYNAMIC_DRAW);
+}
+
+void StorageBuffer::CopyData(const StorageBuffer& source,
+                             const size_t readOffset,
+                             const size_t writeOffset,
+                             const size_t sizeInBytes) {
+  assert(readOffset + sizeInBytes <= source.mSizeInBytes);
+  assert(writeOffset + sizeInBytes <= mSizeInBytes);
+  glBindBuffer(GL_COPY_READ_BUFFER, source.mRendererId);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mRendererId);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, readOffset,
+                      writeOffset, sizeInBytes);
+}
+
+void StorageBuffer::Bind(const BufferTarget target) const {
+  glBindBuffer(Utils::GLBufferTarget(target), mRendererId);
+}
+
+void StorageBuffer::BindBase(const BufferTarget target,
+                             const uint32_t index) const {
+  assert(target == BufferTarget::ShaderStorage ||
+         target == BufferTarget::Uniform);
+  glBindBufferBase(Utils::GLBufferTarget(target), index, mRendererId);
+}
+
+void StorageBuffer::Unbind(const BufferTarget target) const {
+  glBindBuffer(Utils::GLBufferTarget(target), 0);
+}
+
 std::shared_ptr<ElementBuffer> ElementBuffer::Create(const uint32_t* indices,
                                                      const size_t sizeInBytes) {
+  return Create(indices, sizeInBytes, Utils::IndexType::UInt32);
+}
+
+std::shared_ptr<ElementBuffer> ElementBuffer::Create(const uint16_t* indices,
+                                                     const size_t sizeInBytes) {
+  return Create(indices, sizeInBytes, Utils::IndexType::UInt16);
+}
+
+std::shared_ptr<ElementBuffer> ElementBuffer::Create(const uint8_t* indices,
+                                                     const size_t sizeInBytes) {
+  return Create(indices, sizeInBytes, Utils::IndexType::UInt8);
+}
+
+std::shared_ptr<ElementBuffer> ElementBuffer::Create(
+    const void* indices, const size_t sizeInBytes,
+    const Utils::IndexType indexType) {
   auto buffer = std::make_shared<ElementBuffer>();
+  buffer->mIndexType = indexType;
   glGenBuffers(1, &buffer->mRendererId);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->mRendererId);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeInBytes, indices, GL_STATIC_DRAW);
+  RenderStats::RecordObjectCreated(RenderStats::Object::Buffer);
+  RenderStats::RecordBufferUpload(sizeInBytes);
   spdlog::trace(__FUNCTION__ " creating handle: {}", buffer->mRendererId);
   return buffer;
 }
 
 ElementBuffer::~ElementBuffer() {
   spdlog::trace(__FUNCTION__ " destroying handle: {}", mRendererId);
+  if (mRendererId != 0) {
+    RenderStats::RecordObjectDestroyed(RenderStats::Object::Buffer);
+  }
   glDeleteBuffers(1, &mRendererId);
 }
 
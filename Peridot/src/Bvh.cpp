@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+#include <queue>
+
+#include "Peridot/Bvh.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr uint32_t kSahBins = 12;
+
+// Slab test. An axis the ray runs parallel to doesn't bound the distance,
+// the ray is inside its slab or never enters it; the inverse direction is
+// infinite there and would turn an origin on a box face into NaN.
+static bool IntersectRayAABB(const Ray& ray, const glm::vec3& inverseDirection,
+                             const AABB& box, const float maxDistance,
+                             float& entryDistance) {
+  float tEnter = 0.0f;
+  float tExit = std::numeric_limits<float>::infinity();
+  for (int axis = 0; axis < 3; axis++) {
+    if (ray.direction[axis] == 0.0f) {
+      if (ray.origin[axis] < box.min[axis] ||
+          ray.origin[axis] > box.max[axis]) {
+        return false;
+      }
+      continue;
+    }
+    float t1 = (box.min[axis] - ray.origin[axis]) * inverseDirection[axis];
+    float t2 = (box.max[axis] - ray.origin[axis]) * inverseDirection[axis];
+    tEnter = std::max(tEnter, std::min(t1, t2));
+    tExit = std::min(tExit, std::max(t1, t2));
+  }
+  if (tExit < tEnter || tEnter > maxDistance) {
+    return false;
+  }
+  entryDistance = tEnter;
+  return true;
+}
+
+static bool IntersectsSphere(const AABB& box, const BoundingSphere& sphere) {
+  glm::vec3 closest = glm::clamp(sphere.center, box.min, box.max);
+  glm::vec3 offset = closest - sphere.center;
+  return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+}
+
+}  // namespace Utils
+
+std::vector<uint32_t> Bvh::Build(const std::vector<AABB>& bounds,
+                                 const std::vector<uint32_t>& userData) {
+  assert(bounds.size() == userData.size());
+  Clear();
+  mNodes.reserve(bounds.size() * 2);
+
+  std::vector<uint32_t> proxies(bounds.size());
+  for (size_t i = 0; i < bounds.size(); i++) {
+    uint32_t leaf = AllocateNode();
+    mNodes[leaf].bounds = bounds[i];
+    mNodes[leaf].userData = userData[i];
+    proxies[i] = leaf;
+  }
+  mLeafCount = bounds.size();
+
+  if (!proxies.empty()) {
+    std::vector<uint32_t> leaves = proxies;
+    mRoot = BuildRange(leaves, 0, leaves.size());
+    mNodes[mRoot].parent = kNullNode;
+  }
+  return proxies;
+}
+
+void Bvh::Clear() {
+  mNodes.clear();
+  mRoot = kNullNode;
+  mFreeList = kNullNode;
+  mLeafCount = 0;
+}
+
+uint32_t Bvh::BuildRange(std::vector<uint32_t>& leaves, const size_t begin,
+                         const size_t end) {
+  if (end - begin == 1) {
+    return leaves[begin];
+  }
+
+  AABB centroidBounds{glm::vec3(std::numeric_limits<float>::max()),
+                      glm::vec3(std::numeric_limits<float>::lowest())};
+  for (size_t i = begin; i < end; i++) {
+    auto center = mNodes[leaves[i]].bounds.Center();
+    centroidBounds.min = glm::min(centroidBounds.min, center);
+    centroidBounds.max = glm::max(centroidBounds.max, center);
+  }
+
+  glm::vec3 size = centroidBounds.max - centroidBounds.min;
+  int axis = 0;
+  if (size.y > size[axis]) {
+    axis = 1;
+  }
+  if (size.z > size[axis]) {
+    axis = 2;
+  }
+
+  size_t middle = begin + (end - begin) / 2;
+  if (size[axis] > 0.0f) {
+    // binned SAH: bucket centroids along the widest axis and pick the bucket
+    // boundary minimizing count * area on both sides
+    struct Bin {
+      AABB bounds;
+      uint32_t count = 0;
+    };
+    std::array<Bin, Utils::kSahBins> bins;
+    float scale = Utils::kSahBins / size[axis];
+    auto binIndex = [&](uint32_t leaf) {
+      float offset = mNodes[leaf].bounds.Center()[axis] - centroidBounds.min[axis];
+      return std::min(Utils::kSahBins - 1, static_cast<uint32_t>(offset * scale));
+    };
+
+    for (size_t i = begin; i < end; i++) {
+      auto& bin = bins[binIndex(leaves[i])];
+      const auto& leafBounds = mNodes[leaves[i]].bounds;
+      bin.bounds = bin.count == 0 ? leafBounds : AABB::Union(bin.bounds, leafBounds);
+      bin.count += 1;
+    }
+
+    std::array<float, Utils::kSahBins - 1> leftCost;
+    AABB accumulated;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < Utils::kSahBins - 1; i++) {
+      if (bins[i].count > 0) {
+        accumulated = count == 0 ? bins[i].bounds
+                                 : AABB::Union(accumulated, bins[i].bounds);
+        count += bins[i].count;
+      }
+      leftCost[i] = count == 0 ? 0.0f : count * accumulated.SurfaceArea();
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    uint32_t bestSplit = 0;
+    count = 0;
+    for (uint32_t i = Utils::kSahBins - 1; i > 0; i--) {
+      if (bins[i].count > 0) {
+        accumulated = count == 0 ? bins[i].bounds
+                                 : AABB::Union(accumulated, bins[i].bounds);
+        count += bins[i].count;
+      }
+      float cost = leftCost[i - 1] +
+                   (count == 0 ? 0.0f : count * accumulated.SurfaceArea());
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestSplit = i;
+      }
+    }
+
+    auto split = std::partition(
+        leaves.begin() + begin, leaves.begin() + end,
+        [&](uint32_t leaf) { return binIndex(leaf) < bestSplit; });
+    middle = static_cast<size_t>(split - leaves.begin());
+  }
+
+  // all centroids in one bin or coincident, fall back to a median split
+  if (middle == begin || middle == end) {
+    middle = begin + (end - begin) / 2;
+    std::nth_element(leaves.begin() + begin, leaves.begin() + middle,
+                     leaves.begin() + end, [&](uint32_t a, uint32_t b) {
+                       return mNodes[a].bounds.Center()[axis] <
+                              mNodes[b].bounds.Center()[axis];
+                     });
+  }
+
+  uint32_t left = BuildRange(leaves, begin, middle);
+  uint32_t right = BuildRange(leaves, middle, end);
+  uint32_t node = AllocateNode();
+  mNodes[node].left = left;
+  mNodes[node].right = right;
+  mNodes[node].bounds = AABB::Union(mNodes[left].bounds, mNodes[right].bounds);
+  mNodes[left].parent = node;
+  mNodes[right].parent = node;
+  return node;
+}
+
+uint32_t Bvh::AllocateNode() {
+  if (mFreeList != kNullNode) {
+    uint32_t node = mFreeList;
+    mFreeList = mNodes[node].parent;
+    mNodes[node] = Node{};
+    return node;
+  }
+  mNodes.emplace_back();
+  return static_cast<uint32_t>(mNodes.size() - 1);
+}
+
+void Bvh::FreeNode(const uint32_t node) {
+  mNodes[node] = Node{};
+  // free nodes chain through their parent link
+  mNodes[node].parent = mFreeList;
+  mFreeList = node;
+}
+
+uint32_t Bvh::Insert(const AABB& bounds, const uint32_t userData) {
+  uint32_t leaf = AllocateNode();
+  mNodes[leaf].bounds = bounds;
+  mNodes[leaf].userData = userData;
+  InsertLeaf(leaf);
+  mLeafCount += 1;
+  return leaf;
+}
+
+void Bvh::Remove(const uint32_t proxy) {
+  assert(mNodes[proxy].IsLeaf());
+  RemoveLeaf(proxy);
+  FreeNode(proxy);
+  mLeafCount -= 1;
+}
+
+void Bvh::Update(const uint32_t proxy, const AABB& bounds) {
+  assert(mNodes[proxy].IsLeaf());
+  mNodes[proxy].bounds = bounds;
+  RefitAncestors(mNodes[proxy].parent);
+}
+
+uint32_t Bvh::FindBestSibling(const AABB& bounds) const {
+  // branch and bound over the SAH cost of placing the new leaf next to each
+  // candidate, children are only explored while they could still beat the
+  // best cost found
+  struct Candidate {
+    uint32_t node;
+    float inheritedCost;
+    bool operator<(const Candidate& other) const {
+      return inheritedCost > other.inheritedCost;
+    }
+  };
+
+  const float leafArea = bounds.SurfaceArea();
+  uint32_t best = mRoot;
+  float bestCost = AABB::Union(mNodes[mRoot].bounds, bounds).SurfaceArea();
+
+  std::priority_queue<Candidate> candidates;
+  candidates.push({mRoot, 0.0f});
+  while (!candidates.empty()) {
+    auto candidate = candidates.top();
+    candidates.pop();
+    const auto& node = mNodes[candidate.node];
+
+    float unionArea = AABB::Union(node.bounds, bounds).SurfaceArea();
+    float cost = unionArea + candidate.inheritedCost;
+    if (cost < bestCost) {
+      bestCost = cost;
+      best = candidate.node;
+    }
+
+    if (node.IsLeaf()) {
+      continue;
+    }
+    float childInherited =
+        candidate.inheritedCost + unionArea - node.bounds.SurfaceArea();
+    if (leafArea + childInherited < bestCost) {
+      candidates.push({node.left, childInherited});
+      candidates.push({node.right, childInherited});
+    }
+  }
+  return best;
+}
+
+void Bvh::InsertLeaf(const uint32_t leaf) {
+  if (mRoot == kNullNode) {
+    mRoot = leaf;
+    mNodes[leaf].parent = kNullNode;
+    return;
+  }
+
+  uint32_t sibling = FindBestSibling(mNodes[leaf].bounds);
+  uint32_t oldParent = mNodes[sibling].parent;
+  uint32_t newParent = AllocateNode();
+
+  mNodes[newParent].parent = oldParent;
+  mNodes[newParent].left = sibling;
+  mNodes[newParent].right = leaf;
+  mNodes[newParent].bounds =
+      AABB::Union(mNodes[sibling].bounds, mNodes[leaf].bounds);
+  mNodes[sibling].parent = newParent;
+  mNodes[leaf].parent = newParent;
+
+  if (oldParent == kNullNode) {
+    mRoot = newParent;
+  } else if (mNodes[oldParent].left == sibling) {
+    mNodes[oldParent].left = newParent;
+  } else {
+    mNodes[oldParent].right = newParent;
+  }
+  RefitAncestors(oldParent);
+}
+
+void Bvh::RemoveLeaf(const uint32_t leaf) {
+  if (leaf == mRoot) {
+    mRoot = kNullNode;
+    return;
+  }
+
+  uint32_t parent = mNodes[leaf].parent;
+  uint32_t grandParent = mNodes[parent].parent;
+  uint32_t sibling = mNodes[parent].left == leaf ? mNodes[parent].right
+                                                 : mNodes[parent].left;
+
+  mNodes[sibling].parent = grandParent;
+  if (grandParent == kNullNode) {
+    mRoot = sibling;
+  } else if (mNodes[grandParent].left == parent) {
+    mNodes[grandParent].left = sibling;
+  } else {
+    mNodes[grandParent].right = sibling;
+  }
+  FreeNode(parent);
+  RefitAncestors(grandParent);
+}
+
+void Bvh::RefitAncestors(uint32_t node) {
+  while (node != kNullNode) {
+    auto& current = mNodes[node];
+    current.bounds =
+        AABB::Union(mNodes[current.left].bounds, mNodes[current.right].bounds);
+    node = current.parent;
+  }
+}
+
+void Bvh::Refit() {
+  if (mRoot == kNullNode) {
+    return;
+  }
+  // pre-order walk, then visit in reverse so children refit before parents
+  std::vector<uint32_t> order;
+  order.reserve(mNodes.size());
+  std::vector<uint32_t> stack = {mRoot};
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    if (mNodes[node].IsLeaf()) {
+      continue;
+    }
+    order.push_back(node);
+    stack.push_back(mNodes[node].left);
+    stack.push_back(mNodes[node].right);
+  }
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    auto& node = mNodes[*it];
+    node.bounds = AABB::Union(mNodes[node.left].bounds, mNodes[node.right].bounds);
+  }
+}
+
+float Bvh::ComputeCost() const {
+  if (mRoot == kNullNode || mNodes[mRoot].IsLeaf()) {
+    return 0.0f;
+  }
+  float rootArea = mNodes[mRoot].bounds.SurfaceArea();
+  if (rootArea <= 0.0f) {
+    return 0.0f;
+  }
+  float total = 0.0f;
+  std::vector<uint32_t> stack = {mRoot};
+  while (!stack.empty()) {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+    if (node.IsLeaf()) {
+      continue;
+    }
+    total += node.bounds.SurfaceArea();
+    stack.push_back(node.left);
+    stack.push_back(node.right);
+  }
+  return total / rootArea;
+}
+
+void Bvh::CollectLeaves(const uint32_t node,
+                        std::vector<uint32_t>& userDataOut) const {
+  std::vector<uint32_t> stack = {node};
+  while (!stack.empty()) {
+    const auto& current = mNodes[stack.back()];
+    stack.pop_back();
+    if (current.IsLeaf()) {
+      userDataOut.push_back(current.userData);
+      continue;
+    }
+    stack.push_back(current.left);
+    stack.push_back(current.right);
+  }
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum,
+                       std::vector<uint32_t>& userDataOut) const {
+  if (mRoot == kNullNode) {
+    return;
+  }
+  std::vector<uint32_t> stack = {mRoot};
+  while (!stack.empty()) {
+    uint32_t index = stack.back();
+    stack.pop_back();
+    const auto& node = mNodes[index];
+    if (!frustum.Intersects(node.bounds)) {
+      continue;
+    }
+    if (node.IsLeaf()) {
+      userDataOut.push_back(node.userData);
+      continue;
+    }
+    // whole subtree visible, skip testing anything below it
+    if (frustum.Contains(node.bounds)) {
+      CollectLeaves(index, userDataOut);
+      continue;
+    }
+    stack.push_back(node.left);
+    stack.push_back(node.right);
+  }
+}
+
+void Bvh::QueryAABB(const AABB& box, std::vector<uint32_t>& userDataOut) const {
+  if (mRoot == kNullNode) {
+    return;
+  }
+  std::vector<uint32_t> stack = {mRoot};
+  while (!stack.empty()) {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+    if (!node.bounds.Overlaps(box)) {
+      continue;
+    }
+    if (node.IsLeaf()) {
+      userDataOut.push_back(node.userData);
+      continue;
+    }
+    stack.push_back(node.left);
+    stack.push_back(node.right);
+  }
+}
+
+void Bvh::QuerySphere(const BoundingSphere& sphere,
+                      std::vector<uint32_t>& userDataOut) const {
+  if (mRoot == kNullNode) {
+    return;
+  }
+  std::vector<uint32_t> stack = {mRoot};
+  while (!stack.empty()) {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+    if (!Utils::IntersectsSphere(node.bounds, sphere)) {
+      continue;
+    }
+    if (node.IsLeaf()) {
+      userDataOut.push_back(node.userData);
+      continue;
+    }
+    stack.push_back(node.left);
+    stack.push_back(node.right);
+  }
+}
+
+Bvh::RayHit Bvh::Raycast(const Ray& ray, const float maxDistance,
+                         const RayIntersector& intersector) const {
+  RayHit result;
+  result.distance = maxDistance;
+  if (mRoot == kNullNode) {
+    return result;
+  }
+
+  glm::vec3 inverseDirection = 1.0f / ray.direction;
+  std::vector<uint32_t> stack = {mRoot};
+  while (!stack.empty()) {
+    const auto& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    float entry = 0.0f;
+    if (!Utils::IntersectRayAABB(ray, inverseDirection, node.bounds,
+                                 result.distance, entry)) {
+      continue;
+    }
+
+    if (!node.IsLeaf()) {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+      continue;
+    }
+
+    float distance = intersector ? intersector(node.userData, ray) : entry;
+    if (distance >= 0.0f && distance <= result.distance) {
+      result.hit = true;
+      result.distance = distance;
+      result.userData = node.userData;
+    }
+  }
+  return result;
+}
+
+}  // namespace Peridot
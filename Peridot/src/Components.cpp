@@ -0,0 +1,45 @@
+#include "Peridot/Components.h"
+
+namespace Peridot {
+
+MeshComponent MeshComponent::FromMesh(const Handle<Mesh> handle) {
+  MeshComponent component;
+  const auto* source = ResourceManager::Get().GetMeshes().Get(handle);
+  if (!source) {
+    return component;
+  }
+  const auto& mesh = *source;
+  component.mesh = handle;
+  component.indexCount = mesh.GetIndexCount();
+  component.bounds = mesh.GetBounds();
+  // a single LOD is the whole mesh, nothing to pick from
+  const auto lodCount = mesh.GetLods().size();
+  if (lodCount > 1) {
+    component.lodCount = static_cast<uint32_t>(lodCount);
+  }
+  return component;
+}
+
+void UpdateWorldTransforms(World& world, TransformHierarchy& hierarchy) {
+  hierarchy.Update();
+  world.ParallelEachChunk<TransformComponent>(
+      [&world, &hierarchy](const Entity* entities, size_t count,
+                           TransformComponent* transforms) {
+        bool changed = false;
+        for (size_t i = 0; i < count; i++) {
+          auto& transform = transforms[i];
+          if (!hierarchy.IsValid(transform.node) ||
+              !(transform.stale || hierarchy.WasUpdated(transform.node))) {
+            continue;
+          }
+          transform.world = hierarchy.GetWorldMatrix(transform.node);
+          transform.stale = false;
+          changed = true;
+        }
+        if (changed) {
+          world.MarkChanged(entities[0]);
+        }
+      });
+}
+
+}  // namespace Peridot
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <chrono>
 #include <cstdio>
 #include <exception>
 #include <iostream>
@@ -11,6 +12,10 @@
 // clang-format on
 
 #include "Peridot/Context.h"
+#include "Peridot/GeometryPool.h"
+#include "Peridot/Profiler.h"
+#include "Peridot/Resources.h"
+#include "Peridot/VertexArray.h"
 
 // make use of dedicated GPU on windows
 #ifdef _WIN32
@@ -63,16 +68,21 @@ std::shared_ptr<Context> Context::Create(const ContextSpecification& ctxSpec) {
     return nullptr;
   }
 
+  glfwWindowHint(GLFW_VISIBLE, ctxSpec.visible ? GLFW_TRUE : GLFW_FALSE);
+  // compute shaders, SSBOs and the engine's GLSL need 4.5 core
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   ctx->mWindow = glfwCreateWindow(ctxSpec.width, ctxSpec.height, ctxSpec.title,
                                   nullptr, nullptr);
 
-  glfwMakeContextCurrent(ctx->mWindow);
-
   if (!ctx->mWindow) {
-    spdlog::error("Failed to create window");
+    spdlog::error("Failed to create window, OpenGL 4.5 core is required");
     return nullptr;
   }
 
+  glfwMakeContextCurrent(ctx->mWindow);
+
   success = gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
 
   if (!success) {
@@ -80,6 +90,12 @@ std::shared_ptr<Context> Context::Create(const ContextSpecification& ctxSpec) {
     return nullptr;
   }
 
+  if (!GLAD_GL_VERSION_4_5) {
+    spdlog::error("OpenGL 4.5 is required, got {}",
+                  (const char*)glGetString(GL_VERSION));
+    return nullptr;
+  }
+
   glEnable(GL_DEBUG_OUTPUT);
   glDebugMessageCallback(Utils::MessageCallback, nullptr);
   glEnable(GL_DEPTH_TEST);
@@ -95,6 +111,10 @@ std::shared_ptr<Context> Context::Create(const ContextSpecification& ctxSpec) {
   ctx->currentHeight = ctxSpec.height;
   ctx->mAspectRatio = static_cast<float>(ctxSpec.width) / ctxSpec.height;
 
+  ctx->mProfiler = Profiler::Create();
+  ctx->SetVSync(ctxSpec.vsync);
+  ctx->SetMaxFrameRate(ctxSpec.maxFrameRate);
+
   glfwSetWindowUserPointer(ctx->mWindow, (void*)ctx.get());
   SetCallbacks(ctx->mWindow);
   return ctx;
@@ -102,15 +122,53 @@ std::shared_ptr<Context> Context::Create(const ContextSpecification& ctxSpec) {
 
 Context::~Context() {
   spdlog::trace(__FUNCTION__);
+  // query objects, resources, cached vertex arrays and geometry pools have
+  // to go before the GL context does
+  mProfiler = nullptr;
+  ResourceManager::Get().Clear();
+  DeletionQueue::Get().Flush();
+  GeometryPoolCache::Get().Clear();
+  VertexArrayCache::Get().Clear();
   glfwDestroyWindow(mWindow);
   glfwTerminate();
 }
 
 bool Context::ShouldRun() const { return !glfwWindowShouldClose(mWindow); }
 
+void Context::SetVSync(const VSync vsync) {
+  mVSync = vsync;
+  switch (vsync) {
+    case VSync::Off:
+      glfwSwapInterval(0);
+      break;
+    case VSync::Adaptive:
+      if (glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+          glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        glfwSwapInterval(-1);
+        break;
+      }
+      spdlog::warn("adaptive vsync not supported, using regular vsync");
+      mVSync = VSync::On;
+      glfwSwapInterval(1);
+      break;
+    case VSync::On:
+    default:
+      glfwSwapInterval(1);
+      break;
+  }
+}
+
 void Context::Update(float delta) {
-  glfwPollEvents();
+  auto swapStart = std::chrono::steady_clock::now();
   glfwSwapBuffers(mWindow);
+  mLastSwapTime = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - swapStart)
+                      .count();
+  DeletionQueue::Get().EndFrame();
+
+  // pace before polling so the next frame starts from the freshest input
+  mFrameLimiter.Wait();
+  glfwPollEvents();
 }
 
 }  // namespace Peridot
\ No newline at end of file
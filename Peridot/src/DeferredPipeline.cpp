@@ -0,0 +1,454 @@
+#include <algorithm>
+#include <string>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/DeferredPipeline.h"
+#include "Peridot/RenderCalls.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr size_t kInitialLightCapacity = 256;
+// the light volume, an icosahedron drawn from constants in the shader
+static constexpr size_t kLightVolumeVertexCount = 60;
+
+static constexpr const char* kGeometryVertexSource = R"(
+#version 450 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+
+uniform mat4 uMVP;
+uniform mat4 uModel;
+uniform mat4 uNormalMatrix;
+
+out vec3 vPosition;
+out vec3 vNormal;
+
+void main() {
+  vPosition = vec3(uModel * vec4(aPosition, 1.0));
+  vNormal = mat3(uNormalMatrix) * aNormal;
+  gl_Position = uMVP * vec4(aPosition, 1.0);
+}
+)";
+
+// GPU driven draws: one object per command, found through the command's
+// baseInstance, the model matrix and material come from the SSBO.
+static constexpr const char* kIndirectGeometryVertexSource = R"(
+#version 450 core
+#extension GL_ARB_shader_draw_parameters : require
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+
+struct Object {
+  mat4 model;
+  vec4 albedo;
+  vec4 material;
+};
+
+layout (std430, binding = 0) readonly buffer Objects {
+  Object objects[];
+};
+
+uniform mat4 uViewProjection;
+
+out vec3 vPosition;
+out vec3 vNormal;
+flat out vec4 vAlbedoRoughness;
+
+void main() {
+  Object object = objects[gl_BaseInstanceARB];
+  vec4 position = object.model * vec4(aPosition, 1.0);
+  vPosition = position.xyz;
+  vNormal = transpose(inverse(mat3(object.model))) * aNormal;
+  vAlbedoRoughness = vec4(object.albedo.rgb, object.material.x);
+  gl_Position = uViewProjection * position;
+}
+)";
+
+// where the geometry fragment shader gets the material from, uniforms for
+// regular draws and the vertex shader for GPU driven ones
+static constexpr const char* kGeometryMaterialSource = R"(
+#version 450 core
+
+uniform vec4 uAlbedo;
+uniform float uRoughness;
+
+vec4 GetAlbedoRoughness() { return vec4(uAlbedo.rgb, uRoughness); }
+)";
+
+static constexpr const char* kIndirectGeometryMaterialSource = R"(
+#version 450 core
+
+flat in vec4 vAlbedoRoughness;
+
+vec4 GetAlbedoRoughness() { return vAlbedoRoughness; }
+)";
+
+// Normals go through an octahedral mapping: the unit sphere is projected
+// onto an octahedron and the lower half folded over the diagonals into the
+// [-1, 1] square, two channels with close to uniform precision.
+static constexpr const char* kGeometryFragmentSource = R"(
+in vec3 vPosition;
+in vec3 vNormal;
+
+layout (location = 0) out vec4 oAlbedoRoughness;
+layout (location = 1) out vec2 oNormal;
+
+vec2 EncodeNormal(vec3 normal) {
+  normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+  if (normal.z < 0.0) {
+    normal.xy = (1.0 - abs(normal.yx)) *
+                vec2(normal.x >= 0.0 ? 1.0 : -1.0,
+                     normal.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return normal.xy;
+}
+
+void main() {
+  vec3 normal = vNormal;
+  // vertex arrays without normals read (0, 0, 0), shade those flat
+  if (dot(normal, normal) < 1e-12) {
+    normal = cross(dFdx(vPosition), dFdy(vPosition));
+  }
+  oAlbedoRoughness = GetAlbedoRoughness();
+  oNormal = EncodeNormal(normalize(normal));
+}
+)";
+
+static constexpr const char* kFullscreenVertexSource = R"(
+#version 450 core
+
+void main() {
+  // one triangle covering the screen
+  vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  gl_Position = vec4(position * 2.0 - 1.0, 1.0, 1.0);
+}
+)";
+
+// Shared by the lighting fragment shaders: reads the G-buffer back into a
+// surface and shades it for one light.
+static constexpr const char* kLightingCommonSource = R"(
+#version 450 core
+
+layout (binding = 0) uniform sampler2D uAlbedoRoughness;
+layout (binding = 1) uniform sampler2D uNormal;
+layout (binding = 2) uniform sampler2D uDepth;
+
+uniform mat4 uInverseViewProjection;
+uniform vec2 uViewportSize;
+uniform vec3 uCameraPosition;
+
+out vec4 oColor;
+
+struct Surface {
+  vec3 position;
+  vec3 normal;
+  vec3 albedo;
+  float roughness;
+};
+
+vec3 DecodeNormal(vec2 encoded) {
+  vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  float fold = max(-normal.z, 0.0);
+  normal.xy += vec2(normal.x >= 0.0 ? -fold : fold,
+                    normal.y >= 0.0 ? -fold : fold);
+  return normalize(normal);
+}
+
+// false where nothing was drawn
+bool LoadSurface(out Surface surface) {
+  ivec2 texel = ivec2(gl_FragCoord.xy);
+  float depth = texelFetch(uDepth, texel, 0).r;
+  if (depth >= 1.0) {
+    return false;
+  }
+  vec3 ndc = vec3(gl_FragCoord.xy / uViewportSize, depth) * 2.0 - 1.0;
+  vec4 position = uInverseViewProjection * vec4(ndc, 1.0);
+  surface.position = position.xyz / position.w;
+  surface.normal = DecodeNormal(texelFetch(uNormal, texel, 0).xy);
+  vec4 albedoRoughness = texelFetch(uAlbedoRoughness, texel, 0);
+  surface.albedo = albedoRoughness.rgb;
+  surface.roughness = albedoRoughness.a;
+  return true;
+}
+
+// Lambert diffuse and normalized Blinn-Phong specular, the exponent runs
+// from 2048 at roughness 0 down to 1
+vec3 Shade(Surface surface, vec3 toLight, vec3 radiance) {
+  float lambert = max(dot(surface.normal, toLight), 0.0);
+  if (lambert <= 0.0) {
+    return vec3(0.0);
+  }
+  vec3 toCamera = normalize(uCameraPosition - surface.position);
+  vec3 halfway = normalize(toLight + toCamera);
+  float shininess = exp2(11.0 * (1.0 - surface.roughness));
+  float specular = (shininess + 8.0) / 25.1327 *
+                   pow(max(dot(surface.normal, halfway), 0.0), shininess);
+  return (surface.albedo + vec3(0.04 * specular)) * radiance * lambert;
+}
+)";
+
+static constexpr const char* kDirectionalFragmentSource = R"(
+uniform vec3 uAmbient;
+uniform vec3 uLightDirection;
+uniform vec3 uLightColor;
+uniform int uShadows;
+
+void main() {
+  Surface surface;
+  if (!LoadSurface(surface)) {
+    discard;
+  }
+  vec3 color = surface.albedo * uAmbient;
+  if (any(greaterThan(uLightColor, vec3(0.0)))) {
+    float shadow =
+        uShadows != 0 ? GetShadow(surface.position, surface.normal) : 1.0;
+    color += shadow *
+             Shade(surface, -normalize(uLightDirection), uLightColor);
+  }
+  oColor = vec4(color, 1.0);
+}
+)";
+
+// Every instance is one light. The icosahedron's faces sit at 0.795 of its
+// circumradius, it is scaled up so they enclose the light's sphere.
+static constexpr const char* kPointLightVertexSource = R"(
+#version 450 core
+
+struct PointLight {
+  vec4 position;
+  vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Lights {
+  PointLight lights[];
+};
+
+uniform mat4 uViewProjection;
+
+flat out int vLight;
+
+const float kT = 1.6180340;
+const vec3 kVertices[12] = vec3[](
+    vec3(-1.0, kT, 0.0), vec3(1.0, kT, 0.0), vec3(-1.0, -kT, 0.0),
+    vec3(1.0, -kT, 0.0), vec3(0.0, -1.0, kT), vec3(0.0, 1.0, kT),
+    vec3(0.0, -1.0, -kT), vec3(0.0, 1.0, -kT), vec3(kT, 0.0, -1.0),
+    vec3(kT, 0.0, 1.0), vec3(-kT, 0.0, -1.0), vec3(-kT, 0.0, 1.0));
+const int kIndices[60] = int[](
+    0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+    1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+    3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+    4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1);
+const float kEnclosingScale = 1.2585;
+
+void main() {
+  PointLight light = lights[gl_InstanceID];
+  vec3 direction = normalize(kVertices[kIndices[gl_VertexID]]);
+  vec3 position =
+      light.position.xyz + direction * light.position.w * kEnclosingScale;
+  gl_Position = uViewProjection * vec4(position, 1.0);
+  vLight = gl_InstanceID;
+}
+)";
+
+static constexpr const char* kPointLightFragmentSource = R"(
+struct PointLight {
+  vec4 position;
+  vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer Lights {
+  PointLight lights[];
+};
+
+flat in int vLight;
+
+void main() {
+  Surface surface;
+  if (!LoadSurface(surface)) {
+    discard;
+  }
+  PointLight light = lights[vLight];
+  vec3 toLight = light.position.xyz - surface.position;
+  float distance = length(toLight);
+  float radius = light.position.w;
+  if (distance >= radius) {
+    discard;
+  }
+  // inverse square, windowed so it reaches zero at the radius
+  float window = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+  float attenuation = window * window / (distance * distance + 1.0);
+  oColor = vec4(Shade(surface, toLight / max(distance, 1e-4),
+                      light.color.rgb * attenuation),
+                1.0);
+}
+)";
+
+}  // namespace Utils
+
+std::shared_ptr<DeferredPipeline> DeferredPipeline::Create(
+    const uint32_t width, const uint32_t height) {
+  spdlog::trace(__FUNCTION__);
+  auto pipeline = std::make_shared<DeferredPipeline>();
+
+  FramebufferSpecification spec;
+  spec.width = std::max(1u, width);
+  spec.height = std::max(1u, height);
+  spec.colorAttachments = {TextureFormat::RGBA8, TextureFormat::RG16F};
+  spec.depthAttachment = TextureFormat::Depth24Stencil8;
+  pipeline->mGBuffer = Framebuffer::Create(spec);
+  if (!pipeline->mGBuffer) {
+    spdlog::error("failed to create G-buffer");
+    return nullptr;
+  }
+
+  const std::string directionalSource =
+      std::string(Utils::kLightingCommonSource) +
+      ShadowCascades::GetShaderSource() + Utils::kDirectionalFragmentSource;
+  const std::string pointLightSource =
+      std::string(Utils::kLightingCommonSource) +
+      Utils::kPointLightFragmentSource;
+  const std::string geometrySource =
+      std::string(Utils::kGeometryMaterialSource) +
+      Utils::kGeometryFragmentSource;
+  pipeline->mGeometryShader = Shader::CreateFromSource(
+      {{ShaderType::VertexShader, Utils::kGeometryVertexSource},
+       {ShaderType::FragmentShader, geometrySource.c_str()}});
+  pipeline->mDirectionalShader = Shader::CreateFromSource(
+      {{ShaderType::VertexShader, Utils::kFullscreenVertexSource},
+       {ShaderType::FragmentShader, directionalSource.c_str()}});
+  pipeline->mPointLightShader = Shader::CreateFromSource(
+      {{ShaderType::VertexShader, Utils::kPointLightVertexSource},
+       {ShaderType::FragmentShader, pointLightSource.c_str()}});
+  if (!pipeline->mGeometryShader || !pipeline->mDirectionalShader ||
+      !pipeline->mPointLightShader) {
+    spdlog::error("failed to build deferred shading shaders");
+    return nullptr;
+  }
+
+  // optional, GPU driven draws stay off without it
+  if (RenderCall::SupportsDrawParameters()) {
+    const std::string indirectGeometrySource =
+        std::string(Utils::kIndirectGeometryMaterialSource) +
+        Utils::kGeometryFragmentSource;
+    pipeline->mIndirectGeometryShader = Shader::CreateFromSource(
+        {{ShaderType::VertexShader, Utils::kIndirectGeometryVertexSource},
+         {ShaderType::FragmentShader, indirectGeometrySource.c_str()}});
+  }
+
+  pipeline->mEmptyVertexArray = VertexArray::Create();
+  pipeline->mLightBuffer = StorageBuffer::Create(
+      nullptr, Utils::kInitialLightCapacity * sizeof(GpuPointLight));
+  return pipeline;
+}
+
+DeferredPipeline::~DeferredPipeline() { spdlog::trace(__FUNCTION__); }
+
+void DeferredPipeline::Resize(const uint32_t width, const uint32_t height) {
+  mGBuffer->Resize(width, height);
+}
+
+void DeferredPipeline::BeginGeometryPass() const {
+  mGBuffer->Bind();
+  const float zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  glClearBufferfv(GL_COLOR, AlbedoRoughness, zero);
+  glClearBufferfv(GL_COLOR, Normal, zero);
+  glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+  mGeometryShader->Bind();
+}
+
+void DeferredPipeline::EndGeometryPass() const { mGBuffer->Unbind(); }
+
+void DeferredPipeline::BindGBufferTextures() const {
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, mGBuffer->GetColorAttachment(AlbedoRoughness));
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, mGBuffer->GetColorAttachment(Normal));
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_2D, mGBuffer->GetDepthAttachment());
+}
+
+void DeferredPipeline::LightingPass(const Camera& camera,
+                                    const GpuPointLight* lights,
+                                    const size_t lightCount) {
+  // light volumes test against it, transparents drawn afterwards too
+  mGBuffer->BlitDepthTo(nullptr);
+  BindGBufferTextures();
+  mEmptyVertexArray->Bind();
+
+  const auto viewportSize =
+      glm::vec2(mGBuffer->GetWidth(), mGBuffer->GetHeight());
+  auto setCameraUniforms = [&](const Shader& shader) {
+    shader.SetUniform<glm::mat4>("uInverseViewProjection",
+                                 camera.GetInverseViewProjectionMatrix());
+    shader.SetUniform<glm::vec2>("uViewportSize", viewportSize);
+    shader.SetUniform<glm::vec3>("uCameraPosition", camera.GetPosition());
+  };
+
+  glDepthMask(GL_FALSE);
+  glDisable(GL_DEPTH_TEST);
+  mDirectionalShader->Bind();
+  setCameraUniforms(*mDirectionalShader);
+  mDirectionalShader->SetUniform<glm::vec3>("uAmbient", mAmbient);
+  mDirectionalShader->SetUniform<glm::vec3>("uLightDirection",
+                                            mLightDirection);
+  mDirectionalShader->SetUniform<glm::vec3>("uLightColor", mLightColor);
+  mDirectionalShader->SetUniform<int32_t>("uShadows", mShadows ? 1 : 0);
+  if (mShadows) {
+    mShadows->Bind();
+  }
+  RenderCall::DrawArrays(3);
+
+  if (lightCount > 0) {
+    const size_t size = lightCount * sizeof(GpuPointLight);
+    if (mLightBuffer->GetSize() < size) {
+      mLightBuffer->Resize(std::max(size, mLightBuffer->GetSize() * 2));
+    }
+    mLightBuffer->SetData(lights, size);
+    mLightBuffer->BindBase(BufferTarget::ShaderStorage, 0);
+
+    mPointLightShader->Bind();
+    setCameraUniforms(*mPointLightShader);
+    mPointLightShader->SetUniform<glm::mat4>(
+        "uViewProjection", camera.GetViewProjectionMatrix());
+
+    // Back faces behind the opaque surface, so a pixel is only shaded when
+    // the surface lies in front of the volume's far side. Works with the
+    // camera inside a volume, and depth clamp keeps volumes reaching past
+    // the far plane from being clipped.
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_GEQUAL);
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    RenderCall::DrawArrays(Utils::kLightVolumeVertexCount, lightCount);
+    glDisable(GL_BLEND);
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_CLAMP);
+    glDepthFunc(GL_LESS);
+  }
+
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_TRUE);
+}
+
+void DeferredPipeline::BeginForwardPass() const {
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDepthMask(GL_FALSE);
+}
+
+void DeferredPipeline::EndForwardPass() const {
+  glDepthMask(GL_TRUE);
+  glDisable(GL_BLEND);
+}
+
+}  // namespace Peridot
@@ -0,0 +1,148 @@
+#include <algorithm>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/DepthPyramid.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr uint32_t kReduceGroupSize = 8;
+
+// Every destination texel takes the max over the source texels it covers.
+// Level 0 maps the depth buffer onto a power of two size, so one texel can
+// span up to three source texels per axis, later levels are exact 2x2.
+static constexpr const char* kDepthReduceSource = R"(
+#version 450 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout (binding = 0) uniform sampler2D uSource;
+layout (r32f, binding = 0) uniform writeonly image2D uDestination;
+
+uniform ivec2 uSourceSize;
+uniform ivec2 uDestinationSize;
+uniform int uSourceLevel;
+
+void main() {
+  ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(texel, uDestinationSize))) {
+    return;
+  }
+
+  ivec2 begin = texel * uSourceSize / uDestinationSize;
+  ivec2 end = max(begin + 1, ((texel + 1) * uSourceSize + uDestinationSize - 1) /
+                                 uDestinationSize);
+  float depth = 0.0;
+  for (int y = begin.y; y < end.y; y++) {
+    for (int x = begin.x; x < end.x; x++) {
+      depth = max(depth, texelFetch(uSource, ivec2(x, y), uSourceLevel).r);
+    }
+  }
+  imageStore(uDestination, texel, vec4(depth));
+}
+)";
+
+static uint32_t PreviousPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result * 2 <= value) {
+    result *= 2;
+  }
+  return result;
+}
+
+}  // namespace Utils
+
+std::shared_ptr<DepthPyramid> DepthPyramid::Create(const uint32_t depthWidth,
+                                                   const uint32_t depthHeight) {
+  spdlog::trace(__FUNCTION__);
+  auto pyramid = std::make_shared<DepthPyramid>();
+  pyramid->mReduceShader = Shader::CreateFromSource(
+      {{ShaderType::ComputeShader, Utils::kDepthReduceSource}});
+  if (!pyramid->mReduceShader) {
+    spdlog::error("failed to build depth reduction shader");
+    return nullptr;
+  }
+  pyramid->Allocate(depthWidth, depthHeight);
+  return pyramid;
+}
+
+DepthPyramid::~DepthPyramid() {
+  spdlog::trace(__FUNCTION__);
+  glDeleteTextures(1, &mTexture);
+}
+
+void DepthPyramid::Allocate(const uint32_t depthWidth,
+                            const uint32_t depthHeight) {
+  glDeleteTextures(1, &mTexture);
+  mDepthWidth = std::max(1u, depthWidth);
+  mDepthHeight = std::max(1u, depthHeight);
+  mWidth = Utils::PreviousPowerOfTwo(mDepthWidth);
+  mHeight = Utils::PreviousPowerOfTwo(mDepthHeight);
+  mLevelCount = 1;
+  while ((std::max(mWidth, mHeight) >> mLevelCount) > 0) {
+    mLevelCount += 1;
+  }
+
+  glGenTextures(1, &mTexture);
+  glBindTexture(GL_TEXTURE_2D, mTexture);
+  glTexStorage2D(GL_TEXTURE_2D, mLevelCount, GL_R32F, mWidth, mHeight);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  mBuilt = false;
+}
+
+void DepthPyramid::Resize(const uint32_t depthWidth,
+                          const uint32_t depthHeight) {
+  if (depthWidth == mDepthWidth && depthHeight == mDepthHeight) {
+    return;
+  }
+  Allocate(depthWidth, depthHeight);
+}
+
+void DepthPyramid::Build(const uint32_t depthTexture,
+                         const glm::mat4& viewProjection) {
+  mReduceShader->Bind();
+  glActiveTexture(GL_TEXTURE0);
+
+  int32_t sourceWidth = static_cast<int32_t>(mDepthWidth);
+  int32_t sourceHeight = static_cast<int32_t>(mDepthHeight);
+  for (uint32_t level = 0; level < mLevelCount; level++) {
+    int32_t width = std::max(1, static_cast<int32_t>(mWidth >> level));
+    int32_t height = std::max(1, static_cast<int32_t>(mHeight >> level));
+
+    // level 0 reads the depth texture, the rest read the level above them
+    glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : mTexture);
+    mReduceShader->SetUniform<int32_t>("uSourceLevel",
+                                       level == 0 ? 0 : level - 1);
+    mReduceShader->SetUniform<glm::ivec2>(
+        "uSourceSize", glm::ivec2(sourceWidth, sourceHeight));
+    mReduceShader->SetUniform<glm::ivec2>("uDestinationSize",
+                                          glm::ivec2(width, height));
+    glBindImageTexture(0, mTexture, level, GL_FALSE, 0, GL_WRITE_ONLY,
+                       GL_R32F);
+
+    glDispatchCompute((width + Utils::kReduceGroupSize - 1) / Utils::kReduceGroupSize,
+                      (height + Utils::kReduceGroupSize - 1) / Utils::kReduceGroupSize,
+                      1);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT |
+                    GL_TEXTURE_FETCH_BARRIER_BIT);
+    sourceWidth = width;
+    sourceHeight = height;
+  }
+
+  mViewProjection = viewProjection;
+  mBuilt = true;
+}
+
+void DepthPyramid::Bind(const uint32_t textureUnit) const {
+  glActiveTexture(GL_TEXTURE0 + textureUnit);
+  glBindTexture(GL_TEXTURE_2D, mTexture);
+}
+
+}  // namespace Peridot
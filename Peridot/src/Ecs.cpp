@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/Ecs.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+namespace {
+
+struct ComponentRegistry {
+  std::mutex mutex;
+  std::array<ComponentInfo, kMaxComponentTypes> infos;
+  std::atomic<uint32_t> count{0};
+};
+
+ComponentRegistry& Registry() {
+  static ComponentRegistry registry;
+  return registry;
+}
+
+constexpr uint32_t kNoArchetype = std::numeric_limits<uint32_t>::max();
+
+size_t AlignUp(const size_t value, const size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+ComponentId RegisterComponent(const ComponentInfo& info) {
+  auto& registry = Registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto id = registry.count.load();
+  if (id >= kMaxComponentTypes) {
+    spdlog::critical("more than {} component types registered",
+                     kMaxComponentTypes);
+    std::terminate();
+  }
+  // infos are written before the count is published, readers never see a
+  // half filled entry
+  registry.infos[id] = info;
+  registry.count.store(id + 1);
+  return id;
+}
+
+const ComponentInfo& GetComponentInfo(const ComponentId id) {
+  assert(id < Registry().count.load() && "unregistered component");
+  return Registry().infos[id];
+}
+
+}  // namespace Utils
+
+Archetype::Archetype(const ComponentMask& mask) : mMask(mask) {
+  mColumnOffsets.fill(kNoColumn);
+  mAddEdges.fill(Utils::kNoArchetype);
+  mRemoveEdges.fill(Utils::kNoArchetype);
+
+  size_t rowBytes = sizeof(Entity);
+  size_t paddingBytes = 0;
+  for (ComponentId id = 0; id < kMaxComponentTypes; id++) {
+    if (!mask.test(id)) {
+      continue;
+    }
+    const auto& info = Utils::GetComponentInfo(id);
+    mComponents.push_back(id);
+    rowBytes += info.size;
+    paddingBytes += info.alignment;
+    mChunkAlignment = std::max(mChunkAlignment, info.alignment);
+  }
+
+  // fit as many rows as possible in a chunk, keeping room for the padding
+  // between columns; oversized rows get a chunk of their own
+  mCapacity = static_cast<uint32_t>(
+      std::max<size_t>(1, (kChunkBytes - std::min(kChunkBytes, paddingBytes)) /
+                              rowBytes));
+
+  size_t offset = sizeof(Entity) * mCapacity;
+  for (auto id : mComponents) {
+    const auto& info = Utils::GetComponentInfo(id);
+    offset = Utils::AlignUp(offset, info.alignment);
+    mColumnOffsets[id] = static_cast<uint32_t>(offset);
+    offset += info.size * mCapacity;
+  }
+  mChunkBytes = Utils::AlignUp(std::max(offset, kChunkBytes), mChunkAlignment);
+}
+
+Archetype::~Archetype() { Clear(); }
+
+void Archetype::Clear() {
+  for (auto& chunk : mChunks) {
+    for (auto id : mComponents) {
+      const auto& info = Utils::GetComponentInfo(id);
+      auto* column = chunk.data + mColumnOffsets[id];
+      for (uint32_t row = 0; row < chunk.count; row++) {
+        info.destroy(column + info.size * row);
+      }
+    }
+    ::operator delete(chunk.data, std::align_val_t(mChunkAlignment));
+  }
+  mChunks.clear();
+  mEntityCount = 0;
+  mVersion += 1;
+}
+
+std::pair<uint32_t, uint32_t> Archetype::AllocateRow(const Entity entity) {
+  if (mChunks.empty() || mChunks.back().count == mCapacity) {
+    Chunk chunk;
+    chunk.data = static_cast<std::byte*>(
+        ::operator new(mChunkBytes, std::align_val_t(mChunkAlignment)));
+    mChunks.push_back(chunk);
+  }
+  auto chunkIndex = static_cast<uint32_t>(mChunks.size() - 1);
+  auto& chunk = mChunks.back();
+  auto row = chunk.count++;
+  new (reinterpret_cast<Entity*>(chunk.data) + row) Entity(entity);
+  mEntityCount += 1;
+  mVersion += 1;
+  return {chunkIndex, row};
+}
+
+Entity Archetype::RemoveRow(const uint32_t chunkIndex, const uint32_t row) {
+  auto& chunk = mChunks[chunkIndex];
+  auto& last = mChunks.back();
+  auto lastRow = last.count - 1;
+  bool fillHole = &chunk != &last || row != lastRow;
+
+  for (auto id : mComponents) {
+    const auto& info = Utils::GetComponentInfo(id);
+    auto* hole = chunk.data + mColumnOffsets[id] + info.size * row;
+    info.destroy(hole);
+    if (fillHole) {
+      auto* source = last.data + mColumnOffsets[id] + info.size * lastRow;
+      info.moveConstruct(hole, source);
+      info.destroy(source);
+    }
+  }
+
+  Entity moved;
+  if (fillHole) {
+    moved = reinterpret_cast<Entity*>(last.data)[lastRow];
+    reinterpret_cast<Entity*>(chunk.data)[row] = moved;
+  }
+
+  last.count -= 1;
+  mEntityCount -= 1;
+  mVersion += 1;
+  if (last.count == 0) {
+    ::operator delete(last.data, std::align_val_t(mChunkAlignment));
+    mChunks.pop_back();
+  }
+  return moved;
+}
+
+World::World() {
+  spdlog::trace(__FUNCTION__);
+  // the empty archetype always sits at index 0
+  GetOrCreateArchetype(ComponentMask());
+}
+
+World::~World() { spdlog::trace(__FUNCTION__); }
+
+uint32_t World::GetOrCreateArchetype(const ComponentMask& mask) {
+  auto it = mArchetypeLookup.find(mask);
+  if (it != mArchetypeLookup.end()) {
+    return it->second;
+  }
+  auto index = static_cast<uint32_t>(mArchetypes.size());
+  mArchetypes.push_back(std::make_unique<Archetype>(mask));
+  mArchetypeLookup.emplace(mask, index);
+  return index;
+}
+
+uint32_t World::GetAddTarget(const uint32_t archetype, const ComponentId id) {
+  auto& edge = mArchetypes[archetype]->mAddEdges[id];
+  if (edge == Utils::kNoArchetype) {
+    auto mask = mArchetypes[archetype]->GetMask();
+    edge = GetOrCreateArchetype(mask.set(id));
+  }
+  return edge;
+}
+
+uint32_t World::GetRemoveTarget(const uint32_t archetype,
+                                const ComponentId id) {
+  auto& edge = mArchetypes[archetype]->mRemoveEdges[id];
+  if (edge == Utils::kNoArchetype) {
+    auto mask = mArchetypes[archetype]->GetMask();
+    edge = GetOrCreateArchetype(mask.reset(id));
+  }
+  return edge;
+}
+
+Entity World::AllocateEntity(const uint32_t archetype) {
+  Entity entity;
+  if (!mFreeIndices.empty()) {
+    entity.index = mFreeIndices.back();
+    mFreeIndices.pop_back();
+  } else {
+    entity.index = static_cast<uint32_t>(mRecords.size());
+    mRecords.emplace_back();
+  }
+
+  auto& record = mRecords[entity.index];
+  entity.generation = record.generation;
+  auto [chunk, row] = mArchetypes[archetype]->AllocateRow(entity);
+  Stamp(*mArchetypes[archetype], chunk);
+  record.archetype = archetype;
+  record.chunk = chunk;
+  record.row = row;
+  record.alive = true;
+  mAliveCount += 1;
+  return entity;
+}
+
+Entity World::Create() {
+  assert(mIterating == 0 && "structural change during iteration");
+  return AllocateEntity(0);
+}
+
+bool World::IsAlive(const Entity entity) const {
+  return entity.index < mRecords.size() &&
+         mRecords[entity.index].alive &&
+         mRecords[entity.index].generation == entity.generation;
+}
+
+void World::Destroy(const Entity entity) {
+  assert(mIterating == 0 && "structural change during iteration");
+  if (!IsAlive(entity)) {
+    return;
+  }
+  auto& record = mRecords[entity.index];
+  auto moved =
+      mArchetypes[record.archetype]->RemoveRow(record.chunk, record.row);
+  if (moved.IsValid()) {
+    Stamp(*mArchetypes[record.archetype], record.chunk);
+    auto& movedRecord = mRecords[moved.index];
+    movedRecord.chunk = record.chunk;
+    movedRecord.row = record.row;
+  }
+
+  record.alive = false;
+  record.generation += 1;
+  mFreeIndices.push_back(entity.index);
+  mAliveCount -= 1;
+}
+
+void World::Clear() {
+  assert(mIterating == 0 && "structural change during iteration");
+  for (auto& archetype : mArchetypes) {
+    archetype->Clear();
+  }
+  mFreeIndices.clear();
+  for (uint32_t index = static_cast<uint32_t>(mRecords.size()); index > 0;
+       index--) {
+    auto& record = mRecords[index - 1];
+    if (record.alive) {
+      record.alive = false;
+      record.generation += 1;
+    }
+    mFreeIndices.push_back(index - 1);
+  }
+  mAliveCount = 0;
+}
+
+void World::MoveEntity(const Entity entity, const uint32_t target) {
+  auto& record = mRecords[entity.index];
+  auto* source = mArchetypes[record.archetype].get();
+  auto* destination = mArchetypes[target].get();
+
+  auto [chunk, row] = destination->AllocateRow(entity);
+  Stamp(*destination, chunk);
+  for (auto id : source->GetComponents()) {
+    if (destination->Has(id)) {
+      Utils::GetComponentInfo(id).moveConstruct(
+          destination->GetComponent(chunk, row, id),
+          source->GetComponent(record.chunk, record.row, id));
+    }
+  }
+
+  // the moved from husks are destroyed along with the row
+  auto moved = source->RemoveRow(record.chunk, record.row);
+  if (moved.IsValid()) {
+    Stamp(*source, record.chunk);
+    auto& movedRecord = mRecords[moved.index];
+    movedRecord.chunk = record.chunk;
+    movedRecord.row = record.row;
+  }
+
+  record.archetype = target;
+  record.chunk = chunk;
+  record.row = row;
+}
+
+void World::MarkChanged(const Entity entity) {
+  if (!IsAlive(entity)) {
+    return;
+  }
+  const auto& record = mRecords[entity.index];
+  Stamp(*mArchetypes[record.archetype], record.chunk);
+}
+
+void World::GatherChunks(const ComponentMask& mask,
+                         FrameVector<ChunkRef>& chunks) {
+  for (const auto& archetype : mArchetypes) {
+    if ((archetype->GetMask() & mask) != mask) {
+      continue;
+    }
+    for (size_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++) {
+      chunks.push_back({archetype.get(), static_cast<uint32_t>(chunk)});
+    }
+  }
+}
+
+}  // namespace Peridot
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+
+#include "Peridot/FrameAllocator.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static uintptr_t AlignUp(const uintptr_t value, const size_t alignment) {
+  return (value + alignment - 1) & ~(uintptr_t(alignment) - 1);
+}
+
+// Every arena ever handed to a thread. Arenas of finished threads go back
+// on the free list for the next thread, so short lived threads don't pile
+// up arenas.
+struct ArenaRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<LinearArena>> arenas;
+  std::vector<LinearArena*> free;
+};
+
+static ArenaRegistry& GetArenaRegistry() {
+  static ArenaRegistry registry;
+  return registry;
+}
+
+struct ThreadArena {
+  ThreadArena() {
+    auto& registry = GetArenaRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (!registry.free.empty()) {
+      arena = registry.free.back();
+      registry.free.pop_back();
+      return;
+    }
+    registry.arenas.push_back(std::make_unique<LinearArena>());
+    arena = registry.arenas.back().get();
+  }
+  ~ThreadArena() {
+    auto& registry = GetArenaRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    arena->Reset();
+    registry.free.push_back(arena);
+  }
+
+  LinearArena* arena = nullptr;
+};
+
+}  // namespace Utils
+
+LinearArena::LinearArena(const size_t blockSize)
+    : mBlockSize(std::max<size_t>(blockSize, 64)) {}
+
+void* LinearArena::Allocate(const size_t size, const size_t alignment) {
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+  while (mBlock < mBlocks.size()) {
+    auto& block = mBlocks[mBlock];
+    auto base = reinterpret_cast<uintptr_t>(block.data.get());
+    uintptr_t start = Utils::AlignUp(base + mOffset, alignment);
+    if (start + size <= base + block.size) {
+      mOffset = start + size - base;
+      return reinterpret_cast<void*>(start);
+    }
+    // blocks past the current one are left over from before a RollBack,
+    // try them before adding another
+    mBlock += 1;
+    mOffset = 0;
+  }
+  AddBlock(size + alignment);
+  return Allocate(size, alignment);
+}
+
+void LinearArena::Deallocate(void* pointer, const size_t size) {
+  if (mBlock >= mBlocks.size() || pointer == nullptr) {
+    return;
+  }
+  auto* end = static_cast<std::byte*>(pointer) + size;
+  auto* block = mBlocks[mBlock].data.get();
+  if (end == block + mOffset) {
+    mOffset = static_cast<size_t>(static_cast<std::byte*>(pointer) - block);
+  }
+}
+
+void LinearArena::RollBack(const Marker marker) {
+  assert(marker.block < mBlock ||
+         (marker.block == mBlock && marker.offset <= mOffset));
+  mBlock = marker.block;
+  mOffset = marker.offset;
+}
+
+void LinearArena::Reset() {
+  if (mBlocks.size() > 1) {
+    size_t total = GetCapacity();
+    mBlocks.clear();
+    AddBlock(total);
+  }
+  mBlock = 0;
+  mOffset = 0;
+}
+
+size_t LinearArena::GetUsed() const {
+  size_t used = mOffset;
+  for (size_t i = 0; i < mBlock && i < mBlocks.size(); i++) {
+    used += mBlocks[i].size;
+  }
+  return used;
+}
+
+size_t LinearArena::GetCapacity() const {
+  size_t capacity = 0;
+  for (const auto& block : mBlocks) {
+    capacity += block.size;
+  }
+  return capacity;
+}
+
+void LinearArena::AddBlock(const size_t minimumSize) {
+  Block block;
+  block.size = std::max(mBlockSize, minimumSize);
+  // not value initialized, make_unique would zero the whole block
+  block.data.reset(new std::byte[block.size]);
+  mBlocks.push_back(std::move(block));
+  mBlock = mBlocks.size() - 1;
+  mOffset = 0;
+}
+
+LinearArena& FrameArena::Get() {
+  // the registry is created first, so it outlives every thread's holder
+  Utils::GetArenaRegistry();
+  thread_local Utils::ThreadArena threadArena;
+  return *threadArena.arena;
+}
+
+void FrameArena::ResetAll() {
+  auto& registry = Utils::GetArenaRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const auto& arena : registry.arenas) {
+    arena->Reset();
+  }
+}
+
+}  // namespace Peridot
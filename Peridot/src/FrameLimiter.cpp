@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <thread>
+
+#include "Peridot/FrameLimiter.h"
+
+namespace Peridot {
+
+void FrameLimiter::SetMaxFrameRate(const double maxFrameRate) {
+  mMaxFrameRate = maxFrameRate;
+  if (maxFrameRate <= 0.0) {
+    mFramePeriod = Clock::duration::zero();
+    return;
+  }
+  mFramePeriod = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / maxFrameRate));
+  mNextFrame = Clock::now() + mFramePeriod;
+}
+
+void FrameLimiter::Wait() {
+  if (mFramePeriod == Clock::duration::zero()) {
+    return;
+  }
+
+  constexpr auto kMinSpin = std::chrono::microseconds(200);
+  constexpr auto kMaxSpin = std::chrono::milliseconds(4);
+
+  auto now = Clock::now();
+  while (mNextFrame - now > mSpinThreshold) {
+    auto sleepFor = mNextFrame - now - mSpinThreshold;
+    std::this_thread::sleep_for(sleepFor);
+    auto woke = Clock::now();
+    // track how late the scheduler wakes us, leaning towards the worst case
+    auto oversleep = (woke - now) - sleepFor;
+    if (oversleep > mSpinThreshold) {
+      mSpinThreshold = std::min<Clock::duration>(oversleep, kMaxSpin);
+    } else {
+      mSpinThreshold = std::max<Clock::duration>(
+          mSpinThreshold - mSpinThreshold / 16, kMinSpin);
+    }
+    now = woke;
+  }
+
+  while (now < mNextFrame) {
+    std::this_thread::yield();
+    now = Clock::now();
+  }
+
+  // a frame that overran starts a fresh schedule instead of letting the
+  // following frames run unpaced to catch up
+  mNextFrame += mFramePeriod;
+  if (mNextFrame < now) {
+    mNextFrame = now + mFramePeriod;
+  }
+}
+
+}  // namespace Peridot
@@ -0,0 +1,158 @@
+#include <cassert>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/Framebuffer.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static GLenum GLInternalFormat(const TextureFormat format) {
+  switch (format) {
+    case TextureFormat::RGBA8:
+      return GL_RGBA8;
+    case TextureFormat::RGBA16F:
+      return GL_RGBA16F;
+    case TextureFormat::RG16F:
+      return GL_RG16F;
+    case TextureFormat::R32F:
+      return GL_R32F;
+    case TextureFormat::Depth24Stencil8:
+      return GL_DEPTH24_STENCIL8;
+    case TextureFormat::Depth32F:
+      return GL_DEPTH_COMPONENT32F;
+    case TextureFormat::None:
+    default:
+      assert(false && "None or Invalid texture format");
+      return GL_NONE;
+  }
+  return GL_NONE;
+}
+
+static uint32_t CreateAttachmentTexture(const TextureFormat format,
+                                        const uint32_t width,
+                                        const uint32_t height) {
+  uint32_t texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GLInternalFormat(format), width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  return texture;
+}
+
+}  // namespace Utils
+
+std::shared_ptr<Framebuffer> Framebuffer::Create(
+    const FramebufferSpecification& spec) {
+  spdlog::trace(__FUNCTION__);
+  auto framebuffer = std::make_shared<Framebuffer>();
+  framebuffer->mSpec = spec;
+  if (!framebuffer->Invalidate()) {
+    return nullptr;
+  }
+  return framebuffer;
+}
+
+Framebuffer::~Framebuffer() {
+  spdlog::trace(__FUNCTION__ " destroying handle: {}", mRendererId);
+  Release();
+}
+
+void Framebuffer::Release() {
+  if (!mColorAttachments.empty()) {
+    glDeleteTextures(static_cast<GLsizei>(mColorAttachments.size()),
+                     mColorAttachments.data());
+  }
+  glDeleteTextures(1, &mDepthAttachment);
+  glDeleteFramebuffers(1, &mRendererId);
+  mColorAttachments.clear();
+  mDepthAttachment = 0;
+  mRendererId = 0;
+}
+
+bool Framebuffer::Invalidate() {
+  Release();
+
+  glGenFramebuffers(1, &mRendererId);
+  glBindFramebuffer(GL_FRAMEBUFFER, mRendererId);
+
+  std::vector<GLenum> drawBuffers;
+  for (size_t i = 0; i < mSpec.colorAttachments.size(); i++) {
+    auto texture = Utils::CreateAttachmentTexture(mSpec.colorAttachments[i],
+                                                  mSpec.width, mSpec.height);
+    auto attachment = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture,
+                           0);
+    mColorAttachments.push_back(texture);
+    drawBuffers.push_back(attachment);
+  }
+
+  if (mSpec.depthAttachment != TextureFormat::None) {
+    mDepthAttachment = Utils::CreateAttachmentTexture(
+        mSpec.depthAttachment, mSpec.width, mSpec.height);
+    auto attachment = mSpec.depthAttachment == TextureFormat::Depth24Stencil8
+                          ? GL_DEPTH_STENCIL_ATTACHMENT
+                          : GL_DEPTH_ATTACHMENT;
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D,
+                           mDepthAttachment, 0);
+  }
+
+  if (drawBuffers.empty()) {
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  } else {
+    glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+  }
+
+  auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    spdlog::error("framebuffer incomplete, status: 0x{:x}", status);
+    return false;
+  }
+  spdlog::trace(__FUNCTION__ " creating handle: {}", mRendererId);
+  return true;
+}
+
+void Framebuffer::Bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, mRendererId);
+  glViewport(0, 0, mSpec.width, mSpec.height);
+}
+
+void Framebuffer::Unbind() const { glBindFramebuffer(GL_FRAMEBUFFER, 0); }
+
+void Framebuffer::Resize(const uint32_t width, const uint32_t height) {
+  if (width == 0 || height == 0 ||
+      (width == mSpec.width && height == mSpec.height)) {
+    return;
+  }
+  mSpec.width = width;
+  mSpec.height = height;
+  Invalidate();
+}
+
+void Framebuffer::BlitDepthFromDefault(const uint32_t sourceWidth,
+                                       const uint32_t sourceHeight) const {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mRendererId);
+  glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, mSpec.width,
+                    mSpec.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::BlitDepthTo(const Framebuffer* target) const {
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, mRendererId);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target ? target->mRendererId : 0);
+  auto width = target ? target->mSpec.width : mSpec.width;
+  auto height = target ? target->mSpec.height : mSpec.height;
+  glBlitFramebuffer(0, 0, mSpec.width, mSpec.height, 0, 0, width, height,
+                    GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+}  // namespace Peridot
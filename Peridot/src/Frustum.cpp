@@ -0,0 +1,381 @@
+#include <algorithm>
+
+#if defined(__AVX__)
+#define PERIDOT_CULL_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERIDOT_CULL_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include "Peridot/Frustum.h"
+#include "Peridot/ThreadPool.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+// below this many volumes per range, handing out work costs more than it
+// saves
+static constexpr size_t kMinVolumesPerThread = 8192;
+
+static void AppendMask(uint32_t mask, const size_t base,
+                       std::vector<uint32_t>& visible) {
+  while (mask != 0) {
+    uint32_t bit = 0;
+    while ((mask & (1u << bit)) == 0) {
+      bit += 1;
+    }
+    visible.push_back(static_cast<uint32_t>(base + bit));
+    mask &= mask - 1;
+  }
+}
+
+static void CullAABBRange(const Frustum& frustum, const AABBSoA& boxes,
+                          size_t begin, const size_t end,
+                          std::vector<uint32_t>& visible) {
+  const float* cx = boxes.centerX.data();
+  const float* cy = boxes.centerY.data();
+  const float* cz = boxes.centerZ.data();
+  const float* ex = boxes.extentX.data();
+  const float* ey = boxes.extentY.data();
+  const float* ez = boxes.extentZ.data();
+  const auto& planes = frustum.planes;
+
+#if defined(PERIDOT_CULL_AVX)
+  __m256 nx[6], ny[6], nz[6], nd[6], ax[6], ay[6], az[6];
+  for (int p = 0; p < 6; p++) {
+    nx[p] = _mm256_set1_ps(planes[p].x);
+    ny[p] = _mm256_set1_ps(planes[p].y);
+    nz[p] = _mm256_set1_ps(planes[p].z);
+    nd[p] = _mm256_set1_ps(planes[p].w);
+    ax[p] = _mm256_set1_ps(glm::abs(planes[p].x));
+    ay[p] = _mm256_set1_ps(glm::abs(planes[p].y));
+    az[p] = _mm256_set1_ps(glm::abs(planes[p].z));
+  }
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (; begin + 8 <= end; begin += 8) {
+    __m256 x = _mm256_loadu_ps(cx + begin);
+    __m256 y = _mm256_loadu_ps(cy + begin);
+    __m256 z = _mm256_loadu_ps(cz + begin);
+    __m256 sx = _mm256_loadu_ps(ex + begin);
+    __m256 sy = _mm256_loadu_ps(ey + begin);
+    __m256 sz = _mm256_loadu_ps(ez + begin);
+    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+    for (int p = 0; p < 6; p++) {
+      // signed distance of the center plus the box's projected radius
+      __m256 dist = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+          _mm256_add_ps(_mm256_mul_ps(nz[p], z), nd[p]));
+      __m256 radius = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(ax[p], sx), _mm256_mul_ps(ay[p], sy)),
+          _mm256_mul_ps(az[p], sz));
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(_mm256_add_ps(dist, radius), zero, _CMP_GE_OQ));
+    }
+    AppendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), begin,
+               visible);
+  }
+#elif defined(PERIDOT_CULL_SSE)
+  __m128 nx[6], ny[6], nz[6], nd[6], ax[6], ay[6], az[6];
+  for (int p = 0; p < 6; p++) {
+    nx[p] = _mm_set1_ps(planes[p].x);
+    ny[p] = _mm_set1_ps(planes[p].y);
+    nz[p] = _mm_set1_ps(planes[p].z);
+    nd[p] = _mm_set1_ps(planes[p].w);
+    ax[p] = _mm_set1_ps(glm::abs(planes[p].x));
+    ay[p] = _mm_set1_ps(glm::abs(planes[p].y));
+    az[p] = _mm_set1_ps(glm::abs(planes[p].z));
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  for (; begin + 4 <= end; begin += 4) {
+    __m128 x = _mm_loadu_ps(cx + begin);
+    __m128 y = _mm_loadu_ps(cy + begin);
+    __m128 z = _mm_loadu_ps(cz + begin);
+    __m128 sx = _mm_loadu_ps(ex + begin);
+    __m128 sy = _mm_loadu_ps(ey + begin);
+    __m128 sz = _mm_loadu_ps(ez + begin);
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+    for (int p = 0; p < 6; p++) {
+      __m128 dist = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+          _mm_add_ps(_mm_mul_ps(nz[p], z), nd[p]));
+      __m128 radius = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(ax[p], sx), _mm_mul_ps(ay[p], sy)),
+          _mm_mul_ps(az[p], sz));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), zero));
+    }
+    AppendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), begin, visible);
+  }
+#endif
+
+  for (; begin < end; begin++) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; p++) {
+      float dist = planes[p].x * cx[begin] + planes[p].y * cy[begin] +
+                   planes[p].z * cz[begin] + planes[p].w;
+      float radius = glm::abs(planes[p].x) * ex[begin] +
+                     glm::abs(planes[p].y) * ey[begin] +
+                     glm::abs(planes[p].z) * ez[begin];
+      inside = dist + radius >= 0.0f;
+    }
+    if (inside) {
+      visible.push_back(static_cast<uint32_t>(begin));
+    }
+  }
+}
+
+static void CullSphereRange(const Frustum& frustum, const SphereSoA& spheres,
+                            size_t begin, const size_t end,
+                            std::vector<uint32_t>& visible) {
+  const float* cx = spheres.centerX.data();
+  const float* cy = spheres.centerY.data();
+  const float* cz = spheres.centerZ.data();
+  const float* cr = spheres.radius.data();
+  const auto& planes = frustum.planes;
+
+#if defined(PERIDOT_CULL_AVX)
+  __m256 nx[6], ny[6], nz[6], nd[6];
+  for (int p = 0; p < 6; p++) {
+    nx[p] = _mm256_set1_ps(planes[p].x);
+    ny[p] = _mm256_set1_ps(planes[p].y);
+    nz[p] = _mm256_set1_ps(planes[p].z);
+    nd[p] = _mm256_set1_ps(planes[p].w);
+  }
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (; begin + 8 <= end; begin += 8) {
+    __m256 x = _mm256_loadu_ps(cx + begin);
+    __m256 y = _mm256_loadu_ps(cy + begin);
+    __m256 z = _mm256_loadu_ps(cz + begin);
+    __m256 r = _mm256_loadu_ps(cr + begin);
+    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+    for (int p = 0; p < 6; p++) {
+      __m256 dist = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+          _mm256_add_ps(_mm256_mul_ps(nz[p], z), nd[p]));
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(_mm256_add_ps(dist, r), zero, _CMP_GE_OQ));
+    }
+    AppendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), begin,
+               visible);
+  }
+#elif defined(PERIDOT_CULL_SSE)
+  __m128 nx[6], ny[6], nz[6], nd[6];
+  for (int p = 0; p < 6; p++) {
+    nx[p] = _mm_set1_ps(planes[p].x);
+    ny[p] = _mm_set1_ps(planes[p].y);
+    nz[p] = _mm_set1_ps(planes[p].z);
+    nd[p] = _mm_set1_ps(planes[p].w);
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  for (; begin + 4 <= end; begin += 4) {
+    __m128 x = _mm_loadu_ps(cx + begin);
+    __m128 y = _mm_loadu_ps(cy + begin);
+    __m128 z = _mm_loadu_ps(cz + begin);
+    __m128 r = _mm_loadu_ps(cr + begin);
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+    for (int p = 0; p < 6; p++) {
+      __m128 dist = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+          _mm_add_ps(_mm_mul_ps(nz[p], z), nd[p]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, r), zero));
+    }
+    AppendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), begin, visible);
+  }
+#endif
+
+  for (; begin < end; begin++) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; p++) {
+      float dist = planes[p].x * cx[begin] + planes[p].y * cy[begin] +
+                   planes[p].z * cz[begin] + planes[p].w;
+      inside = dist + cr[begin] >= 0.0f;
+    }
+    if (inside) {
+      visible.push_back(static_cast<uint32_t>(begin));
+    }
+  }
+}
+
+template <typename Volumes, typename Kernel>
+static void CullParallel(const Frustum& frustum, const Volumes& volumes,
+                         std::vector<uint32_t>& visible, uint32_t threadCount,
+                         Kernel kernel) {
+  const size_t count = volumes.Size();
+  auto& pool = ThreadPool::Get();
+  if (threadCount == 0) {
+    threadCount = pool.GetWorkerCount() + 1;
+  }
+  threadCount = static_cast<uint32_t>(std::min<size_t>(
+      threadCount, std::max<size_t>(1, count / kMinVolumesPerThread)));
+
+  if (threadCount <= 1) {
+    kernel(frustum, volumes, 0, count, visible);
+    return;
+  }
+
+  // keep every range a multiple of the SIMD width so only the last one has a
+  // scalar tail
+  size_t perThread = (count + threadCount - 1) / threadCount;
+  perThread = (perThread + 7) & ~size_t(7);
+
+  std::vector<std::vector<uint32_t>> results(threadCount);
+  pool.ParallelFor(threadCount, 1, [&](size_t first, size_t last) {
+    for (size_t t = first; t < last; t++) {
+      size_t begin = std::min(count, t * perThread);
+      size_t end = std::min(count, begin + perThread);
+      kernel(frustum, volumes, begin, end, results[t]);
+    }
+  });
+  for (const auto& result : results) {
+    visible.insert(visible.end(), result.begin(), result.end());
+  }
+}
+
+}  // namespace Utils
+
+Frustum Frustum::FromMatrix(const glm::mat4& m) {
+  // Gribb/Hartmann: the planes are sums and differences of the matrix rows
+  auto row = [&m](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+  Frustum frustum;
+  frustum.planes[Left] = row(3) + row(0);
+  frustum.planes[Right] = row(3) - row(0);
+  frustum.planes[Bottom] = row(3) + row(1);
+  frustum.planes[Top] = row(3) - row(1);
+  frustum.planes[Near] = row(3) + row(2);
+  frustum.planes[Far] = row(3) - row(2);
+  for (auto& plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+bool Frustum::Intersects(const AABB& box) const {
+  auto center = box.Center();
+  auto extents = box.Extents();
+  for (const auto& plane : planes) {
+    glm::vec3 normal(plane);
+    float dist = glm::dot(normal, center) + plane.w;
+    float radius = glm::dot(glm::abs(normal), extents);
+    if (dist + radius < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::Contains(const AABB& box) const {
+  auto center = box.Center();
+  auto extents = box.Extents();
+  for (const auto& plane : planes) {
+    glm::vec3 normal(plane);
+    float dist = glm::dot(normal, center) + plane.w;
+    float radius = glm::dot(glm::abs(normal), extents);
+    if (dist - radius < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const {
+  for (const auto& plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AABBSoA::Reserve(const size_t count) {
+  for (auto* column : {&centerX, &centerY, &centerZ, &extentX, &extentY,
+                       &extentZ}) {
+    column->reserve(count);
+  }
+}
+
+void AABBSoA::Clear() {
+  for (auto* column : {&centerX, &centerY, &centerZ, &extentX, &extentY,
+                       &extentZ}) {
+    column->clear();
+  }
+}
+
+void AABBSoA::Add(const AABB& box) {
+  auto center = box.Center();
+  auto extents = box.Extents();
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extents.x);
+  extentY.push_back(extents.y);
+  extentZ.push_back(extents.z);
+}
+
+void AABBSoA::Set(const size_t index, const AABB& box) {
+  auto center = box.Center();
+  auto extents = box.Extents();
+  centerX[index] = center.x;
+  centerY[index] = center.y;
+  centerZ[index] = center.z;
+  extentX[index] = extents.x;
+  extentY[index] = extents.y;
+  extentZ[index] = extents.z;
+}
+
+void SphereSoA::Reserve(const size_t count) {
+  for (auto* column : {&centerX, &centerY, &centerZ, &radius}) {
+    column->reserve(count);
+  }
+}
+
+void SphereSoA::Clear() {
+  for (auto* column : {&centerX, &centerY, &centerZ, &radius}) {
+    column->clear();
+  }
+}
+
+void SphereSoA::Add(const BoundingSphere& sphere) {
+  centerX.push_back(sphere.center.x);
+  centerY.push_back(sphere.center.y);
+  centerZ.push_back(sphere.center.z);
+  radius.push_back(sphere.radius);
+}
+
+void SphereSoA::Set(const size_t index, const BoundingSphere& sphere) {
+  centerX[index] = sphere.center.x;
+  centerY[index] = sphere.center.y;
+  centerZ[index] = sphere.center.z;
+  radius[index] = sphere.radius;
+}
+
+void CullAABBs(const Frustum& frustum, const AABBSoA& boxes,
+               std::vector<uint32_t>& visible) {
+  Utils::CullAABBRange(frustum, boxes, 0, boxes.Size(), visible);
+}
+
+void CullSpheres(const Frustum& frustum, const SphereSoA& spheres,
+                 std::vector<uint32_t>& visible) {
+  Utils::CullSphereRange(frustum, spheres, 0, spheres.Size(), visible);
+}
+
+void CullAABBsParallel(const Frustum& frustum, const AABBSoA& boxes,
+                       std::vector<uint32_t>& visible,
+                       uint32_t threadCount) {
+  Utils::CullParallel(frustum, boxes, visible, threadCount,
+                      Utils::CullAABBRange);
+}
+
+void CullSpheresParallel(const Frustum& frustum, const SphereSoA& spheres,
+                         std::vector<uint32_t>& visible,
+                         uint32_t threadCount) {
+  Utils::CullParallel(frustum, spheres, visible, threadCount,
+                      Utils::CullSphereRange);
+}
+
+}  // namespace Peridot
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cassert>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/GeometryPool.h"
+
+namespace Peridot {
+
+RangeAllocator::RangeAllocator(const uint32_t capacity) { Reset(capacity); }
+
+uint32_t RangeAllocator::Allocate(const uint32_t size) {
+  if (size == 0) {
+    return kInvalidOffset;
+  }
+  // smallest free range that fits, lowest offset among equal sizes
+  auto fit = mFreeBySize.lower_bound({size, 0});
+  if (fit == mFreeBySize.end()) {
+    return kInvalidOffset;
+  }
+  const uint32_t offset = fit->second;
+  const uint32_t freeSize = fit->first;
+  EraseFree(mFreeByOffset.find(offset));
+  if (freeSize > size) {
+    InsertFree(offset + size, freeSize - size);
+  }
+  mAllocated.emplace(offset, size);
+  mUsed += size;
+  return offset;
+}
+
+void RangeAllocator::Free(const uint32_t offset) {
+  auto allocated = mAllocated.find(offset);
+  if (allocated == mAllocated.end()) {
+    assert(false && "freeing an offset that wasn't allocated");
+    return;
+  }
+  uint32_t start = offset;
+  uint32_t size = allocated->second;
+  mUsed -= size;
+  mAllocated.erase(allocated);
+
+  auto next = mFreeByOffset.lower_bound(offset);
+  if (next != mFreeByOffset.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == start) {
+      start = previous->first;
+      size += previous->second;
+      EraseFree(previous);
+    }
+  }
+  next = mFreeByOffset.find(start + size);
+  if (next != mFreeByOffset.end()) {
+    size += next->second;
+    EraseFree(next);
+  }
+  InsertFree(start, size);
+}
+
+void RangeAllocator::Reset(const uint32_t capacity) {
+  mCapacity = capacity;
+  mUsed = 0;
+  mFreeByOffset.clear();
+  mFreeBySize.clear();
+  mAllocated.clear();
+  if (capacity > 0) {
+    InsertFree(0, capacity);
+  }
+}
+
+uint32_t RangeAllocator::GetLargestFree() const {
+  return mFreeBySize.empty() ? 0 : mFreeBySize.rbegin()->first;
+}
+
+void RangeAllocator::InsertFree(const uint32_t offset, const uint32_t size) {
+  mFreeByOffset.emplace(offset, size);
+  mFreeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::EraseFree(
+    const std::map<uint32_t, uint32_t>::iterator it) {
+  mFreeBySize.erase({it->second, it->first});
+  mFreeByOffset.erase(it);
+}
+
+std::shared_ptr<GeometryPool> GeometryPool::Create(
+    const BufferLayout& layout, const Utils::IndexType indexType,
+    const uint32_t vertexCapacity, const uint32_t indexCapacity) {
+  spdlog::trace(__FUNCTION__);
+  if (layout.stride == 0 || vertexCapacity == 0 || indexCapacity == 0) {
+    spdlog::error("geometry pools need a layout and a capacity");
+    return nullptr;
+  }
+  auto pool = std::make_shared<GeometryPool>();
+  pool->mLayout = layout;
+  pool->mIndexType = indexType;
+  pool->mVertexArray = VertexArrayCache::Get().Acquire(layout);
+  pool->Repack(vertexCapacity, indexCapacity);
+  return pool;
+}
+
+uint32_t GeometryPool::Allocate(const void* vertices,
+                                const uint32_t vertexCount,
+                                const void* indices,
+                                const uint32_t indexCount) {
+  if (vertexCount == 0 || indexCount == 0) {
+    return kInvalidAllocation;
+  }
+  if (!Reserve(vertexCount, indexCount)) {
+    spdlog::error("geometry pool can't fit {} vertices and {} indices",
+                  vertexCount, indexCount);
+    return kInvalidAllocation;
+  }
+
+  GeometryRange range;
+  range.baseVertex = static_cast<int32_t>(mVertices.Allocate(vertexCount));
+  range.vertexCount = vertexCount;
+  range.firstIndex = mIndices.Allocate(indexCount);
+  range.indexCount = indexCount;
+
+  const size_t stride = mLayout.stride;
+  const size_t indexSize = Utils::IndexSizeInBytes(mIndexType);
+  mVertexBuffer->SetData(vertices, stride * vertexCount,
+                         stride * static_cast<size_t>(range.baseVertex));
+  mIndexBuffer->SetData(indices, indexSize * indexCount,
+                        indexSize * range.firstIndex);
+
+  if (!mFreeAllocations.empty()) {
+    uint32_t allocation = mFreeAllocations.back();
+    mFreeAllocations.pop_back();
+    mRanges[allocation] = range;
+    return allocation;
+  }
+  mRanges.push_back(range);
+  return static_cast<uint32_t>(mRanges.size() - 1);
+}
+
+void GeometryPool::Free(const uint32_t allocation) {
+  auto& range = mRanges[allocation];
+  assert(range.vertexCount != 0 && "geometry freed twice");
+  mVertices.Free(static_cast<uint32_t>(range.baseVertex));
+  mIndices.Free(range.firstIndex);
+  range = GeometryRange();
+  mFreeAllocations.push_back(allocation);
+}
+
+void GeometryPool::Defragment() {
+  Repack(mVertices.GetCapacity(), mIndices.GetCapacity());
+}
+
+float GeometryPool::GetFragmentation() const {
+  auto fragmentation = [](const RangeAllocator& allocator) {
+    uint32_t free = allocator.GetCapacity() - allocator.GetUsed();
+    if (free == 0) {
+      return 0.0f;
+    }
+    return 1.0f - static_cast<float>(allocator.GetLargestFree()) /
+                      static_cast<float>(free);
+  };
+  return std::max(fragmentation(mVertices), fragmentation(mIndices));
+}
+
+void GeometryPool::BindBuffers() const {
+  mVertexArray->BindBuffers(*mVertexBuffer, *mIndexBuffer);
+}
+
+bool GeometryPool::Reserve(const uint32_t vertexCount,
+                           const uint32_t indexCount) {
+  if (mVertices.GetLargestFree() >= vertexCount &&
+      mIndices.GetLargestFree() >= indexCount) {
+    return true;
+  }
+
+  // Packing is enough when the space is free, just not in one piece.
+  // Otherwise grow to twice the size, packing on the way.
+  auto capacity = [](const RangeAllocator& allocator, const uint32_t count) {
+    uint64_t needed = uint64_t(allocator.GetUsed()) + count;
+    uint64_t current = allocator.GetCapacity();
+    while (current < needed) {
+      current *= 2;
+    }
+    return std::min<uint64_t>(current, RangeAllocator::kInvalidOffset - 1);
+  };
+  uint64_t vertexCapacity = capacity(mVertices, vertexCount);
+  uint64_t indexCapacity = capacity(mIndices, indexCount);
+  if (vertexCapacity - mVertices.GetUsed() < vertexCount ||
+      indexCapacity - mIndices.GetUsed() < indexCount) {
+    return false;
+  }
+  if (vertexCapacity != mVertices.GetCapacity() ||
+      indexCapacity != mIndices.GetCapacity()) {
+    spdlog::info("growing geometry pool to {} vertices and {} indices",
+                 vertexCapacity, indexCapacity);
+  }
+  Repack(static_cast<uint32_t>(vertexCapacity),
+         static_cast<uint32_t>(indexCapacity));
+  return true;
+}
+
+void GeometryPool::Repack(const uint32_t vertexCapacity,
+                          const uint32_t indexCapacity) {
+  const size_t stride = mLayout.stride;
+  const size_t indexSize = Utils::IndexSizeInBytes(mIndexType);
+  auto vertexBuffer = StorageBuffer::Create(nullptr, stride * vertexCapacity);
+  auto indexBuffer = StorageBuffer::Create(nullptr, indexSize * indexCapacity);
+  mVertices.Reset(vertexCapacity);
+  mIndices.Reset(indexCapacity);
+
+  // in the order they sit in the old buffers, so both end up packed the
+  // same way
+  std::vector<uint32_t> live;
+  live.reserve(mRanges.size());
+  for (uint32_t i = 0; i < mRanges.size(); i++) {
+    if (mRanges[i].vertexCount != 0) {
+      live.push_back(i);
+    }
+  }
+  std::sort(live.begin(), live.end(), [this](uint32_t a, uint32_t b) {
+    return mRanges[a].baseVertex < mRanges[b].baseVertex;
+  });
+
+  for (auto allocation : live) {
+    auto& range = mRanges[allocation];
+    uint32_t baseVertex = mVertices.Allocate(range.vertexCount);
+    uint32_t firstIndex = mIndices.Allocate(range.indexCount);
+    vertexBuffer->CopyData(*mVertexBuffer,
+                           stride * static_cast<size_t>(range.baseVertex),
+                           stride * baseVertex, stride * range.vertexCount);
+    indexBuffer->CopyData(*mIndexBuffer, indexSize * range.firstIndex,
+                          indexSize * firstIndex,
+                          indexSize * range.indexCount);
+    range.baseVertex = static_cast<int32_t>(baseVertex);
+    range.firstIndex = firstIndex;
+  }
+  mVertexBuffer = vertexBuffer;
+  mIndexBuffer = indexBuffer;
+  mRepackCount += 1;
+}
+
+std::shared_ptr<GeometryAllocation> GeometryAllocation::Create(
+    const std::shared_ptr<GeometryPool>& pool, const void* vertices,
+    const uint32_t vertexCount, const void* indices,
+    const uint32_t indexCount) {
+  if (!pool) {
+    return nullptr;
+  }
+  uint32_t id = pool->Allocate(vertices, vertexCount, indices, indexCount);
+  if (id == GeometryPool::kInvalidAllocation) {
+    return nullptr;
+  }
+  auto allocation = std::make_shared<GeometryAllocation>();
+  allocation->mPool = pool;
+  allocation->mId = id;
+  return allocation;
+}
+
+GeometryAllocation::~GeometryAllocation() {
+  if (mPool) {
+    mPool->Free(mId);
+  }
+}
+
+GeometryPoolCache& GeometryPoolCache::Get() {
+  static GeometryPoolCache cache;
+  return cache;
+}
+
+std::shared_ptr<GeometryPool> GeometryPoolCache::Acquire(
+    const BufferLayout& layout, const Utils::IndexType indexType) {
+  auto& bucket = mPools[layout.Hash() ^ static_cast<size_t>(indexType)];
+  for (const auto& pool : bucket) {
+    if (pool->GetIndexType() == indexType && pool->GetLayout() == layout) {
+      return pool;
+    }
+  }
+  auto pool = GeometryPool::Create(layout, indexType, kInitialVertexCapacity,
+                                   kInitialIndexCapacity);
+  if (pool) {
+    bucket.push_back(pool);
+  }
+  return pool;
+}
+
+void GeometryPoolCache::Defragment(const float threshold) {
+  for (const auto& [hash, bucket] : mPools) {
+    for (const auto& pool : bucket) {
+      if (pool->GetFragmentation() > threshold) {
+        pool->Defragment();
+      }
+    }
+  }
+}
+
+void GeometryPoolCache::Clear() { mPools.clear(); }
+
+}  // namespace Peridot
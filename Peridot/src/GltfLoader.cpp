@@ -0,0 +1,531 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/MappedFile.h"
+#include "Peridot/MeshLoader.h"
+#include "Peridot/ThreadPool.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr uint32_t kGlbMagic = 0x46546C67;      // "glTF"
+static constexpr uint32_t kGlbChunkJson = 0x4E4F534A;  // "JSON"
+static constexpr uint32_t kGlbChunkBin = 0x004E4942;   // "BIN\0"
+static constexpr int kGltfModeTriangles = 4;
+// vertices or indices read per ThreadPool task
+static constexpr size_t kGltfElementsPerJob = 1 << 16;
+
+enum GltfComponentType {
+  Byte = 5120,
+  UnsignedByte = 5121,
+  Short = 5122,
+  UnsignedShort = 5123,
+  UnsignedInt = 5125,
+  Float = 5126
+};
+
+// Resolved accessor, pointing straight into the mapped BIN chunk.
+struct GltfAccessor {
+  const uint8_t* data = nullptr;
+  size_t count = 0;
+  size_t stride = 0;
+  int componentType = 0;
+
+  float ReadFloat(const size_t index, const int component) const {
+    const uint8_t* element = data + stride * index;
+    switch (componentType) {
+      case Float: {
+        float value;
+        std::memcpy(&value, element + component * 4, 4);
+        return value;
+      }
+      case UnsignedByte:
+        return element[component] / 255.0f;
+      case UnsignedShort: {
+        uint16_t value;
+        std::memcpy(&value, element + component * 2, 2);
+        return value / 65535.0f;
+      }
+      case Byte:
+        return std::max(static_cast<int8_t>(element[component]) / 127.0f,
+                        -1.0f);
+      case Short: {
+        int16_t value;
+        std::memcpy(&value, element + component * 2, 2);
+        return std::max(value / 32767.0f, -1.0f);
+      }
+      default:
+        return 0.0f;
+    }
+  }
+
+  uint32_t ReadIndex(const size_t index) const {
+    const uint8_t* element = data + stride * index;
+    switch (componentType) {
+      case UnsignedByte:
+        return element[0];
+      case UnsignedShort: {
+        uint16_t value;
+        std::memcpy(&value, element, 2);
+        return value;
+      }
+      case UnsignedInt:
+      default: {
+        uint32_t value;
+        std::memcpy(&value, element, 4);
+        return value;
+      }
+    }
+  }
+};
+
+struct GltfPrimitive {
+  GltfAccessor positions;
+  GltfAccessor normals;
+  GltfAccessor texCoords;
+  GltfAccessor indices;
+  bool hasNormals = false;
+  bool hasTexCoords = false;
+  bool hasIndices = false;
+  glm::mat4 transform = glm::mat4(1.0f);
+  size_t vertexBase = 0;
+  size_t indexBase = 0;
+};
+
+// what an accessor is read as, ReadFloat and ReadIndex only handle the
+// formats the spec allows for each
+enum class GltfAccessorUsage { Position, Normal, TexCoord, Indices };
+
+static bool IsValidFormat(const GltfAccessorUsage usage,
+                          const std::string& type, const int componentType,
+                          const bool normalized) {
+  const bool normalizedInteger =
+      normalized && componentType != Float && componentType != UnsignedInt;
+  switch (usage) {
+    case GltfAccessorUsage::Position:
+    case GltfAccessorUsage::Normal:
+      return type == "VEC3" && (componentType == Float || normalizedInteger);
+    case GltfAccessorUsage::TexCoord:
+      return type == "VEC2" &&
+             (componentType == Float ||
+              (normalizedInteger && (componentType == UnsignedByte ||
+                                     componentType == UnsignedShort)));
+    case GltfAccessorUsage::Indices:
+      return type == "SCALAR" &&
+             (componentType == UnsignedByte ||
+              componentType == UnsignedShort || componentType == UnsignedInt);
+    default:
+      return false;
+  }
+}
+
+static size_t ComponentSize(const int componentType) {
+  switch (componentType) {
+    case Byte:
+    case UnsignedByte:
+      return 1;
+    case Short:
+    case UnsignedShort:
+      return 2;
+    case UnsignedInt:
+    case Float:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+static size_t ComponentCount(const std::string& type) {
+  if (type == "SCALAR") return 1;
+  if (type == "VEC2") return 2;
+  if (type == "VEC3") return 3;
+  if (type == "VEC4") return 4;
+  return 0;
+}
+
+static bool ResolveAccessor(const nlohmann::json& document, const size_t id,
+                            const GltfAccessorUsage usage,
+                            const uint8_t* bin, const size_t binSize,
+                            GltfAccessor& out) {
+  const auto& accessors = document.at("accessors");
+  if (id >= accessors.size()) {
+    return false;
+  }
+  const auto& accessor = accessors[id];
+  if (accessor.contains("sparse") || !accessor.contains("bufferView")) {
+    spdlog::error("sparse and buffer-less glTF accessors are not supported");
+    return false;
+  }
+  const auto& view =
+      document.at("bufferViews").at(accessor.at("bufferView").get<size_t>());
+  if (view.value("buffer", 0) != 0) {
+    spdlog::error("only the GLB BIN chunk is supported as a glTF buffer");
+    return false;
+  }
+
+  out.count = accessor.at("count").get<size_t>();
+  out.componentType = accessor.at("componentType").get<int>();
+  const auto type = accessor.at("type").get<std::string>();
+  if (!IsValidFormat(usage, type, out.componentType,
+                     accessor.value("normalized", false))) {
+    spdlog::error("glTF accessor {} is a {} of component type {}, which "
+                  "its attribute can't be read from",
+                  id, type, out.componentType);
+    return false;
+  }
+  size_t elementSize = ComponentSize(out.componentType) * ComponentCount(type);
+  out.stride = view.value("byteStride", elementSize);
+  if (out.stride < elementSize) {
+    spdlog::error("glTF accessor {} has a stride shorter than its elements",
+                  id);
+    return false;
+  }
+  size_t viewOffset = view.value("byteOffset", size_t(0));
+  size_t offset = viewOffset + accessor.value("byteOffset", size_t(0));
+  size_t viewEnd = viewOffset + view.at("byteLength").get<size_t>();
+  if (viewEnd > binSize ||
+      (out.count > 0 && offset + out.stride * (out.count - 1) + elementSize >
+                            viewEnd)) {
+    spdlog::error("glTF accessor {} reads past its buffer view", id);
+    return false;
+  }
+  out.data = bin + offset;
+  return true;
+}
+
+static glm::mat4 NodeTransform(const nlohmann::json& node) {
+  if (node.contains("matrix")) {
+    const auto& m = node["matrix"];
+    glm::mat4 matrix;
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        matrix[column][row] = m.at(column * 4 + row).get<float>();
+      }
+    }
+    return matrix;
+  }
+
+  glm::vec3 translation(0.0f), scale(1.0f);
+  float q[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+  if (node.contains("translation")) {
+    const auto& t = node["translation"];
+    translation = {t.at(0).get<float>(), t.at(1).get<float>(),
+                   t.at(2).get<float>()};
+  }
+  if (node.contains("scale")) {
+    const auto& s = node["scale"];
+    scale = {s.at(0).get<float>(), s.at(1).get<float>(), s.at(2).get<float>()};
+  }
+  if (node.contains("rotation")) {
+    for (int i = 0; i < 4; i++) {
+      q[i] = node["rotation"].at(i).get<float>();
+    }
+  }
+
+  // T * R * S with R from the unit quaternion (x, y, z, w)
+  const float x = q[0], y = q[1], z = q[2], w = q[3];
+  glm::mat4 matrix(1.0f);
+  matrix[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w),
+                        2.0f * (x * z - y * w), 0.0f) *
+              scale.x;
+  matrix[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z),
+                        2.0f * (y * z + x * w), 0.0f) *
+              scale.y;
+  matrix[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w),
+                        1.0f - 2.0f * (x * x + y * y), 0.0f) *
+              scale.z;
+  matrix[3] = glm::vec4(translation, 1.0f);
+  return matrix;
+}
+
+struct GltfGatherState {
+  const nlohmann::json& document;
+  const uint8_t* bin;
+  size_t binSize;
+  std::vector<GltfPrimitive>& primitives;
+};
+
+static bool GatherMesh(GltfGatherState& state, const size_t meshId,
+                       const glm::mat4& transform) {
+  const auto& mesh = state.document.at("meshes").at(meshId);
+  for (const auto& primitive : mesh.at("primitives")) {
+    if (primitive.value("mode", kGltfModeTriangles) != kGltfModeTriangles) {
+      spdlog::warn("skipping a non-triangle glTF primitive");
+      continue;
+    }
+    const auto& attributes = primitive.at("attributes");
+    if (!attributes.contains("POSITION")) {
+      continue;
+    }
+
+    GltfPrimitive out;
+    out.transform = transform;
+    if (!ResolveAccessor(state.document,
+                         attributes["POSITION"].get<size_t>(),
+                         GltfAccessorUsage::Position, state.bin,
+                         state.binSize, out.positions)) {
+      return false;
+    }
+    if (attributes.contains("NORMAL")) {
+      if (!ResolveAccessor(state.document, attributes["NORMAL"].get<size_t>(),
+                           GltfAccessorUsage::Normal, state.bin,
+                           state.binSize, out.normals)) {
+        return false;
+      }
+      out.hasNormals = out.normals.count == out.positions.count;
+    }
+    if (attributes.contains("TEXCOORD_0")) {
+      if (!ResolveAccessor(state.document,
+                           attributes["TEXCOORD_0"].get<size_t>(),
+                           GltfAccessorUsage::TexCoord, state.bin,
+                           state.binSize, out.texCoords)) {
+        return false;
+      }
+      out.hasTexCoords = out.texCoords.count == out.positions.count;
+    }
+    if (primitive.contains("indices")) {
+      if (!ResolveAccessor(state.document, primitive["indices"].get<size_t>(),
+                           GltfAccessorUsage::Indices, state.bin,
+                           state.binSize, out.indices)) {
+        return false;
+      }
+      out.hasIndices = true;
+    }
+    // indices are clamped to the last vertex, which an empty primitive
+    // doesn't have
+    if (out.positions.count == 0) {
+      spdlog::error("glTF mesh {} has a primitive without vertices", meshId);
+      return false;
+    }
+    // primitives are concatenated, a partial triangle would shift every
+    // triangle after it
+    const size_t cornerCount =
+        out.hasIndices ? out.indices.count : out.positions.count;
+    if (cornerCount % 3 != 0) {
+      spdlog::error("glTF mesh {} has a primitive with {} corners, which "
+                    "isn't a whole number of triangles",
+                    meshId, cornerCount);
+      return false;
+    }
+    state.primitives.push_back(out);
+  }
+  return true;
+}
+
+static bool GatherNode(GltfGatherState& state, const size_t nodeId,
+                       const glm::mat4& parentTransform, const int depth) {
+  // glTF forbids cycles, the depth cap only guards against broken files
+  if (depth > 256) {
+    spdlog::error("glTF node hierarchy is too deep or cyclic");
+    return false;
+  }
+  const auto& node = state.document.at("nodes").at(nodeId);
+  glm::mat4 transform = parentTransform * NodeTransform(node);
+  if (node.contains("mesh") &&
+      !GatherMesh(state, node["mesh"].get<size_t>(), transform)) {
+    return false;
+  }
+  if (node.contains("children")) {
+    for (const auto& child : node["children"]) {
+      if (!GatherNode(state, child.get<size_t>(), transform, depth + 1)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void ReadVertices(const GltfPrimitive& primitive, const size_t begin,
+                         const size_t end, MeshData& meshData) {
+  const glm::mat3 normalMatrix =
+      glm::transpose(glm::inverse(glm::mat3(primitive.transform)));
+  auto* vertices = meshData.vertices.data() + primitive.vertexBase;
+  for (size_t i = begin; i < end; i++) {
+    auto& vertex = vertices[i];
+    glm::vec3 position(primitive.positions.ReadFloat(i, 0),
+                       primitive.positions.ReadFloat(i, 1),
+                       primitive.positions.ReadFloat(i, 2));
+    vertex.position =
+        glm::vec3(primitive.transform * glm::vec4(position, 1.0f));
+    if (primitive.hasNormals) {
+      glm::vec3 normal(primitive.normals.ReadFloat(i, 0),
+                       primitive.normals.ReadFloat(i, 1),
+                       primitive.normals.ReadFloat(i, 2));
+      normal = normalMatrix * normal;
+      float length = glm::length(normal);
+      vertex.normal = length > 0.0f ? normal / length : normal;
+    }
+    if (primitive.hasTexCoords) {
+      vertex.texCoord = {primitive.texCoords.ReadFloat(i, 0),
+                         primitive.texCoords.ReadFloat(i, 1)};
+    }
+  }
+}
+
+static void ReadIndices(const GltfPrimitive& primitive, const size_t begin,
+                        const size_t end, MeshData& meshData) {
+  auto* indices = meshData.indices.data() + primitive.indexBase;
+  const auto base = static_cast<uint32_t>(primitive.vertexBase);
+  const auto last = static_cast<uint32_t>(primitive.positions.count - 1);
+  for (size_t i = begin; i < end; i++) {
+    // out of range indices are clamped rather than trusted
+    indices[i] = base + (primitive.hasIndices
+                             ? std::min(primitive.indices.ReadIndex(i), last)
+                             : static_cast<uint32_t>(i));
+  }
+}
+
+}  // namespace Utils
+
+bool LoadGlb(const char* filePath, MeshData& meshData) {
+  spdlog::trace(__FUNCTION__);
+  auto file = MappedFile::Open(filePath);
+  if (!file) {
+    return false;
+  }
+
+  const uint8_t* data = file->GetData();
+  const size_t size = file->GetSize();
+  uint32_t header[3];
+  if (size < sizeof(header)) {
+    spdlog::error("{} is too small to be a GLB file", filePath);
+    return false;
+  }
+  std::memcpy(header, data, sizeof(header));
+  if (header[0] != Utils::kGlbMagic || header[1] != 2 || header[2] > size) {
+    spdlog::error("{} is not a glTF 2.0 binary file", filePath);
+    return false;
+  }
+
+  const char* jsonBegin = nullptr;
+  const char* jsonEnd = nullptr;
+  const uint8_t* bin = nullptr;
+  size_t binSize = 0;
+  size_t offset = sizeof(header);
+  while (offset + 8 <= header[2]) {
+    uint32_t chunk[2];
+    std::memcpy(chunk, data + offset, sizeof(chunk));
+    offset += sizeof(chunk);
+    if (offset + chunk[0] > header[2]) {
+      spdlog::error("{} has a truncated chunk", filePath);
+      return false;
+    }
+    if (chunk[1] == Utils::kGlbChunkJson && !jsonBegin) {
+      jsonBegin = reinterpret_cast<const char*>(data + offset);
+      jsonEnd = jsonBegin + chunk[0];
+    } else if (chunk[1] == Utils::kGlbChunkBin && !bin) {
+      bin = data + offset;
+      binSize = chunk[0];
+    }
+    offset += chunk[0];
+  }
+  if (!jsonBegin) {
+    spdlog::error("{} has no JSON chunk", filePath);
+    return false;
+  }
+
+  auto document = nlohmann::json::parse(jsonBegin, jsonEnd, nullptr, false);
+  if (document.is_discarded()) {
+    spdlog::error("{} has malformed JSON", filePath);
+    return false;
+  }
+
+  std::vector<Utils::GltfPrimitive> primitives;
+  Utils::GltfGatherState state{document, bin, binSize, primitives};
+  try {
+    if (document.contains("scenes") && document.contains("nodes")) {
+      const auto& scene =
+          document["scenes"].at(document.value("scene", size_t(0)));
+      for (const auto& node : scene.value("nodes", nlohmann::json::array())) {
+        if (!Utils::GatherNode(state, node.get<size_t>(), glm::mat4(1.0f),
+                               0)) {
+          return false;
+        }
+      }
+    } else if (document.contains("meshes")) {
+      // no scene graph, take every mesh as is
+      for (size_t mesh = 0; mesh < document["meshes"].size(); mesh++) {
+        if (!Utils::GatherMesh(state, mesh, glm::mat4(1.0f))) {
+          return false;
+        }
+      }
+    }
+  } catch (const nlohmann::json::exception& e) {
+    spdlog::error("{} has an invalid glTF document: {}", filePath, e.what());
+    return false;
+  }
+  if (primitives.empty()) {
+    spdlog::error("{} has no triangle meshes", filePath);
+    return false;
+  }
+
+  // every primitive gets its own range of the output, then they are read
+  // in parallel straight from the mapping
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+  for (auto& primitive : primitives) {
+    primitive.vertexBase = vertexCount;
+    primitive.indexBase = indexCount;
+    vertexCount += primitive.positions.count;
+    indexCount += primitive.hasIndices ? primitive.indices.count
+                                       : primitive.positions.count;
+  }
+  if (vertexCount > std::numeric_limits<uint32_t>::max()) {
+    spdlog::error("{} has too many vertices for 32 bit indices", filePath);
+    return false;
+  }
+  meshData.vertices.assign(vertexCount, MeshVertex());
+  meshData.indices.resize(indexCount);
+
+  // large primitives are split so a single huge mesh still uses every thread
+  struct ReadJob {
+    size_t primitive;
+    bool indices;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<ReadJob> jobs;
+  for (size_t i = 0; i < primitives.size(); i++) {
+    const auto& primitive = primitives[i];
+    size_t primitiveIndices = primitive.hasIndices ? primitive.indices.count
+                                                   : primitive.positions.count;
+    for (size_t begin = 0; begin < primitive.positions.count;
+         begin += Utils::kGltfElementsPerJob) {
+      jobs.push_back({i, false, begin,
+                      std::min(primitive.positions.count,
+                               begin + Utils::kGltfElementsPerJob)});
+    }
+    for (size_t begin = 0; begin < primitiveIndices;
+         begin += Utils::kGltfElementsPerJob) {
+      jobs.push_back(
+          {i, true, begin,
+           std::min(primitiveIndices, begin + Utils::kGltfElementsPerJob)});
+    }
+  }
+  ThreadPool::Get().ParallelFor(jobs.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const auto& job = jobs[i];
+      if (job.indices) {
+        Utils::ReadIndices(primitives[job.primitive], job.begin, job.end,
+                           meshData);
+      } else {
+        Utils::ReadVertices(primitives[job.primitive], job.begin, job.end,
+                            meshData);
+      }
+    }
+  });
+  meshData.GenerateMissingNormals();
+
+  meshData.ComputeBounds();
+  spdlog::info("loaded {}: {} vertices, {} triangles", filePath,
+               meshData.vertices.size(), meshData.indices.size() / 3);
+  return true;
+}
+
+}  // namespace Peridot
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cassert>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/GpuCulling.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr uint32_t kCullGroupSize = 64;
+
+static_assert(kMaxMeshLods == 8, "the cull shader's LodTable holds 8 LODs");
+static_assert(sizeof(GpuObjectBounds) == 32, "std430 ObjectBounds");
+static_assert(sizeof(GpuLodTable) == 144, "std430 LodTable");
+
+static constexpr const char* kFrustumPlaneUniforms[6] = {
+    "uFrustumPlanes[0]", "uFrustumPlanes[1]", "uFrustumPlanes[2]",
+    "uFrustumPlanes[3]", "uFrustumPlanes[4]", "uFrustumPlanes[5]"};
+
+static constexpr const char* kCullComputeSource = R"(
+#version 450 core
+
+layout (local_size_x = 64) in;
+
+struct ObjectBounds {
+  vec3 center;
+  float scale;
+  vec3 extents;
+  uint lodTable;
+};
+
+struct Lod {
+  uint firstIndex;
+  uint indexCount;
+  float error;
+  uint padding;
+};
+
+struct LodTable {
+  Lod lods[8];
+  uint lodCount;
+  uint padding0;
+  uint padding1;
+  uint padding2;
+};
+
+struct DrawCommand {
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Bounds { ObjectBounds bounds[]; };
+layout (std430, binding = 1) readonly buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 2) writeonly buffer VisibleCommands { DrawCommand visible[]; };
+layout (std430, binding = 3) buffer DrawCount { uint drawCount; };
+layout (std430, binding = 4) readonly buffer LodTables { LodTable lodTables[]; };
+
+uniform vec4 uFrustumPlanes[6];
+uniform uint uObjectCount;
+uniform bool uCompact;
+
+uniform bool uSelectLods;
+uniform vec3 uLodCameraPosition;
+uniform float uLodPixelsPerUnit;
+uniform float uLodMinDistance;
+uniform float uLodThreshold;
+
+uniform bool uOcclusion;
+uniform mat4 uPyramidViewProjection;
+uniform vec2 uPyramidSize;
+uniform int uPyramidLevels;
+layout (binding = 0) uniform sampler2D uDepthPyramid;
+
+bool IsVisible(ObjectBounds object) {
+  for (int i = 0; i < 6; i++) {
+    vec4 plane = uFrustumPlanes[i];
+    float dist = dot(plane.xyz, object.center) + plane.w;
+    float radius = dot(abs(plane.xyz), object.extents);
+    if (dist + radius < 0.0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Projects the box with the matrix the pyramid was built with, then compares
+// its nearest depth against the farthest depth stored over its screen rect.
+// The pyramid level is chosen so the rect spans at most 2x2 texels.
+bool IsOccluded(ObjectBounds object) {
+  vec3 boxMin = object.center - object.extents;
+  vec3 boxMax = object.center + object.extents;
+  vec2 uvMin = vec2(1.0);
+  vec2 uvMax = vec2(0.0);
+  float nearestDepth = 1.0;
+
+  for (int i = 0; i < 8; i++) {
+    vec3 corner = vec3((i & 1) != 0 ? boxMax.x : boxMin.x,
+                       (i & 2) != 0 ? boxMax.y : boxMin.y,
+                       (i & 4) != 0 ? boxMax.z : boxMin.z);
+    vec4 clip = uPyramidViewProjection * vec4(corner, 1.0);
+    if (clip.w <= 0.0) {
+      // straddles the camera plane, can't be tested reliably
+      return false;
+    }
+    vec3 ndc = clip.xyz / clip.w;
+    vec2 uv = ndc.xy * 0.5 + 0.5;
+    uvMin = min(uvMin, uv);
+    uvMax = max(uvMax, uv);
+    nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+  }
+
+  uvMin = clamp(uvMin, vec2(0.0), vec2(1.0));
+  uvMax = clamp(uvMax, vec2(0.0), vec2(1.0));
+  vec2 size = (uvMax - uvMin) * uPyramidSize;
+  float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+  level = clamp(level, 0.0, float(uPyramidLevels - 1));
+
+  float farthest = max(
+      max(textureLod(uDepthPyramid, uvMin, level).r,
+          textureLod(uDepthPyramid, vec2(uvMax.x, uvMin.y), level).r),
+      max(textureLod(uDepthPyramid, vec2(uvMin.x, uvMax.y), level).r,
+          textureLod(uDepthPyramid, uvMax, level).r));
+  return nearestDepth > farthest;
+}
+
+// the coarsest LOD whose error stays under the threshold on screen, like
+// SelectLod
+Lod SelectLod(ObjectBounds object) {
+  LodTable table = lodTables[object.lodTable];
+  if (!uSelectLods) {
+    return table.lods[0];
+  }
+  float pixels = uLodPixelsPerUnit * object.scale;
+  if (uLodMinDistance > 0.0) {
+    float distance =
+        length(object.center - uLodCameraPosition) - length(object.extents);
+    pixels /= max(distance, uLodMinDistance);
+  }
+  uint selected = 0u;
+  for (uint i = 1u; i < table.lodCount; i++) {
+    if (table.lods[i].error * pixels > uLodThreshold) {
+      break;
+    }
+    selected = i;
+  }
+  return table.lods[selected];
+}
+
+void main() {
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= uObjectCount) {
+    return;
+  }
+
+  ObjectBounds object = bounds[index];
+  bool visibleObject = IsVisible(object) && !(uOcclusion && IsOccluded(object));
+  DrawCommand command = commands[index];
+  if (visibleObject && object.lodTable != 0xFFFFFFFFu) {
+    Lod lod = SelectLod(object);
+    command.firstIndex = lod.firstIndex;
+    command.count = lod.indexCount;
+  }
+
+  if (uCompact) {
+    if (visibleObject) {
+      visible[atomicAdd(drawCount, 1u)] = command;
+    }
+  } else {
+    command.instanceCount = visibleObject ? command.instanceCount : 0u;
+    visible[index] = command;
+  }
+}
+)";
+
+// One program for every GpuCulling, freed with the last of them so it
+// doesn't outlive the GL context.
+static std::shared_ptr<Shader> GetCullShader() {
+  static std::weak_ptr<Shader> cached;
+  auto shader = cached.lock();
+  if (!shader) {
+    shader = Shader::CreateFromSource(
+        {{ShaderType::ComputeShader, kCullComputeSource}});
+    cached = shader;
+  }
+  return shader;
+}
+
+// a new buffer of sizeInBytes holding the first keepBytes of previous
+static std::shared_ptr<StorageBuffer> GrowBuffer(
+    const std::shared_ptr<StorageBuffer>& previous, const size_t sizeInBytes,
+    const size_t keepBytes) {
+  auto buffer = StorageBuffer::Create(nullptr, sizeInBytes);
+  if (previous && keepBytes > 0) {
+    buffer->CopyData(*previous, 0, 0, keepBytes);
+  }
+  return buffer;
+}
+
+}  // namespace Utils
+
+std::shared_ptr<GpuCulling> GpuCulling::Create(const uint32_t maxObjects) {
+  spdlog::trace(__FUNCTION__);
+  auto culling = std::make_shared<GpuCulling>();
+
+  culling->mCullShader = Utils::GetCullShader();
+  if (!culling->mCullShader) {
+    spdlog::error("failed to build culling compute shader");
+    return nullptr;
+  }
+
+  culling->mCompact = RenderCall::SupportsIndirectCount();
+  if (!culling->mCompact) {
+    spdlog::warn("indirect count draws unavailable, culled draws are kept "
+                 "with zero instances");
+  }
+
+  uint32_t zero = 0;
+  culling->mDrawCountBuffer = StorageBuffer::Create(&zero, sizeof(zero));
+  // the shader reads the binding even when no object has LODs
+  culling->mMaxLodTables = 1;
+  culling->mLodTableBuffer =
+      StorageBuffer::Create(nullptr, sizeof(GpuLodTable));
+  culling->Reserve(std::max(1u, maxObjects));
+  return culling;
+}
+
+void GpuCulling::Reserve(const uint32_t objectCount) {
+  if (objectCount <= mMaxObjects) {
+    return;
+  }
+  // geometric growth, objects trickling in don't copy every time
+  const auto capacity = std::max(objectCount, mMaxObjects * 2);
+  mBoundsBuffer =
+      Utils::GrowBuffer(mBoundsBuffer, capacity * sizeof(GpuObjectBounds),
+                        mObjectCount * sizeof(GpuObjectBounds));
+  mCommandBuffer = Utils::GrowBuffer(
+      mCommandBuffer, capacity * sizeof(DrawElementsIndirectCommand),
+      mObjectCount * sizeof(DrawElementsIndirectCommand));
+  mVisibleCommandBuffer = StorageBuffer::Create(
+      nullptr, capacity * sizeof(DrawElementsIndirectCommand));
+  mMaxObjects = capacity;
+}
+
+void GpuCulling::SetObjectCount(const uint32_t count) {
+  assert(count <= mMaxObjects);
+  mObjectCount = count;
+}
+
+void GpuCulling::UpdateObjects(const uint32_t first, const uint32_t count,
+                               const GpuObjectBounds* bounds,
+                               const DrawElementsIndirectCommand* commands) {
+  assert(first + count <= mMaxObjects);
+  if (count == 0) {
+    return;
+  }
+  mBoundsBuffer->SetData(bounds, count * sizeof(GpuObjectBounds),
+                         first * sizeof(GpuObjectBounds));
+  mCommandBuffer->SetData(commands,
+                          count * sizeof(DrawElementsIndirectCommand),
+                          first * sizeof(DrawElementsIndirectCommand));
+}
+
+void GpuCulling::SetObjects(
+    const std::vector<GpuObjectBounds>& bounds,
+    const std::vector<DrawElementsIndirectCommand>& commands) {
+  assert(bounds.size() == commands.size());
+  const auto count = static_cast<uint32_t>(bounds.size());
+  // nothing to keep, the old contents are overwritten
+  mObjectCount = 0;
+  Reserve(count);
+  UpdateObjects(0, count, bounds.data(), commands.data());
+  mObjectCount = count;
+}
+
+void GpuCulling::UpdateLodTables(const uint32_t first, const uint32_t count,
+                                 const GpuLodTable* tables) {
+  if (count == 0) {
+    return;
+  }
+  if (first + count > mMaxLodTables) {
+    const auto capacity = std::max(first + count, mMaxLodTables * 2);
+    mLodTableBuffer =
+        Utils::GrowBuffer(mLodTableBuffer, capacity * sizeof(GpuLodTable),
+                          mMaxLodTables * sizeof(GpuLodTable));
+    mMaxLodTables = capacity;
+  }
+  mLodTableBuffer->SetData(tables, count * sizeof(GpuLodTable),
+                           first * sizeof(GpuLodTable));
+}
+
+void GpuCulling::Cull(const Frustum& frustum,
+                      const DepthPyramid* occlusion) {
+  if (mObjectCount == 0) {
+    return;
+  }
+
+  uint32_t zero = 0;
+  mDrawCountBuffer->SetData(&zero, sizeof(zero));
+
+  mCullShader->Bind();
+  for (int i = 0; i < 6; i++) {
+    mCullShader->SetUniform<glm::vec4>(Utils::kFrustumPlaneUniforms[i],
+                                       frustum.planes[i]);
+  }
+  mCullShader->SetUniform<uint32_t>("uObjectCount", mObjectCount);
+  mCullShader->SetUniform<int32_t>("uCompact", mCompact ? 1 : 0);
+  mCullShader->SetUniform<int32_t>("uSelectLods", mSelectLods ? 1 : 0);
+  if (mSelectLods) {
+    mCullShader->SetUniform<glm::vec3>("uLodCameraPosition",
+                                       mLodSelection.cameraPosition);
+    mCullShader->SetUniform<float>("uLodPixelsPerUnit",
+                                   mLodSelection.pixelsPerUnit);
+    mCullShader->SetUniform<float>("uLodMinDistance",
+                                   mLodSelection.minDistance);
+    mCullShader->SetUniform<float>("uLodThreshold", mLodSelection.threshold);
+  }
+
+  bool useOcclusion = occlusion && occlusion->IsValid();
+  mCullShader->SetUniform<int32_t>("uOcclusion", useOcclusion ? 1 : 0);
+  if (useOcclusion) {
+    occlusion->Bind(0);
+    mCullShader->SetUniform<glm::mat4>("uPyramidViewProjection",
+                                       occlusion->GetViewProjection());
+    mCullShader->SetUniform<glm::vec2>(
+        "uPyramidSize",
+        glm::vec2(occlusion->GetWidth(), occlusion->GetHeight()));
+    mCullShader->SetUniform<int32_t>(
+        "uPyramidLevels", static_cast<int32_t>(occlusion->GetLevelCount()));
+  }
+
+  mBoundsBuffer->BindBase(BufferTarget::ShaderStorage, 0);
+  mCommandBuffer->BindBase(BufferTarget::ShaderStorage, 1);
+  mVisibleCommandBuffer->BindBase(BufferTarget::ShaderStorage, 2);
+  mDrawCountBuffer->BindBase(BufferTarget::ShaderStorage, 3);
+  mLodTableBuffer->BindBase(BufferTarget::ShaderStorage, 4);
+
+  RenderCall::DispatchCompute(
+      (mObjectCount + Utils::kCullGroupSize - 1) / Utils::kCullGroupSize, 1, 1);
+  RenderCall::ShaderStorageBarrier();
+}
+
+void GpuCulling::Draw(const Utils::IndexType indexType) const {
+  if (mObjectCount == 0) {
+    return;
+  }
+  mVisibleCommandBuffer->Bind(BufferTarget::DrawIndirect);
+  if (mCompact) {
+    mDrawCountBuffer->Bind(BufferTarget::Parameter);
+    RenderCall::MultiDrawElementsIndirectCount(mObjectCount, indexType);
+  } else {
+    RenderCall::MultiDrawElementsIndirect(mObjectCount, indexType);
+  }
+}
+
+}  // namespace Peridot
@@ -38,6 +38,13 @@ std::tuple<double, double, double, double> PollModeInput::GetCursorPos() const {
                   cursorPositions.first, cursorPositions.second);
 }
 
+std::pair<double, double> PollModeInput::GetCurrentCursorPos() const {
+  std::pair<double, double> cursorPosition;
+  glfwGetCursorPos(mContext->GetRawWindow(), &cursorPosition.first,
+                   &cursorPosition.second);
+  return cursorPosition;
+}
+
 void PollModeInput::RegisterKeyCallback(const KeyCode key,
                                         const ButtonStateCallback& callback) {
   spdlog::trace(__FUNCTION__);
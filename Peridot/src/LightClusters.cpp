@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/LightClusters.h"
+#include "Peridot/RenderCalls.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr uint32_t kClusterGroupSize = 128;
+static constexpr size_t kInitialClusterLightCapacity = 256;
+
+// std140 layout of the ClusterParams block
+struct ClusterParams {
+  glm::mat4 view = glm::mat4(1.0f);
+  glm::uvec4 grid = glm::uvec4(0);
+  glm::vec4 depth = glm::vec4(0.0f);
+  glm::vec2 tileSize = glm::vec2(0.0f);
+  uint32_t logSlices = 0;
+  uint32_t padding = 0;
+};
+
+// What the culling and the shading side both read. A view distance maps
+// to its slice as log(distance) * scale + bias for perspective cameras and
+// distance * scale + bias for orthographic ones.
+static constexpr const char* kClusterDeclarationsSource = R"(
+struct PointLight {
+  vec4 position;
+  vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer ClusterLights {
+  PointLight lights[];
+};
+
+layout (std140, binding = 0) uniform ClusterParams {
+  mat4 uClusterView;
+  // xyz cluster counts, w number of lights
+  uvec4 uClusterGrid;
+  // near and far distance, slice scale and bias
+  vec4 uClusterDepth;
+  vec2 uClusterTileSize;
+  uint uClusterLogSlices;
+};
+
+uint GetClusterSlice(float distance) {
+  float slice = uClusterLogSlices != 0u ? log(max(distance, 1e-6)) : distance;
+  slice = slice * uClusterDepth.z + uClusterDepth.w;
+  return uint(clamp(slice, 0.0, float(uClusterGrid.z - 1u)));
+}
+)";
+
+// One invocation per cluster. Its view space bounds come from unprojecting
+// the tile corners onto the slice's near and far distance, lights are
+// moved to view space a workgroup sized batch at a time through shared
+// memory and tested as spheres against the bounds. The index buffer has
+// room for every cluster to be full, so the offsets never overflow it.
+static constexpr const char* kClusterCullSource = R"(
+layout (local_size_x = 128) in;
+
+layout (std430, binding = 1) writeonly buffer ClusterRanges {
+  uvec2 clusters[];
+};
+
+layout (std430, binding = 2) writeonly buffer ClusterLightIndices {
+  uint lightIndices[];
+};
+
+layout (std430, binding = 3) buffer ClusterIndexCount {
+  uint indexCount;
+};
+
+uniform mat4 uInverseProjection;
+
+// LightClusters::kMaxLightsPerCluster
+const uint kMaxLights = 128u;
+
+shared vec4 sLights[128];
+
+float GetSliceDistance(float slice) {
+  float value = (slice - uClusterDepth.w) / uClusterDepth.z;
+  return uClusterLogSlices != 0u ? exp(value) : value;
+}
+
+// view space point distance in front of the camera on the ray through ndc
+vec3 GetPointAtDistance(vec2 ndc, float distance) {
+  vec4 near = uInverseProjection * vec4(ndc, -1.0, 1.0);
+  vec4 far = uInverseProjection * vec4(ndc, 1.0, 1.0);
+  vec3 a = near.xyz / near.w;
+  vec3 b = far.xyz / far.w;
+  return mix(a, b, (-distance - a.z) / (b.z - a.z));
+}
+
+void main() {
+  uint clusterCount = uClusterGrid.x * uClusterGrid.y * uClusterGrid.z;
+  uint cluster = gl_GlobalInvocationID.x;
+  bool active = cluster < clusterCount;
+
+  vec3 boundsMin = vec3(1e30);
+  vec3 boundsMax = vec3(-1e30);
+  if (active) {
+    uvec3 id = uvec3(cluster % uClusterGrid.x,
+                     (cluster / uClusterGrid.x) % uClusterGrid.y,
+                     cluster / (uClusterGrid.x * uClusterGrid.y));
+    vec2 ndcMin = vec2(id.xy) / vec2(uClusterGrid.xy) * 2.0 - 1.0;
+    vec2 ndcMax = vec2(id.xy + 1u) / vec2(uClusterGrid.xy) * 2.0 - 1.0;
+    float nearDistance = GetSliceDistance(float(id.z));
+    float farDistance = GetSliceDistance(float(id.z + 1u));
+    for (int corner = 0; corner < 8; corner++) {
+      vec2 ndc = vec2((corner & 1) != 0 ? ndcMax.x : ndcMin.x,
+                      (corner & 2) != 0 ? ndcMax.y : ndcMin.y);
+      vec3 point = GetPointAtDistance(
+          ndc, (corner & 4) != 0 ? farDistance : nearDistance);
+      boundsMin = min(boundsMin, point);
+      boundsMax = max(boundsMax, point);
+    }
+  }
+
+  uint found[kMaxLights];
+  uint count = 0u;
+  uint lightCount = uClusterGrid.w;
+  for (uint batch = 0u; batch < lightCount; batch += gl_WorkGroupSize.x) {
+    uint index = batch + gl_LocalInvocationIndex;
+    if (index < lightCount) {
+      vec4 position = lights[index].position;
+      sLights[gl_LocalInvocationIndex] =
+          vec4((uClusterView * vec4(position.xyz, 1.0)).xyz, position.w);
+    }
+    barrier();
+    uint batchSize = min(gl_WorkGroupSize.x, lightCount - batch);
+    for (uint i = 0u; active && i < batchSize && count < kMaxLights; i++) {
+      vec4 sphere = sLights[i];
+      vec3 offset = clamp(sphere.xyz, boundsMin, boundsMax) - sphere.xyz;
+      if (dot(offset, offset) <= sphere.w * sphere.w) {
+        found[count] = batch + i;
+        count++;
+      }
+    }
+    barrier();
+  }
+
+  if (!active) {
+    return;
+  }
+  uint offset = atomicAdd(indexCount, count);
+  for (uint i = 0u; i < count; i++) {
+    lightIndices[offset + i] = found[i];
+  }
+  clusters[cluster] = uvec2(offset, count);
+}
+)";
+
+static constexpr const char* kClusterShadingSource = R"(
+layout (std430, binding = 1) readonly buffer ClusterRanges {
+  uvec2 clusters[];
+};
+
+layout (std430, binding = 2) readonly buffer ClusterLightIndices {
+  uint lightIndices[];
+};
+
+// offset into lightIndices and light count of the fragment's cluster
+uvec2 GetClusterLights(vec3 worldPosition) {
+  float distance = -(uClusterView * vec4(worldPosition, 1.0)).z;
+  uvec2 tile = min(uvec2(gl_FragCoord.xy / uClusterTileSize),
+                   uClusterGrid.xy - 1u);
+  uint slice = GetClusterSlice(distance);
+  return clusters[tile.x + uClusterGrid.x * (tile.y + uClusterGrid.y * slice)];
+}
+
+// inverse square, windowed so it reaches zero at the radius
+float GetPointLightAttenuation(PointLight light, vec3 worldPosition) {
+  float distance = length(light.position.xyz - worldPosition);
+  float window = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+  return window * window / (distance * distance + 1.0);
+}
+
+// Lambert diffuse from every light of the fragment's cluster
+vec3 ShadeClusterLights(vec3 worldPosition, vec3 normal, vec3 albedo) {
+  uvec2 range = GetClusterLights(worldPosition);
+  vec3 color = vec3(0.0);
+  for (uint i = 0u; i < range.y; i++) {
+    PointLight light = lights[lightIndices[range.x + i]];
+    vec3 toLight = normalize(light.position.xyz - worldPosition);
+    color += albedo * light.color.rgb *
+             GetPointLightAttenuation(light, worldPosition) *
+             max(dot(normal, toLight), 0.0);
+  }
+  return color;
+}
+)";
+
+}  // namespace Utils
+
+static_assert(sizeof(Utils::ClusterParams) == 112,
+              "ClusterParams has to match the std140 block");
+
+std::shared_ptr<LightClusters> LightClusters::Create() {
+  spdlog::trace(__FUNCTION__);
+  auto clusters = std::make_shared<LightClusters>();
+  const std::string cullSource = std::string("#version 450 core\n") +
+                                 Utils::kClusterDeclarationsSource +
+                                 Utils::kClusterCullSource;
+  clusters->mCullShader = Shader::CreateFromSource(
+      {{ShaderType::ComputeShader, cullSource.c_str()}});
+  if (!clusters->mCullShader) {
+    spdlog::error("failed to build light cluster shader");
+    return nullptr;
+  }
+
+  const size_t clusterCount = kGridWidth * kGridHeight * kGridDepth;
+  clusters->mParamsBuffer =
+      StorageBuffer::Create(nullptr, sizeof(Utils::ClusterParams));
+  clusters->mLightBuffer = StorageBuffer::Create(
+      nullptr, Utils::kInitialClusterLightCapacity * sizeof(GpuPointLight));
+  clusters->mClusterBuffer =
+      StorageBuffer::Create(nullptr, clusterCount * sizeof(glm::uvec2));
+  clusters->mIndexBuffer = StorageBuffer::Create(
+      nullptr, clusterCount * kMaxLightsPerCluster * sizeof(uint32_t));
+  clusters->mIndexCountBuffer =
+      StorageBuffer::Create(nullptr, sizeof(uint32_t));
+  return clusters;
+}
+
+LightClusters::~LightClusters() { spdlog::trace(__FUNCTION__); }
+
+void LightClusters::Update(const Camera& camera, const GpuPointLight* lights,
+                           const size_t lightCount, const uint32_t width,
+                           const uint32_t height) {
+  const bool perspective = camera.GetProjection() == Camera::Perspective;
+  // perspective projections clamp the near plane the same way
+  const float nearPlane =
+      perspective ? std::max(0.1f, camera.GetNearClippingPlane())
+                  : camera.GetNearClippingPlane();
+  const float farPlane = camera.GetFarClippingPlane();
+  const bool logSlices = perspective && farPlane > nearPlane;
+
+  Utils::ClusterParams params;
+  params.view = camera.GetViewMatrix();
+  params.grid = glm::uvec4(kGridWidth, kGridHeight, kGridDepth,
+                           static_cast<uint32_t>(lightCount));
+  float scale;
+  float bias;
+  if (logSlices) {
+    scale = kGridDepth / std::log(farPlane / nearPlane);
+    bias = -std::log(nearPlane) * scale;
+  } else {
+    scale = kGridDepth / std::max(farPlane - nearPlane, 1e-6f);
+    bias = -nearPlane * scale;
+  }
+  params.depth = glm::vec4(nearPlane, farPlane, scale, bias);
+  params.tileSize = glm::vec2(static_cast<float>(width) / kGridWidth,
+                              static_cast<float>(height) / kGridHeight);
+  params.logSlices = logSlices ? 1 : 0;
+  mParamsBuffer->SetData(&params, sizeof(params));
+
+  const size_t size = lightCount * sizeof(GpuPointLight);
+  if (mLightBuffer->GetSize() < size) {
+    mLightBuffer->Resize(std::max(size, mLightBuffer->GetSize() * 2));
+  }
+  if (size > 0) {
+    mLightBuffer->SetData(lights, size);
+  }
+  mLightCount = lightCount;
+
+  const uint32_t zero = 0;
+  mIndexCountBuffer->SetData(&zero, sizeof(zero));
+
+  Bind();
+  mIndexCountBuffer->BindBase(BufferTarget::ShaderStorage, 3);
+  mCullShader->Bind();
+  mCullShader->SetUniform<glm::mat4>("uInverseProjection",
+                                     camera.GetInverseProjectionMatrix());
+  const uint32_t clusterCount = kGridWidth * kGridHeight * kGridDepth;
+  RenderCall::DispatchCompute(
+      (clusterCount + Utils::kClusterGroupSize - 1) / Utils::kClusterGroupSize,
+      1, 1);
+  RenderCall::ShaderStorageBarrier();
+}
+
+void LightClusters::Bind() const {
+  mParamsBuffer->BindBase(BufferTarget::Uniform, 0);
+  mLightBuffer->BindBase(BufferTarget::ShaderStorage, 0);
+  mClusterBuffer->BindBase(BufferTarget::ShaderStorage, 1);
+  mIndexBuffer->BindBase(BufferTarget::ShaderStorage, 2);
+}
+
+const char* LightClusters::GetShaderSource() {
+  static const std::string source =
+      std::string(Utils::kClusterDeclarationsSource) +
+      Utils::kClusterShadingSource;
+  return source.c_str();
+}
+
+}  // namespace Peridot
@@ -0,0 +1,108 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/MappedFile.h"
+
+namespace Peridot {
+
+std::shared_ptr<MappedFile> MappedFile::Open(const char* filePath) {
+  spdlog::trace(__FUNCTION__);
+  auto file = std::make_shared<MappedFile>();
+
+#ifdef _WIN32
+  HANDLE handle =
+      CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    spdlog::error("failed to open {}", filePath);
+    return nullptr;
+  }
+  file->mFile = handle;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size)) {
+    spdlog::error("failed to get the size of {}", filePath);
+    return nullptr;
+  }
+  file->mSize = static_cast<size_t>(size.QuadPart);
+  if (file->mSize == 0) {
+    return file;
+  }
+
+  file->mMapping =
+      CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!file->mMapping) {
+    spdlog::error("failed to map {}", filePath);
+    return nullptr;
+  }
+  file->mData = static_cast<const uint8_t*>(
+      MapViewOfFile(file->mMapping, FILE_MAP_READ, 0, 0, 0));
+#else
+  int descriptor = open(filePath, O_RDONLY);
+  if (descriptor < 0) {
+    spdlog::error("failed to open {}", filePath);
+    return nullptr;
+  }
+
+  struct stat status;
+  if (fstat(descriptor, &status) != 0) {
+    close(descriptor);
+    spdlog::error("failed to get the size of {}", filePath);
+    return nullptr;
+  }
+  file->mSize = static_cast<size_t>(status.st_size);
+  if (file->mSize == 0) {
+    close(descriptor);
+    return file;
+  }
+
+  void* data =
+      mmap(nullptr, file->mSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  // the mapping keeps its own reference to the file
+  close(descriptor);
+  if (data == MAP_FAILED) {
+    file->mSize = 0;
+    spdlog::error("failed to map {}", filePath);
+    return nullptr;
+  }
+  madvise(data, file->mSize, MADV_WILLNEED);
+  file->mData = static_cast<const uint8_t*>(data);
+#endif
+
+  if (!file->mData) {
+    spdlog::error("failed to map {}", filePath);
+    return nullptr;
+  }
+  return file;
+}
+
+MappedFile::~MappedFile() {
+  spdlog::trace(__FUNCTION__);
+#ifdef _WIN32
+  if (mData) {
+    UnmapViewOfFile(mData);
+  }
+  if (mMapping) {
+    CloseHandle(mMapping);
+  }
+  if (mFile) {
+    CloseHandle(mFile);
+  }
+#else
+  if (mData) {
+    munmap(const_cast<uint8_t*>(mData), mSize);
+  }
+#endif
+}
+
+}  // namespace Peridot
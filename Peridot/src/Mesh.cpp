@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/Mesh.h"
+#include "Peridot/MeshFile.h"
+#include "Peridot/MeshOptimizer.h"
+#include "Peridot/MeshLoader.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+// lower case, without the dot
+static std::string FileExtension(const char* filePath) {
+  std::string path(filePath);
+  auto dot = path.find_last_of('.');
+  std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return extension;
+}
+
+}  // namespace Utils
+
+const BufferLayout& MeshVertex::Layout() {
+  return VertexLayout<MeshVertex>();
+}
+
+uint32_t SelectLod(const MeshLod* lods, const uint32_t lodCount,
+                   const float pixelsPerUnit, const float pixelThreshold) {
+  // errors grow with the level, the first one over the threshold ends it
+  uint32_t selected = 0;
+  for (uint32_t i = 1; i < lodCount; i++) {
+    if (lods[i].error * pixelsPerUnit > pixelThreshold) {
+      break;
+    }
+    selected = i;
+  }
+  return selected;
+}
+
+void MeshData::ComputeBounds() {
+  if (vertices.empty()) {
+    bounds = AABB();
+    return;
+  }
+  bounds = {vertices[0].position, vertices[0].position};
+  for (const auto& vertex : vertices) {
+    bounds.min = glm::min(bounds.min, vertex.position);
+    bounds.max = glm::max(bounds.max, vertex.position);
+  }
+}
+
+void MeshData::GenerateMissingNormals() {
+  std::vector<uint8_t> missing(vertices.size(), 0);
+  bool anyMissing = false;
+  for (size_t i = 0; i < vertices.size(); i++) {
+    if (vertices[i].normal == glm::vec3(0.0f)) {
+      missing[i] = 1;
+      anyMissing = true;
+    }
+  }
+  if (!anyMissing) {
+    return;
+  }
+
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const uint32_t corners[3] = {indices[i], indices[i + 1], indices[i + 2]};
+    // the cross product's length is twice the area, which does the weighting
+    auto normal = glm::cross(
+        vertices[corners[1]].position - vertices[corners[0]].position,
+        vertices[corners[2]].position - vertices[corners[0]].position);
+    for (auto corner : corners) {
+      if (missing[corner]) {
+        vertices[corner].normal += normal;
+      }
+    }
+  }
+  for (size_t i = 0; i < vertices.size(); i++) {
+    if (!missing[i]) {
+      continue;
+    }
+    float length = glm::length(vertices[i].normal);
+    vertices[i].normal = length > 0.0f ? vertices[i].normal / length
+                                       : glm::vec3(0.0f, 1.0f, 0.0f);
+  }
+}
+
+std::shared_ptr<Mesh> Mesh::Create(const MeshData& meshData) {
+  spdlog::trace(__FUNCTION__);
+  const auto vertexCount = static_cast<uint32_t>(meshData.vertices.size());
+  const auto indexCount = static_cast<uint32_t>(meshData.indices.size());
+  if (Fits16BitIndices(vertexCount)) {
+    auto indices = ConvertTo16BitIndices(meshData.indices);
+    return Create(meshData.vertices.data(), vertexCount, MeshVertex::Layout(),
+                  indices.data(), indexCount, Utils::IndexType::UInt16,
+                  meshData.bounds, meshData.lods);
+  }
+  return Create(meshData.vertices.data(), vertexCount, MeshVertex::Layout(),
+                meshData.indices.data(), indexCount, Utils::IndexType::UInt32,
+                meshData.bounds, meshData.lods);
+}
+
+std::shared_ptr<Mesh> Mesh::Create(const void* vertices,
+                                   const uint32_t vertexCount,
+                                   const BufferLayout& layout,
+                                   const void* indices,
+                                   const uint32_t indexCount,
+                                   const Utils::IndexType indexType,
+                                   const AABB& bounds,
+                                   const std::vector<MeshLod>& lods) {
+  spdlog::trace(__FUNCTION__);
+  if (vertexCount == 0 || indexCount == 0) {
+    spdlog::error("can't create a mesh without vertices or indices");
+    return nullptr;
+  }
+  if (lods.size() > kMaxMeshLods) {
+    spdlog::error("a mesh can have at most {} LODs", kMaxMeshLods);
+    return nullptr;
+  }
+  for (const auto& lod : lods) {
+    if (lod.indexCount == 0 || lod.firstIndex > indexCount ||
+        lod.indexCount > indexCount - lod.firstIndex) {
+      spdlog::error("LOD index range out of bounds");
+      return nullptr;
+    }
+  }
+
+  auto geometry = GeometryAllocation::Create(
+      GeometryPoolCache::Get().Acquire(layout, indexType), vertices,
+      vertexCount, indices, indexCount);
+  if (!geometry) {
+    return nullptr;
+  }
+
+  auto mesh = std::make_shared<Mesh>();
+  mesh->mGeometry = geometry;
+  mesh->mVertexCount = vertexCount;
+  mesh->mIndexCount = indexCount;
+  mesh->mIndexType = indexType;
+  mesh->mBounds = bounds;
+  mesh->mLods = lods;
+  if (mesh->mLods.empty()) {
+    mesh->mLods.push_back({0, indexCount, 0.0f});
+  }
+  return mesh;
+}
+
+std::shared_ptr<Mesh> Mesh::Load(const char* filePath) {
+  spdlog::trace(__FUNCTION__);
+  if (Utils::FileExtension(filePath) == "pmesh") {
+    return LoadMeshFile(filePath);
+  }
+  MeshData meshData;
+  if (!LoadMeshData(filePath, meshData)) {
+    return nullptr;
+  }
+  return Create(meshData);
+}
+
+bool LoadMeshData(const char* filePath, MeshData& meshData) {
+  auto extension = Utils::FileExtension(filePath);
+  if (extension == "obj") {
+    return LoadObj(filePath, meshData);
+  }
+  if (extension == "glb") {
+    return LoadGlb(filePath, meshData);
+  }
+  spdlog::error("no mesh loader for {}", filePath);
+  return false;
+}
+
+}  // namespace Peridot
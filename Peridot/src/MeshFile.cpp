@@ -0,0 +1,232 @@
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/MappedFile.h"
+#include "Peridot/MeshFile.h"
+#include "Peridot/MeshOptimizer.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static uint64_t AlignFileOffset(const uint64_t offset) {
+  return (offset + kMeshFileAlignment - 1) / kMeshFileAlignment *
+         kMeshFileAlignment;
+}
+
+// BufferElement only keeps a pointer to its name, names read from files are
+// kept alive here for the rest of the program
+static const char* InternAttributeName(const char* name) {
+  static std::mutex mutex;
+  static std::unordered_set<std::string> names;
+  std::lock_guard<std::mutex> lock(mutex);
+  return names.emplace(name).first->c_str();
+}
+
+static bool ReadMeshFileLayout(const char* filePath,
+                               const MeshFileHeader& header,
+                               const MeshFileAttribute* attributes,
+                               BufferLayout& layout) {
+  layout.stride = header.vertexStride;
+  for (uint32_t i = 0; i < header.attributeCount; i++) {
+    const auto& attribute = attributes[i];
+    auto type = static_cast<Type>(attribute.type);
+    if (type == Type::None || type > Type::PackedU1010102) {
+      spdlog::error("{} has an unknown vertex attribute type", filePath);
+      return false;
+    }
+    size_t size = SizeInBytes(type);
+    if (attribute.offset + size > header.vertexStride ||
+        attribute.normalized > 1 ||
+        std::memchr(attribute.name, '\0', sizeof(attribute.name)) == nullptr) {
+      spdlog::error("{} has an invalid vertex attribute {}", filePath, i);
+      return false;
+    }
+    BufferElement element(type, InternAttributeName(attribute.name),
+                          attribute.normalized != 0);
+    element.offset = attribute.offset;
+    layout.layout.push_back(element);
+  }
+  return true;
+}
+
+}  // namespace Utils
+
+bool WriteMeshFile(const char* filePath, const MeshData& meshData) {
+  spdlog::trace(__FUNCTION__);
+  const auto& layout = MeshVertex::Layout();
+
+  MeshFileHeader header;
+  header.vertexCount = static_cast<uint32_t>(meshData.vertices.size());
+  header.indexCount = static_cast<uint32_t>(meshData.indices.size());
+  header.vertexStride = static_cast<uint32_t>(layout.stride);
+  const bool shortIndices = Fits16BitIndices(meshData.vertices.size());
+  header.indexSize = shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+  header.attributeCount = static_cast<uint32_t>(layout.layout.size());
+  header.lodCount = static_cast<uint32_t>(meshData.lods.size());
+  for (int i = 0; i < 3; i++) {
+    header.boundsMin[i] = meshData.bounds.min[i];
+    header.boundsMax[i] = meshData.bounds.max[i];
+  }
+
+  std::vector<MeshFileAttribute> attributes(layout.layout.size());
+  for (size_t i = 0; i < layout.layout.size(); i++) {
+    const auto& element = layout.layout[i];
+    attributes[i].type = static_cast<uint32_t>(element.elementType);
+    attributes[i].offset = static_cast<uint32_t>(element.offset);
+    attributes[i].normalized = element.normalized ? 1 : 0;
+    std::strncpy(attributes[i].name, element.name,
+                 sizeof(attributes[i].name) - 1);
+  }
+
+  std::vector<MeshFileLod> lods(meshData.lods.size());
+  for (size_t i = 0; i < meshData.lods.size(); i++) {
+    lods[i].firstIndex = meshData.lods[i].firstIndex;
+    lods[i].indexCount = meshData.lods[i].indexCount;
+    lods[i].error = meshData.lods[i].error;
+  }
+
+  uint64_t vertexBytes = uint64_t(header.vertexCount) * header.vertexStride;
+  uint64_t indexBytes = uint64_t(header.indexCount) * header.indexSize;
+  header.vertexOffset = Utils::AlignFileOffset(
+      sizeof(MeshFileHeader) +
+      sizeof(MeshFileAttribute) * uint64_t(header.attributeCount) +
+      sizeof(MeshFileLod) * uint64_t(header.lodCount));
+  header.indexOffset =
+      Utils::AlignFileOffset(header.vertexOffset + vertexBytes);
+
+  std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    spdlog::error("failed to open {} for writing", filePath);
+    return false;
+  }
+  const char padding[kMeshFileAlignment] = {};
+  auto pad = [&file, &padding](const uint64_t offset) {
+    auto position = static_cast<uint64_t>(file.tellp());
+    file.write(padding, static_cast<std::streamsize>(offset - position));
+  };
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(attributes.data()),
+             sizeof(MeshFileAttribute) * attributes.size());
+  file.write(reinterpret_cast<const char*>(lods.data()),
+             sizeof(MeshFileLod) * lods.size());
+  pad(header.vertexOffset);
+  file.write(reinterpret_cast<const char*>(meshData.vertices.data()),
+             static_cast<std::streamsize>(vertexBytes));
+  pad(header.indexOffset);
+  if (shortIndices) {
+    auto indices = ConvertTo16BitIndices(meshData.indices);
+    file.write(reinterpret_cast<const char*>(indices.data()),
+               static_cast<std::streamsize>(indexBytes));
+  } else {
+    file.write(reinterpret_cast<const char*>(meshData.indices.data()),
+               static_cast<std::streamsize>(indexBytes));
+  }
+  if (!file) {
+    spdlog::error("failed to write {}", filePath);
+    return false;
+  }
+  return true;
+}
+
+std::shared_ptr<Mesh> LoadMeshFile(const char* filePath) {
+  spdlog::trace(__FUNCTION__);
+  auto file = MappedFile::Open(filePath);
+  if (!file) {
+    return nullptr;
+  }
+
+  const auto* data = static_cast<const uint8_t*>(file->GetData());
+  const uint64_t size = file->GetSize();
+  MeshFileHeader header;
+  if (size < sizeof(header)) {
+    spdlog::error("{} is too small to be a mesh file", filePath);
+    return nullptr;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.magic != kMeshFileMagic) {
+    spdlog::error("{} is not a mesh file", filePath);
+    return nullptr;
+  }
+  if (header.version != kMeshFileVersion) {
+    spdlog::error("{} has version {}, expected {}", filePath, header.version,
+                  kMeshFileVersion);
+    return nullptr;
+  }
+  Utils::IndexType indexType;
+  switch (header.indexSize) {
+    case 1:
+      indexType = Utils::IndexType::UInt8;
+      break;
+    case 2:
+      indexType = Utils::IndexType::UInt16;
+      break;
+    case 4:
+      indexType = Utils::IndexType::UInt32;
+      break;
+    default:
+      spdlog::error("{} has unsupported {} byte indices", filePath,
+                    header.indexSize);
+      return nullptr;
+  }
+
+  // everything is checked against the file size before it's touched, the
+  // index values themselves are trusted
+  uint64_t tablesEnd =
+      sizeof(header) +
+      sizeof(MeshFileAttribute) * uint64_t(header.attributeCount) +
+      sizeof(MeshFileLod) * uint64_t(header.lodCount);
+  uint64_t vertexBytes = uint64_t(header.vertexCount) * header.vertexStride;
+  uint64_t indexBytes = uint64_t(header.indexCount) * header.indexSize;
+  if (header.attributeCount == 0 || header.vertexStride == 0 ||
+      header.lodCount > kMaxMeshLods || tablesEnd > size ||
+      header.vertexOffset < tablesEnd ||
+      header.vertexOffset % kMeshFileAlignment != 0 ||
+      header.indexOffset % kMeshFileAlignment != 0 ||
+      header.vertexOffset > size || vertexBytes > size - header.vertexOffset ||
+      header.indexOffset > size || indexBytes > size - header.indexOffset) {
+    spdlog::error("{} is truncated or has an invalid layout", filePath);
+    return nullptr;
+  }
+
+  std::vector<MeshFileAttribute> attributes(header.attributeCount);
+  std::memcpy(attributes.data(), data + sizeof(header),
+              sizeof(MeshFileAttribute) * attributes.size());
+  BufferLayout layout;
+  if (!Utils::ReadMeshFileLayout(filePath, header, attributes.data(),
+                                 layout)) {
+    return nullptr;
+  }
+
+  // Mesh::Create checks the ranges
+  std::vector<MeshLod> lods(header.lodCount);
+  for (uint32_t i = 0; i < header.lodCount; i++) {
+    MeshFileLod lod;
+    std::memcpy(&lod,
+                data + sizeof(header) +
+                    sizeof(MeshFileAttribute) * attributes.size() +
+                    sizeof(MeshFileLod) * i,
+                sizeof(lod));
+    lods[i] = {lod.firstIndex, lod.indexCount, lod.error};
+  }
+
+  AABB bounds{glm::vec3(header.boundsMin[0], header.boundsMin[1],
+                        header.boundsMin[2]),
+              glm::vec3(header.boundsMax[0], header.boundsMax[1],
+                        header.boundsMax[2])};
+  auto mesh = Mesh::Create(data + header.vertexOffset, header.vertexCount,
+                           layout, data + header.indexOffset,
+                           header.indexCount, indexType, bounds, lods);
+  if (mesh) {
+    spdlog::info("loaded {}: {} vertices, {} triangles", filePath,
+                 header.vertexCount, header.indexCount / 3);
+  }
+  return mesh;
+}
+
+}  // namespace Peridot
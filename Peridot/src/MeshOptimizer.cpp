@@ -0,0 +1,668 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/MeshOptimizer.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+static constexpr uint32_t kNoVertex = std::numeric_limits<uint32_t>::max();
+
+// Triangles around every vertex in one flat array, triangles of vertex v
+// are triangles[offsets[v]] up to triangles[offsets[v + 1]].
+struct VertexAdjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+  std::vector<uint32_t> liveCounts;
+};
+
+static void BuildAdjacency(const std::vector<uint32_t>& indices,
+                           const size_t vertexCount,
+                           VertexAdjacency& adjacency) {
+  adjacency.liveCounts.assign(vertexCount, 0);
+  for (auto index : indices) {
+    adjacency.liveCounts[index] += 1;
+  }
+  adjacency.offsets.assign(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++) {
+    adjacency.offsets[v + 1] = adjacency.offsets[v] + adjacency.liveCounts[v];
+  }
+  adjacency.triangles.resize(indices.size());
+  std::vector<uint32_t> cursors(adjacency.offsets.begin(),
+                                adjacency.offsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency.triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+}
+
+// Counts misses of a FIFO cache. An entry is cached while fewer than
+// cacheSize misses happened since it was inserted, tracked with timestamps
+// so the simulation is O(1) per vertex.
+struct CacheSimulator {
+  CacheSimulator(const size_t vertexCount, const uint32_t cacheSize_)
+      : timestamps(vertexCount, 0), time(cacheSize_ + 1),
+        cacheSize(cacheSize_) {}
+
+  bool IsCached(const uint32_t vertex) const {
+    return time - timestamps[vertex] <= cacheSize;
+  }
+  // returns true on a miss
+  bool Access(const uint32_t vertex) {
+    if (IsCached(vertex)) {
+      return false;
+    }
+    timestamps[vertex] = time++;
+    return true;
+  }
+  void Flush() { time += cacheSize + 1; }
+
+  std::vector<uint32_t> timestamps;
+  uint32_t time;
+  uint32_t cacheSize;
+};
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix
+// of Garland and Heckbert. Planes are weighted by triangle area and the
+// total weight is kept so errors can be turned back into a distance.
+struct Quadric {
+  double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+  double a11 = 0, a12 = 0, a13 = 0;
+  double a22 = 0, a23 = 0;
+  double a33 = 0;
+  double weight = 0;
+
+  void AddPlane(const glm::vec3& normal, const double distance,
+                const double planeWeight) {
+    a00 += planeWeight * normal.x * normal.x;
+    a01 += planeWeight * normal.x * normal.y;
+    a02 += planeWeight * normal.x * normal.z;
+    a03 += planeWeight * normal.x * distance;
+    a11 += planeWeight * normal.y * normal.y;
+    a12 += planeWeight * normal.y * normal.z;
+    a13 += planeWeight * normal.y * distance;
+    a22 += planeWeight * normal.z * normal.z;
+    a23 += planeWeight * normal.z * distance;
+    a33 += planeWeight * distance * distance;
+    weight += planeWeight;
+  }
+
+  Quadric& operator+=(const Quadric& other) {
+    a00 += other.a00, a01 += other.a01, a02 += other.a02, a03 += other.a03;
+    a11 += other.a11, a12 += other.a12, a13 += other.a13;
+    a22 += other.a22, a23 += other.a23;
+    a33 += other.a33;
+    weight += other.weight;
+    return *this;
+  }
+
+  double Error(const glm::vec3& point) const {
+    const double x = point.x, y = point.y, z = point.z;
+    double error = a00 * x * x + a11 * y * y + a22 * z * z + a33 +
+                   2.0 * (a01 * x * y + a02 * x * z + a12 * y * z +
+                          a03 * x + a13 * y + a23 * z);
+    return std::max(error, 0.0);
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+static uint64_t EdgeKey(uint32_t a, uint32_t b) {
+  if (a > b) {
+    std::swap(a, b);
+  }
+  return (uint64_t(a) << 32) | b;
+}
+
+// Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw". Fans around one vertex at a time and moves on to a neighbour
+// that will still be cached after its own fan, falling back to recently
+// used vertices and then a linear scan at dead ends. Those dead ends are
+// written to clusters as the first triangle after them.
+static std::vector<uint32_t> Tipsify(const std::vector<uint32_t>& indices,
+                                     const size_t vertexCount,
+                                     const uint32_t cacheSize,
+                                     std::vector<uint32_t>* clusters) {
+  VertexAdjacency adjacency;
+  BuildAdjacency(indices, vertexCount, adjacency);
+  auto& liveCounts = adjacency.liveCounts;
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  std::vector<uint8_t> emitted(indices.size() / 3, 0);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  CacheSimulator cache(vertexCount, cacheSize);
+  uint32_t cursor = 0;
+
+  auto skipDeadEnd = [&]() {
+    while (!deadEnds.empty()) {
+      auto vertex = deadEnds.back();
+      deadEnds.pop_back();
+      if (liveCounts[vertex] > 0) {
+        return vertex;
+      }
+    }
+    while (cursor < vertexCount) {
+      if (liveCounts[cursor] > 0) {
+        return cursor;
+      }
+      cursor++;
+    }
+    return kNoVertex;
+  };
+
+  auto fanning = skipDeadEnd();
+  if (clusters && fanning != kNoVertex) {
+    clusters->push_back(0);
+  }
+  while (fanning != kNoVertex) {
+    candidates.clear();
+    for (auto i = adjacency.offsets[fanning];
+         i < adjacency.offsets[fanning + 1]; i++) {
+      auto triangle = adjacency.triangles[i];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = 1;
+      for (int corner = 0; corner < 3; corner++) {
+        auto vertex = indices[triangle * 3 + corner];
+        output.push_back(vertex);
+        deadEnds.push_back(vertex);
+        candidates.push_back(vertex);
+        liveCounts[vertex] -= 1;
+        cache.Access(vertex);
+      }
+    }
+
+    // prefer the oldest candidate that stays cached through its own fan
+    auto next = kNoVertex;
+    int64_t bestPriority = -1;
+    for (auto vertex : candidates) {
+      if (liveCounts[vertex] == 0) {
+        continue;
+      }
+      int64_t age = cache.time - cache.timestamps[vertex];
+      int64_t priority = 0;
+      if (age + 2 * int64_t(liveCounts[vertex]) <= cacheSize) {
+        priority = age;
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = vertex;
+      }
+    }
+    if (next == kNoVertex) {
+      next = skipDeadEnd();
+      if (clusters && next != kNoVertex) {
+        clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+      }
+    }
+    fanning = next;
+  }
+  return output;
+}
+
+}  // namespace Utils
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices,
+                         const size_t vertexCount,
+                         const uint32_t cacheSize) {
+  spdlog::trace(__FUNCTION__);
+  assert(indices.size() % 3 == 0 && "indices must form triangles");
+  indices = Utils::Tipsify(indices, vertexCount, cacheSize, nullptr);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices,
+                      const std::vector<MeshVertex>& vertices,
+                      const float threshold, const uint32_t cacheSize) {
+  spdlog::trace(__FUNCTION__);
+  assert(indices.size() % 3 == 0 && "indices must form triangles");
+  std::vector<uint32_t> hardClusters;
+  auto ordered =
+      Utils::Tipsify(indices, vertices.size(), cacheSize, &hardClusters);
+  const size_t triangleCount = ordered.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+  hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+
+  // Split the hard clusters further wherever the cache, flushed at the
+  // start of the cluster, already performs close to the whole mesh. More
+  // clusters sort better, each costs a cold cache.
+  float targetRatio =
+      threshold * AverageCacheMissRatio(ordered, vertices.size(), cacheSize);
+  std::vector<uint32_t> clusters;
+  Utils::CacheSimulator cache(vertices.size(), cacheSize);
+  for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+    const uint32_t end = hardClusters[c + 1];
+    uint32_t start = hardClusters[c];
+    uint32_t misses = 0;
+    clusters.push_back(start);
+    cache.Flush();
+    for (uint32_t triangle = start; triangle < end; triangle++) {
+      for (int corner = 0; corner < 3; corner++) {
+        misses += cache.Access(ordered[triangle * 3 + corner]);
+      }
+      if (triangle + 1 < end &&
+          misses <= targetRatio * float(triangle + 1 - start)) {
+        start = triangle + 1;
+        misses = 0;
+        clusters.push_back(start);
+        cache.Flush();
+      }
+    }
+  }
+  clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+  // Sort by how far each cluster faces away from the mesh center, outer
+  // surfaces are drawn first and occlude what is behind them.
+  auto triangleData = [&](const uint32_t triangle, glm::vec3& centroid,
+                          glm::vec3& normal) {
+    const auto& p0 = vertices[ordered[triangle * 3]].position;
+    const auto& p1 = vertices[ordered[triangle * 3 + 1]].position;
+    const auto& p2 = vertices[ordered[triangle * 3 + 2]].position;
+    // the cross product's length is twice the area and weights everything
+    normal = glm::cross(p1 - p0, p2 - p0);
+    centroid = (p0 + p1 + p2) / 3.0f;
+    return glm::length(normal);
+  };
+
+  glm::vec3 meshCenter(0.0f);
+  float meshArea = 0.0f;
+  for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+    glm::vec3 centroid, normal;
+    float area = triangleData(triangle, centroid, normal);
+    meshCenter += centroid * area;
+    meshArea += area;
+  }
+  meshCenter = meshArea > 0.0f ? meshCenter / meshArea : meshCenter;
+
+  const size_t clusterCount = clusters.size() - 1;
+  std::vector<float> sortKeys(clusterCount, 0.0f);
+  for (size_t c = 0; c < clusterCount; c++) {
+    glm::vec3 clusterCenter(0.0f), clusterNormal(0.0f);
+    float clusterArea = 0.0f;
+    for (uint32_t triangle = clusters[c]; triangle < clusters[c + 1];
+         triangle++) {
+      glm::vec3 centroid, normal;
+      float area = triangleData(triangle, centroid, normal);
+      clusterCenter += centroid * area;
+      clusterNormal += normal;
+      clusterArea += area;
+    }
+    float normalLength = glm::length(clusterNormal);
+    if (clusterArea > 0.0f && normalLength > 0.0f) {
+      sortKeys[c] = glm::dot(clusterCenter / clusterArea - meshCenter,
+                             clusterNormal / normalLength);
+    }
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++) {
+    order[c] = static_cast<uint32_t>(c);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&sortKeys](const uint32_t a, const uint32_t b) {
+                     return sortKeys[a] > sortKeys[b];
+                   });
+
+  indices.clear();
+  for (auto c : order) {
+    indices.insert(indices.end(), ordered.begin() + clusters[c] * 3,
+                   ordered.begin() + clusters[c + 1] * 3);
+  }
+}
+
+void OptimizeVertexFetch(MeshData& meshData) {
+  spdlog::trace(__FUNCTION__);
+  std::vector<uint32_t> remap(meshData.vertices.size(), Utils::kNoVertex);
+  uint32_t vertexCount = 0;
+  for (auto& index : meshData.indices) {
+    if (remap[index] == Utils::kNoVertex) {
+      remap[index] = vertexCount++;
+    }
+    index = remap[index];
+  }
+
+  std::vector<MeshVertex> vertices(vertexCount);
+  for (size_t v = 0; v < meshData.vertices.size(); v++) {
+    if (remap[v] != Utils::kNoVertex) {
+      vertices[remap[v]] = meshData.vertices[v];
+    }
+  }
+  meshData.vertices = std::move(vertices);
+}
+
+void OptimizeMesh(MeshData& meshData) {
+  spdlog::trace(__FUNCTION__);
+  float before = AverageCacheMissRatio(meshData.indices,
+                                       meshData.vertices.size());
+  if (meshData.lods.empty()) {
+    OptimizeOverdraw(meshData.indices, meshData.vertices);
+  } else {
+    // LODs are optimized on their own so their ranges stay intact
+    std::vector<uint32_t> lodIndices;
+    for (const auto& lod : meshData.lods) {
+      auto first = meshData.indices.begin() + lod.firstIndex;
+      lodIndices.assign(first, first + lod.indexCount);
+      OptimizeOverdraw(lodIndices, meshData.vertices);
+      std::copy(lodIndices.begin(), lodIndices.end(), first);
+    }
+  }
+  OptimizeVertexFetch(meshData);
+  spdlog::info("mesh optimized, ACMR {:.3f} -> {:.3f}", before,
+               AverageCacheMissRatio(meshData.indices,
+                                     meshData.vertices.size()));
+}
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<MeshVertex>& vertices,
+                                   const std::vector<uint32_t>& indices,
+                                   const size_t targetIndexCount,
+                                   float* resultError) {
+  spdlog::trace(__FUNCTION__);
+  assert(indices.size() % 3 == 0 && "indices must form triangles");
+
+  // Vertices split along normal or texture seams share a position. The
+  // collapse works on welded positions so seams don't tear, and every
+  // vertex is then moved to the target's vertex with the closest
+  // attributes.
+  std::vector<uint32_t> positionIds(vertices.size());
+  std::vector<glm::vec3> positions;
+  {
+    std::unordered_map<uint64_t, std::vector<uint32_t>> buckets;
+    for (uint32_t v = 0; v < vertices.size(); v++) {
+      const auto& position = vertices[v].position;
+      uint32_t bits[3];
+      std::memcpy(bits, &position, sizeof(bits));
+      uint64_t hash = bits[0];
+      hash = hash * 0x9E3779B97F4A7C15ull ^ bits[1];
+      hash = hash * 0x9E3779B97F4A7C15ull ^ bits[2];
+      auto& bucket = buckets[hash];
+      auto match = std::find_if(bucket.begin(), bucket.end(),
+                                [&](const uint32_t id) {
+                                  return positions[id] == position;
+                                });
+      if (match != bucket.end()) {
+        positionIds[v] = *match;
+      } else {
+        positionIds[v] = static_cast<uint32_t>(positions.size());
+        bucket.push_back(positionIds[v]);
+        positions.push_back(position);
+      }
+    }
+  }
+  const size_t positionCount = positions.size();
+  std::vector<uint32_t> wedgeOffsets(positionCount + 1, 0);
+  std::vector<uint32_t> wedges(vertices.size());
+  for (auto id : positionIds) {
+    wedgeOffsets[id + 1] += 1;
+  }
+  for (size_t p = 0; p < positionCount; p++) {
+    wedgeOffsets[p + 1] += wedgeOffsets[p];
+  }
+  {
+    std::vector<uint32_t> cursors(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+    for (uint32_t v = 0; v < vertices.size(); v++) {
+      wedges[cursors[positionIds[v]]++] = v;
+    }
+  }
+
+  std::vector<uint32_t> result = indices;
+  std::vector<uint32_t> welded(result.size());
+  for (size_t i = 0; i < result.size(); i++) {
+    welded[i] = positionIds[result[i]];
+  }
+
+  // borders and non-manifold edges lock their vertices
+  std::vector<uint8_t> locked(positionCount, 0);
+  std::vector<uint64_t> edges;
+  auto gatherEdges = [&edges, &welded]() {
+    edges.clear();
+    for (size_t i = 0; i < welded.size(); i += 3) {
+      for (int corner = 0; corner < 3; corner++) {
+        edges.push_back(Utils::EdgeKey(welded[i + corner],
+                                       welded[i + (corner + 1) % 3]));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+  };
+  gatherEdges();
+  for (size_t i = 0; i < edges.size();) {
+    size_t run = i;
+    while (run < edges.size() && edges[run] == edges[i]) {
+      run++;
+    }
+    if (run - i != 2) {
+      locked[edges[i] >> 32] = 1;
+      locked[edges[i] & 0xFFFFFFFF] = 1;
+    }
+    i = run;
+  }
+
+  std::vector<Utils::Quadric> quadrics(positionCount);
+  for (size_t i = 0; i < welded.size(); i += 3) {
+    const auto& p0 = positions[welded[i]];
+    const auto& p1 = positions[welded[i + 1]];
+    const auto& p2 = positions[welded[i + 2]];
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float area = glm::length(normal);
+    if (area == 0.0f) {
+      continue;
+    }
+    normal /= area;
+    for (int corner = 0; corner < 3; corner++) {
+      quadrics[welded[i + corner]].AddPlane(normal, -glm::dot(normal, p0),
+                                            area * 0.5);
+    }
+  }
+
+  auto collapseError = [&quadrics, &positions](const uint32_t from,
+                                               const uint32_t to) {
+    return quadrics[from].Error(positions[to]) +
+           quadrics[to].Error(positions[to]);
+  };
+
+  // Rejects collapses that flip or nearly flip a triangle around from.
+  std::vector<uint32_t> positionRemap(positionCount);
+  for (uint32_t p = 0; p < positionCount; p++) {
+    positionRemap[p] = p;
+  }
+  Utils::VertexAdjacency adjacency;
+  auto flips = [&](const uint32_t from, const uint32_t to) {
+    for (auto i = adjacency.offsets[from]; i < adjacency.offsets[from + 1];
+         i++) {
+      const auto* triangle = &welded[adjacency.triangles[i] * 3];
+      uint32_t corners[3];
+      for (int corner = 0; corner < 3; corner++) {
+        corners[corner] = positionRemap[triangle[corner]];
+      }
+      if (corners[0] == to || corners[1] == to || corners[2] == to) {
+        continue;
+      }
+      glm::vec3 before = glm::cross(
+          positions[corners[1]] - positions[corners[0]],
+          positions[corners[2]] - positions[corners[0]]);
+      for (auto& corner : corners) {
+        corner = corner == from ? to : corner;
+      }
+      glm::vec3 after = glm::cross(
+          positions[corners[1]] - positions[corners[0]],
+          positions[corners[2]] - positions[corners[0]]);
+      if (glm::dot(before, after) <=
+          0.25f * glm::length(before) * glm::length(after)) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Every pass collapses the cheapest edges that don't share a vertex, then
+  // rebuilds the triangles.
+  std::vector<uint32_t> wedgeRemap(vertices.size());
+  std::vector<uint8_t> touched(positionCount);
+  std::vector<Utils::Collapse> collapses;
+  double maxError = 0.0;
+  const size_t targetTriangles = targetIndexCount / 3;
+  while (result.size() / 3 > targetTriangles) {
+    Utils::BuildAdjacency(welded, positionCount, adjacency);
+    gatherEdges();
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    collapses.clear();
+    for (auto edge : edges) {
+      auto a = static_cast<uint32_t>(edge >> 32);
+      auto b = static_cast<uint32_t>(edge & 0xFFFFFFFF);
+      if (a == b || (locked[a] && locked[b])) {
+        continue;
+      }
+      double costA = locked[a] ? std::numeric_limits<double>::max()
+                               : collapseError(a, b);
+      double costB = locked[b] ? std::numeric_limits<double>::max()
+                               : collapseError(b, a);
+      collapses.push_back(costA <= costB ? Utils::Collapse{a, b, costA}
+                                         : Utils::Collapse{b, a, costB});
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Utils::Collapse& a, const Utils::Collapse& b) {
+                return a.cost < b.cost;
+              });
+
+    // an interior collapse removes two triangles
+    const size_t goal =
+        std::max<size_t>(1, (result.size() / 3 - targetTriangles) / 2);
+    size_t collapsed = 0;
+    std::fill(touched.begin(), touched.end(), 0);
+    for (uint32_t v = 0; v < vertices.size(); v++) {
+      wedgeRemap[v] = v;
+    }
+    for (const auto& collapse : collapses) {
+      if (collapsed >= goal) {
+        break;
+      }
+      if (touched[collapse.from] || touched[collapse.to] ||
+          flips(collapse.from, collapse.to)) {
+        continue;
+      }
+      touched[collapse.from] = touched[collapse.to] = 1;
+      positionRemap[collapse.from] = collapse.to;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      double weight = std::max(quadrics[collapse.to].weight, 1e-12);
+      maxError = std::max(maxError, collapse.cost / weight);
+      collapsed++;
+
+      for (auto w = wedgeOffsets[collapse.from];
+           w < wedgeOffsets[collapse.from + 1]; w++) {
+        const auto& vertex = vertices[wedges[w]];
+        float bestDistance = std::numeric_limits<float>::max();
+        for (auto t = wedgeOffsets[collapse.to];
+             t < wedgeOffsets[collapse.to + 1]; t++) {
+          const auto& target = vertices[wedges[t]];
+          glm::vec3 normalDelta = target.normal - vertex.normal;
+          glm::vec2 texCoordDelta = target.texCoord - vertex.texCoord;
+          float distance = glm::dot(normalDelta, normalDelta) +
+                           glm::dot(texCoordDelta, texCoordDelta);
+          if (distance < bestDistance) {
+            bestDistance = distance;
+            wedgeRemap[wedges[w]] = wedges[t];
+          }
+        }
+      }
+    }
+    if (collapsed == 0) {
+      break;
+    }
+
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      uint32_t corners[3], ids[3];
+      for (int corner = 0; corner < 3; corner++) {
+        corners[corner] = wedgeRemap[result[i + corner]];
+        ids[corner] = positionIds[corners[corner]];
+      }
+      if (ids[0] == ids[1] || ids[1] == ids[2] || ids[0] == ids[2]) {
+        continue;
+      }
+      for (int corner = 0; corner < 3; corner++) {
+        result[write + corner] = corners[corner];
+        welded[write + corner] = ids[corner];
+      }
+      write += 3;
+    }
+    result.resize(write);
+    welded.resize(write);
+  }
+
+  if (resultError) {
+    *resultError = static_cast<float>(std::sqrt(maxError));
+  }
+  return result;
+}
+
+void GenerateLods(MeshData& meshData, const uint32_t lodCount,
+                  const float reduction) {
+  spdlog::trace(__FUNCTION__);
+  assert(lodCount <= kMaxMeshLods && "too many LODs");
+  meshData.lods.clear();
+  meshData.lods.push_back(
+      {0, static_cast<uint32_t>(meshData.indices.size()), 0.0f});
+
+  std::vector<uint32_t> previous = meshData.indices;
+  float error = 0.0f;
+  for (uint32_t level = 1; level < lodCount; level++) {
+    size_t target = static_cast<size_t>(previous.size() / 3 * reduction) * 3;
+    if (target < 3) {
+      break;
+    }
+    float levelError = 0.0f;
+    auto lod = SimplifyMesh(meshData.vertices, previous, target, &levelError);
+    // stuck on borders or flips, more levels would look the same
+    if (lod.empty() || lod.size() > previous.size() * 0.9f) {
+      break;
+    }
+    OptimizeVertexCache(lod, meshData.vertices.size());
+    // each level simplifies the one before, so the errors add up
+    error += levelError;
+    meshData.lods.push_back({static_cast<uint32_t>(meshData.indices.size()),
+                             static_cast<uint32_t>(lod.size()), error});
+    meshData.indices.insert(meshData.indices.end(), lod.begin(), lod.end());
+    previous = std::move(lod);
+  }
+  spdlog::info("generated {} LODs", meshData.lods.size());
+}
+
+float AverageCacheMissRatio(const std::vector<uint32_t>& indices,
+                            const size_t vertexCount,
+                            const uint32_t cacheSize) {
+  if (indices.size() < 3) {
+    return 0.0f;
+  }
+  Utils::CacheSimulator cache(vertexCount, cacheSize);
+  size_t misses = 0;
+  for (auto index : indices) {
+    misses += cache.Access(index);
+  }
+  return float(misses) / float(indices.size() / 3);
+}
+
+std::vector<uint16_t> ConvertTo16BitIndices(
+    const std::vector<uint32_t>& indices) {
+  std::vector<uint16_t> result(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    assert(indices[i] <= 0xFFFF && "index doesn't fit in 16 bits");
+    result[i] = static_cast<uint16_t>(indices[i]);
+  }
+  return result;
+}
+
+}  // namespace Peridot
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <limits>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/MappedFile.h"
+#include "Peridot/MeshLoader.h"
+#include "Peridot/ThreadPool.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+// below this many bytes per chunk, splitting the file isn't worth it
+static constexpr size_t kMinObjChunkBytes = 1 << 20;
+
+enum ObjAttribute { Position, TexCoord, Normal };
+
+// One face corner. Indices are zero based; -1 means missing. A negative OBJ
+// index counts back from the vertices seen so far, which a chunk only knows
+// locally, so those are stored chunk relative and flagged until the chunk
+// bases are known.
+struct ObjCorner {
+  int32_t index[3] = {-1, -1, -1};
+  uint8_t relative = 0;
+};
+
+struct ObjChunk {
+  const char* begin = nullptr;
+  const char* end = nullptr;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> texCoords;
+  std::vector<glm::vec3> normals;
+  // three per triangle
+  std::vector<ObjCorner> corners;
+  size_t positionBase = 0;
+  size_t texCoordBase = 0;
+  size_t normalBase = 0;
+  bool failed = false;
+};
+
+static bool IsBlank(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static const char* SkipBlanks(const char* it, const char* end) {
+  while (it < end && IsBlank(*it)) {
+    it++;
+  }
+  return it;
+}
+
+static const char* SkipLine(const char* it, const char* end) {
+  while (it < end && *it != '\n') {
+    it++;
+  }
+  return it < end ? it + 1 : end;
+}
+
+template <int Count>
+static const char* ParseFloats(const char* it, const char* end,
+                               float* values) {
+  for (int i = 0; i < Count; i++) {
+    it = SkipBlanks(it, end);
+    // from_chars rejects a leading '+', OBJ exporters occasionally write one
+    if (it < end && *it == '+') {
+      it++;
+    }
+    auto result = std::from_chars(it, end, values[i]);
+    if (result.ec != std::errc()) {
+      return nullptr;
+    }
+    it = result.ptr;
+  }
+  return it;
+}
+
+static const char* ParseCorner(const char* it, const char* end,
+                               const size_t (&counts)[3], ObjCorner& corner) {
+  for (int attribute = 0; attribute < 3; attribute++) {
+    if (attribute > 0) {
+      if (it >= end || *it != '/') {
+        break;
+      }
+      it++;
+      // "v//vn" leaves the texcoord empty
+      if (it < end && *it == '/') {
+        continue;
+      }
+    }
+    int32_t value = 0;
+    auto result = std::from_chars(it, end, value);
+    if (result.ec != std::errc() || value == 0) {
+      return nullptr;
+    }
+    it = result.ptr;
+    if (value > 0) {
+      corner.index[attribute] = value - 1;
+    } else {
+      corner.index[attribute] =
+          static_cast<int32_t>(counts[attribute]) + value;
+      corner.relative |= 1 << attribute;
+    }
+  }
+  return it;
+}
+
+static void ParseObjChunk(ObjChunk& chunk) {
+  const char* it = chunk.begin;
+  const char* end = chunk.end;
+  std::vector<ObjCorner> polygon;
+  float values[3];
+
+  while (it < end) {
+    it = SkipBlanks(it, end);
+    if (it >= end) {
+      break;
+    }
+    const char* line = it;
+    if (it[0] == 'v' && it + 1 < end && IsBlank(it[1])) {
+      it = ParseFloats<3>(it + 1, end, values);
+      if (it) {
+        chunk.positions.emplace_back(values[0], values[1], values[2]);
+      }
+    } else if (it[0] == 'v' && it + 2 < end && it[1] == 't' &&
+               IsBlank(it[2])) {
+      it = ParseFloats<2>(it + 2, end, values);
+      if (it) {
+        chunk.texCoords.emplace_back(values[0], values[1]);
+      }
+    } else if (it[0] == 'v' && it + 2 < end && it[1] == 'n' &&
+               IsBlank(it[2])) {
+      it = ParseFloats<3>(it + 2, end, values);
+      if (it) {
+        chunk.normals.emplace_back(values[0], values[1], values[2]);
+      }
+    } else if (it[0] == 'f' && it + 1 < end && IsBlank(it[1])) {
+      const size_t counts[3] = {chunk.positions.size(), chunk.texCoords.size(),
+                                chunk.normals.size()};
+      polygon.clear();
+      it = SkipBlanks(it + 1, end);
+      while (it && it < end && *it != '\n' && *it != '#') {
+        ObjCorner corner;
+        it = ParseCorner(it, end, counts, corner);
+        if (it) {
+          polygon.push_back(corner);
+          it = SkipBlanks(it, end);
+        }
+      }
+      if (it && polygon.size() < 3) {
+        it = nullptr;
+      }
+      // fan triangulation, fine for the convex polygons exporters write
+      for (size_t i = 2; it && i < polygon.size(); i++) {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i - 1]);
+        chunk.corners.push_back(polygon[i]);
+      }
+    }
+
+    if (!it) {
+      auto lineEnd = std::find(line, end, '\n');
+      spdlog::error("malformed OBJ line: {}",
+                    std::string(line, std::min<size_t>(lineEnd - line, 80)));
+      chunk.failed = true;
+      return;
+    }
+    // everything else (o, g, s, usemtl, comments, ...) is skipped
+    it = SkipLine(it, end);
+  }
+}
+
+static uint64_t HashCorner(const ObjCorner& corner) {
+  uint64_t hash = static_cast<uint32_t>(corner.index[0]);
+  hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(corner.index[1]);
+  hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(corner.index[2]);
+  return hash ^ (hash >> 29);
+}
+
+static bool SameCorner(const ObjCorner& a, const ObjCorner& b) {
+  return a.index[0] == b.index[0] && a.index[1] == b.index[1] &&
+         a.index[2] == b.index[2];
+}
+
+}  // namespace Utils
+
+bool LoadObj(const char* filePath, MeshData& meshData) {
+  spdlog::trace(__FUNCTION__);
+  auto file = MappedFile::Open(filePath);
+  if (!file) {
+    return false;
+  }
+
+  // split at line boundaries so every chunk parses independently
+  const char* data = reinterpret_cast<const char*>(file->GetData());
+  const char* dataEnd = data + file->GetSize();
+  auto& pool = ThreadPool::Get();
+  size_t chunkCount = std::clamp<size_t>(
+      file->GetSize() / Utils::kMinObjChunkBytes, 1,
+      static_cast<size_t>(pool.GetWorkerCount() + 1) * 4);
+  std::vector<Utils::ObjChunk> chunks(chunkCount);
+  const char* cursor = data;
+  for (size_t i = 0; i < chunkCount; i++) {
+    chunks[i].begin = cursor;
+    if (i + 1 == chunkCount) {
+      cursor = dataEnd;
+    } else {
+      auto split = std::max(cursor, data + file->GetSize() * (i + 1) /
+                                               chunkCount);
+      cursor = std::find(split, dataEnd, '\n');
+      cursor = cursor < dataEnd ? cursor + 1 : dataEnd;
+    }
+    chunks[i].end = cursor;
+  }
+
+  pool.ParallelFor(chunkCount, 1, [&chunks](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      Utils::ParseObjChunk(chunks[i]);
+    }
+  });
+
+  size_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+  size_t cornerCount = 0;
+  for (auto& chunk : chunks) {
+    if (chunk.failed) {
+      return false;
+    }
+    chunk.positionBase = positionCount;
+    chunk.texCoordBase = texCoordCount;
+    chunk.normalBase = normalCount;
+    positionCount += chunk.positions.size();
+    texCoordCount += chunk.texCoords.size();
+    normalCount += chunk.normals.size();
+    cornerCount += chunk.corners.size();
+  }
+  if (cornerCount == 0) {
+    spdlog::error("{} has no faces", filePath);
+    return false;
+  }
+
+  // gather attributes and resolve relative indices now that bases are known
+  std::vector<glm::vec3> positions(positionCount);
+  std::vector<glm::vec2> texCoords(texCoordCount);
+  std::vector<glm::vec3> normals(normalCount);
+  std::vector<Utils::ObjCorner> corners(cornerCount);
+  std::vector<size_t> cornerBases(chunkCount, 0);
+  for (size_t i = 1; i < chunkCount; i++) {
+    cornerBases[i] = cornerBases[i - 1] + chunks[i - 1].corners.size();
+  }
+  const int64_t counts[3] = {static_cast<int64_t>(positionCount),
+                             static_cast<int64_t>(texCoordCount),
+                             static_cast<int64_t>(normalCount)};
+  std::atomic<bool> outOfRange{false};
+  pool.ParallelFor(chunkCount, 1, [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; c++) {
+      auto& chunk = chunks[c];
+      std::copy(chunk.positions.begin(), chunk.positions.end(),
+                positions.begin() + chunk.positionBase);
+      std::copy(chunk.texCoords.begin(), chunk.texCoords.end(),
+                texCoords.begin() + chunk.texCoordBase);
+      std::copy(chunk.normals.begin(), chunk.normals.end(),
+                normals.begin() + chunk.normalBase);
+      const size_t bases[3] = {chunk.positionBase, chunk.texCoordBase,
+                               chunk.normalBase};
+      auto* out = corners.data() + cornerBases[c];
+      for (auto corner : chunk.corners) {
+        for (int attribute = 0; attribute < 3; attribute++) {
+          int64_t index = corner.index[attribute];
+          if (corner.relative & (1 << attribute)) {
+            index += static_cast<int64_t>(bases[attribute]);
+          } else if (index < 0) {
+            continue;
+          }
+          if (index < 0 || index >= counts[attribute]) {
+            outOfRange = true;
+          }
+          corner.index[attribute] = static_cast<int32_t>(index);
+        }
+        corner.relative = 0;
+        *out++ = corner;
+      }
+      chunk = Utils::ObjChunk();
+    }
+  });
+  if (outOfRange) {
+    spdlog::error("{} references vertices that don't exist", filePath);
+    return false;
+  }
+  if (std::any_of(corners.begin(), corners.end(),
+                  [](const Utils::ObjCorner& corner) {
+                    return corner.index[Utils::Position] < 0;
+                  })) {
+    spdlog::error("{} has a face corner without a position", filePath);
+    return false;
+  }
+
+  // merge identical corners with an open addressing table of vertex ids
+  size_t tableSize = 1;
+  while (tableSize < cornerCount * 2) {
+    tableSize <<= 1;
+  }
+  constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> table(tableSize, kEmpty);
+  std::vector<Utils::ObjCorner> unique;
+  unique.reserve(cornerCount / 3);
+  meshData.indices.resize(cornerCount);
+  for (size_t i = 0; i < cornerCount; i++) {
+    const auto& corner = corners[i];
+    auto slot = Utils::HashCorner(corner) & (tableSize - 1);
+    while (table[slot] != kEmpty &&
+           !Utils::SameCorner(unique[table[slot]], corner)) {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    if (table[slot] == kEmpty) {
+      table[slot] = static_cast<uint32_t>(unique.size());
+      unique.push_back(corner);
+    }
+    meshData.indices[i] = table[slot];
+  }
+  table = std::vector<uint32_t>();
+  corners = std::vector<Utils::ObjCorner>();
+
+  meshData.vertices.resize(unique.size());
+  pool.ParallelFor(unique.size(), 16384, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const auto& corner = unique[i];
+      auto& vertex = meshData.vertices[i];
+      vertex.position = positions[corner.index[Utils::Position]];
+      if (corner.index[Utils::TexCoord] >= 0) {
+        vertex.texCoord = texCoords[corner.index[Utils::TexCoord]];
+      }
+      if (corner.index[Utils::Normal] >= 0) {
+        vertex.normal = normals[corner.index[Utils::Normal]];
+      }
+    }
+  });
+
+  meshData.GenerateMissingNormals();
+  meshData.ComputeBounds();
+  spdlog::info("loaded {}: {} vertices, {} triangles", filePath,
+               meshData.vertices.size(), meshData.indices.size() / 3);
+  return true;
+}
+
+}  // namespace Peridot
@@ -0,0 +1,166 @@
+#include <cassert>
+
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/Profiler.h"
+
+namespace Peridot {
+
+std::shared_ptr<Profiler> Profiler::Create() {
+  spdlog::trace(__FUNCTION__);
+  auto profiler = std::make_shared<Profiler>();
+  profiler->mEpoch = std::chrono::steady_clock::now();
+  for (auto& slot : profiler->mSlots) {
+    glGenQueries(static_cast<GLsizei>(slot.queries.size()),
+                 slot.queries.data());
+    slot.scopes.reserve(kMaxScopesPerFrame);
+  }
+  return profiler;
+}
+
+Profiler::~Profiler() {
+  spdlog::trace(__FUNCTION__);
+  for (auto& slot : mSlots) {
+    glDeleteQueries(static_cast<GLsizei>(slot.queries.size()),
+                    slot.queries.data());
+  }
+}
+
+double Profiler::Now() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       mEpoch)
+      .count();
+}
+
+void Profiler::BeginFrame() {
+  assert(!mInFrame && "BeginFrame called twice without EndFrame");
+
+  // resolve whatever the GPU has finished, oldest first
+  for (uint32_t i = 1; i <= kFramesInFlight; i++) {
+    auto& slot = mSlots[(mCurrentSlot + i) % kFramesInFlight];
+    if (slot.pending) {
+      TryResolve(slot);
+    }
+  }
+
+  auto& slot = mSlots[mCurrentSlot];
+  if (slot.pending) {
+    // the GPU is more than kFramesInFlight frames behind, drop the results
+    // instead of waiting on them
+    slot.pending = false;
+    mDroppedFrames += 1;
+  }
+
+  slot.scopes.clear();
+  slot.usedQueries = 0;
+  slot.lastQuery = 0;
+  slot.frameIndex = mFrameIndex;
+
+  // pair the GL clock with the CPU clock so both land on one timeline
+  GLint64 gpuNow = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  slot.gpuToCpuOffset = Now() - static_cast<double>(gpuNow) * 1e-9;
+
+  mInFrame = true;
+  BeginScope("Frame");
+}
+
+void Profiler::EndFrame() {
+  assert(mInFrame && "EndFrame called without BeginFrame");
+  while (!mScopeStack.empty()) {
+    EndScope();
+  }
+  mSlots[mCurrentSlot].pending = true;
+  mCurrentSlot = (mCurrentSlot + 1) % kFramesInFlight;
+  mFrameIndex += 1;
+  mInFrame = false;
+}
+
+void Profiler::BeginScope(const char* name) {
+  if (!mInFrame) {
+    return;
+  }
+  auto& slot = mSlots[mCurrentSlot];
+  Scope scope;
+  scope.name = name;
+  scope.depth = static_cast<uint32_t>(mScopeStack.size());
+  scope.cpuStart = Now();
+
+  if (slot.usedQueries < kMaxScopesPerFrame) {
+    scope.query = slot.usedQueries++;
+    slot.lastQuery = scope.query * 2;
+    glQueryCounter(slot.queries[slot.lastQuery], GL_TIMESTAMP);
+  }
+
+  mScopeStack.push_back(static_cast<uint32_t>(slot.scopes.size()));
+  slot.scopes.push_back(scope);
+}
+
+void Profiler::EndScope() {
+  if (!mInFrame || mScopeStack.empty()) {
+    return;
+  }
+  auto& slot = mSlots[mCurrentSlot];
+  auto& scope = slot.scopes[mScopeStack.back()];
+  mScopeStack.pop_back();
+
+  if (scope.query < kMaxScopesPerFrame) {
+    slot.lastQuery = scope.query * 2 + 1;
+    glQueryCounter(slot.queries[slot.lastQuery], GL_TIMESTAMP);
+  }
+  scope.cpuEnd = Now();
+}
+
+bool Profiler::TryResolve(FrameSlot& slot) {
+  // queries retire in the order they were issued, so once the last one is
+  // available the reads below don't wait on any of the others
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(slot.queries[slot.lastQuery], GL_QUERY_RESULT_AVAILABLE,
+                     &available);
+  if (available == GL_FALSE) {
+    return false;
+  }
+
+  mResolvedFrame.frameIndex = slot.frameIndex;
+  mResolvedFrame.events.clear();
+  mResolvedFrame.events.reserve(slot.scopes.size() * 2);
+
+  for (const auto& scope : slot.scopes) {
+    ProfileEvent cpuEvent;
+    cpuEvent.name = scope.name;
+    cpuEvent.source = ProfileEvent::Source::Cpu;
+    cpuEvent.depth = scope.depth;
+    cpuEvent.start = scope.cpuStart;
+    cpuEvent.end = scope.cpuEnd;
+    mResolvedFrame.events.push_back(cpuEvent);
+
+    if (scope.query >= kMaxScopesPerFrame) {
+      continue;
+    }
+
+    GLuint64 gpuStart = 0;
+    GLuint64 gpuEnd = 0;
+    glGetQueryObjectui64v(slot.queries[scope.query * 2], GL_QUERY_RESULT,
+                          &gpuStart);
+    glGetQueryObjectui64v(slot.queries[scope.query * 2 + 1], GL_QUERY_RESULT,
+                          &gpuEnd);
+
+    ProfileEvent gpuEvent;
+    gpuEvent.name = scope.name;
+    gpuEvent.source = ProfileEvent::Source::Gpu;
+    gpuEvent.depth = scope.depth;
+    gpuEvent.start = static_cast<double>(gpuStart) * 1e-9 + slot.gpuToCpuOffset;
+    gpuEvent.end = static_cast<double>(gpuEnd) * 1e-9 + slot.gpuToCpuOffset;
+    mResolvedFrame.events.push_back(gpuEvent);
+  }
+
+  // the root "Frame" scope is always first
+  mResolvedFrame.cpuTime = mResolvedFrame.events[0].Duration();
+  mResolvedFrame.gpuTime = mResolvedFrame.events[1].Duration();
+
+  slot.pending = false;
+  return true;
+}
+
+}  // namespace Peridot
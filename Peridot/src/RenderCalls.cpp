@@ -1,11 +1,32 @@
+#include <cassert>
 #include <cstdint>
 
 #include <glad/glad.h>
 
 #include "Peridot/RenderCalls.h"
+#include "Peridot/RenderStats.h"
 
 namespace Peridot {
 
+namespace Utils {
+
+static GLenum GLIndexType(const IndexType indexType) {
+  switch (indexType) {
+    case IndexType::UInt8:
+      return GL_UNSIGNED_BYTE;
+    case IndexType::UInt16:
+      return GL_UNSIGNED_SHORT;
+    case IndexType::UInt32:
+      return GL_UNSIGNED_INT;
+    default:
+      assert(false && "Invalid index type");
+      return GL_NONE;
+  }
+  return GL_NONE;
+}
+
+}  // namespace Utils
+
 void RenderCall::SetClearColor(const float r, const float g, const float b,
                                const float a) {
   glClearColor(r, g, b, a);
@@ -15,8 +36,111 @@ void RenderCall::ClearColorAndDepth() {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
+void RenderCall::SetViewport(const uint32_t width, const uint32_t height) {
+  glViewport(0, 0, width, height);
+}
+
 void RenderCall::DrawElements(const size_t count) {
   glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr);
+  RenderStats::RecordDrawCall(count / 3);
+}
+
+void RenderCall::DrawElements(const size_t count, const size_t firstIndex,
+                              const Utils::IndexType indexType) {
+  glDrawElements(GL_TRIANGLES, count, Utils::GLIndexType(indexType),
+                 reinterpret_cast<const void*>(
+                     firstIndex * Utils::IndexSizeInBytes(indexType)));
+  RenderStats::RecordDrawCall(count / 3);
+}
+
+void RenderCall::DrawElementsBaseVertex(const size_t count,
+                                        const size_t firstIndex,
+                                        const int32_t baseVertex,
+                                        const Utils::IndexType indexType) {
+  glDrawElementsBaseVertex(
+      GL_TRIANGLES, static_cast<GLsizei>(count), Utils::GLIndexType(indexType),
+      reinterpret_cast<const void*>(firstIndex *
+                                    Utils::IndexSizeInBytes(indexType)),
+      baseVertex);
+  RenderStats::RecordDrawCall(count / 3);
+}
+
+void RenderCall::DrawArrays(const size_t count, const size_t instanceCount) {
+  glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(count),
+                        static_cast<GLsizei>(instanceCount));
+  RenderStats::RecordDrawCall(count / 3 * instanceCount);
+}
+
+void RenderCall::MultiDrawElementsIndirect(const size_t drawCount,
+                                           const Utils::IndexType indexType) {
+  glMultiDrawElementsIndirect(GL_TRIANGLES, Utils::GLIndexType(indexType),
+                              nullptr, static_cast<GLsizei>(drawCount),
+                              sizeof(DrawElementsIndirectCommand));
+  // triangle counts live on the GPU, only the submission is counted
+  RenderStats::RecordDrawCall(0);
+}
+
+bool RenderCall::SupportsIndirectCount() {
+#if defined(GL_VERSION_4_6)
+  if (GLAD_GL_VERSION_4_6) {
+    return true;
+  }
+#endif
+#if defined(GL_ARB_indirect_parameters)
+  if (GLAD_GL_ARB_indirect_parameters) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+bool RenderCall::SupportsDrawParameters() {
+#if defined(GL_VERSION_4_6)
+  if (GLAD_GL_VERSION_4_6) {
+    return true;
+  }
+#endif
+#if defined(GL_ARB_shader_draw_parameters)
+  if (GLAD_GL_ARB_shader_draw_parameters) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+void RenderCall::MultiDrawElementsIndirectCount(
+    const size_t maxDrawCount, const Utils::IndexType indexType) {
+#if defined(GL_VERSION_4_6)
+  if (GLAD_GL_VERSION_4_6) {
+    glMultiDrawElementsIndirectCount(
+        GL_TRIANGLES, Utils::GLIndexType(indexType), nullptr, 0,
+        static_cast<GLsizei>(maxDrawCount),
+        sizeof(DrawElementsIndirectCommand));
+    RenderStats::RecordDrawCall(0);
+    return;
+  }
+#endif
+#if defined(GL_ARB_indirect_parameters)
+  if (GLAD_GL_ARB_indirect_parameters) {
+    glMultiDrawElementsIndirectCountARB(
+        GL_TRIANGLES, Utils::GLIndexType(indexType), nullptr, 0,
+        static_cast<GLsizei>(maxDrawCount),
+        sizeof(DrawElementsIndirectCommand));
+    RenderStats::RecordDrawCall(0);
+    return;
+  }
+#endif
+  assert(false && "indirect count draws not supported");
+}
+
+void RenderCall::DispatchCompute(const uint32_t groupsX,
+                                 const uint32_t groupsY,
+                                 const uint32_t groupsZ) {
+  glDispatchCompute(groupsX, groupsY, groupsZ);
+}
+
+void RenderCall::ShaderStorageBarrier() {
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
 }
 
 }  // namespace Peridot
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Peridot/RenderStats.h"
+
+namespace Peridot {
+
+namespace {
+
+struct StatsState {
+  FrameStats current;
+  FrameStats last;
+  std::array<FrameStats, RenderStats::kHistorySize> history;
+  size_t historyHead = 0;
+  size_t historyCount = 0;
+  uint32_t boundProgram = 0;
+  uint32_t boundVertexArray = 0;
+  uint32_t boundVertexBuffer = 0;
+};
+
+StatsState& State() {
+  static StatsState state;
+  return state;
+}
+
+int64_t& LiveCounter(FrameStats& stats, const RenderStats::Object object) {
+  switch (object) {
+    case RenderStats::Object::Buffer:
+      return stats.liveBuffers;
+    case RenderStats::Object::VertexArray:
+      return stats.liveVertexArrays;
+    case RenderStats::Object::Shader:
+    default:
+      return stats.liveShaders;
+  }
+}
+
+}  // namespace
+
+void RenderStats::RecordDrawCall(const uint64_t triangles) {
+  auto& current = State().current;
+  current.drawCalls += 1;
+  current.triangles += triangles;
+}
+
+void RenderStats::RecordShaderBind(const uint32_t programId) {
+  auto& state = State();
+  state.current.shaderBinds += 1;
+  if (state.boundProgram != programId) {
+    state.boundProgram = programId;
+    state.current.stateChanges += 1;
+  }
+}
+
+void RenderStats::RecordVertexArrayBind(const uint32_t vertexArrayId) {
+  auto& state = State();
+  state.current.vertexArrayBinds += 1;
+  if (state.boundVertexArray != vertexArrayId) {
+    state.boundVertexArray = vertexArrayId;
+    state.current.stateChanges += 1;
+  }
+}
+
+void RenderStats::RecordVertexBufferBind(const uint32_t bufferId) {
+  auto& state = State();
+  state.current.vertexBufferBinds += 1;
+  if (state.boundVertexBuffer != bufferId) {
+    state.boundVertexBuffer = bufferId;
+    state.current.stateChanges += 1;
+  }
+}
+
+void RenderStats::RecordBufferUpload(const size_t sizeInBytes) {
+  State().current.bufferBytesUploaded += sizeInBytes;
+}
+
+void RenderStats::RecordObjectCreated(const Object object) {
+  LiveCounter(State().current, object) += 1;
+}
+
+void RenderStats::RecordObjectDestroyed(const Object object) {
+  LiveCounter(State().current, object) -= 1;
+}
+
+void RenderStats::EndFrame(const double frameTime) {
+  auto& state = State();
+  state.current.frameTime = frameTime;
+  state.last = state.current;
+
+  state.history[state.historyHead] = state.current;
+  state.historyHead = (state.historyHead + 1) % kHistorySize;
+  state.historyCount = std::min(state.historyCount + 1, kHistorySize);
+
+  FrameStats next;
+  next.frameIndex = state.current.frameIndex + 1;
+  next.liveBuffers = state.current.liveBuffers;
+  next.liveVertexArrays = state.current.liveVertexArrays;
+  next.liveShaders = state.current.liveShaders;
+  state.current = next;
+}
+
+const FrameStats& RenderStats::GetCurrentFrame() { return State().current; }
+
+const FrameStats& RenderStats::GetLastFrame() { return State().last; }
+
+std::vector<FrameStats> RenderStats::GetHistory() {
+  const auto& state = State();
+  std::vector<FrameStats> history;
+  history.reserve(state.historyCount);
+  size_t first = (state.historyHead + kHistorySize - state.historyCount) %
+                 kHistorySize;
+  for (size_t i = 0; i < state.historyCount; i++) {
+    history.push_back(state.history[(first + i) % kHistorySize]);
+  }
+  return history;
+}
+
+FrameTimeSummary RenderStats::SummarizeFrameTimes() {
+  const auto& state = State();
+  FrameTimeSummary summary;
+  if (state.historyCount == 0) {
+    return summary;
+  }
+
+  std::array<double, kHistorySize> frameTimes;
+  double total = 0.0;
+  for (size_t i = 0; i < state.historyCount; i++) {
+    frameTimes[i] = state.history[i].frameTime;
+    total += frameTimes[i];
+  }
+
+  auto begin = frameTimes.begin();
+  auto end = begin + state.historyCount;
+  auto [minIt, maxIt] = std::minmax_element(begin, end);
+  summary.samples = state.historyCount;
+  summary.min = *minIt;
+  summary.max = *maxIt;
+  summary.avg = total / static_cast<double>(state.historyCount);
+
+  auto rank = static_cast<size_t>(
+      std::ceil(0.99 * static_cast<double>(state.historyCount))) - 1;
+  std::nth_element(begin, begin + rank, end);
+  summary.p99 = frameTimes[rank];
+  return summary;
+}
+
+void RenderStats::ForEachMetric(
+    const std::function<void(const char* name, double value)>& callback) {
+  const auto& last = GetLastFrame();
+  callback("frame_index", static_cast<double>(last.frameIndex));
+  callback("frame_time_seconds", last.frameTime);
+  callback("draw_calls", last.drawCalls);
+  callback("triangles", static_cast<double>(last.triangles));
+  callback("shader_binds", last.shaderBinds);
+  callback("vertex_array_binds", last.vertexArrayBinds);
+  callback("vertex_buffer_binds", last.vertexBufferBinds);
+  callback("state_changes", last.stateChanges);
+  callback("buffer_bytes_uploaded",
+           static_cast<double>(last.bufferBytesUploaded));
+  callback("live_buffers", static_cast<double>(last.liveBuffers));
+  callback("live_vertex_arrays", static_cast<double>(last.liveVertexArrays));
+  callback("live_shaders", static_cast<double>(last.liveShaders));
+
+  auto summary = SummarizeFrameTimes();
+  callback("frame_time_min_seconds", summary.min);
+  callback("frame_time_avg_seconds", summary.avg);
+  callback("frame_time_p99_seconds", summary.p99);
+  callback("frame_time_max_seconds", summary.max);
+}
+
+}  // namespace Peridot
@@ -1,10 +1,45 @@
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <tuple>
 
 #include <spdlog/spdlog.h>
 
+#include "Peridot/FrameAllocator.h"
+#include "Peridot/Frustum.h"
 #include "Peridot/Renderer.h"
+#include "Peridot/Resources.h"
 
 namespace Peridot {
 
+namespace Utils {
+
+// LOD errors are in object space, the largest axis scale covers any non
+// uniform scaling
+static float GetMaxScale(const glm::mat4& model) {
+  return glm::sqrt(
+      std::max({glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                glm::dot(glm::vec3(model[2]), glm::vec3(model[2]))}));
+}
+
+// Chunks are culled with the batch kernels: world bounds go into these
+// per thread arrays, which keep their capacity from frame to frame.
+struct ChunkCullScratch {
+  AABBSoA bounds;
+  std::vector<uint32_t> visible;
+};
+
+static ChunkCullScratch& GetChunkCullScratch() {
+  static thread_local ChunkCullScratch scratch;
+  scratch.bounds.Clear();
+  scratch.visible.clear();
+  return scratch;
+}
+
+
+}  // namespace Utils
+
 std::shared_ptr<Renderer> Renderer::Create(
     const std::shared_ptr<Context>& context) {
   spdlog::trace(__FUNCTION__);
@@ -21,4 +56,808 @@ std::shared_ptr<Renderer> Renderer::Create(
   return renderer;
 }
 
-}  // namespace Peridot
\ No newline at end of file
+Renderer::~Renderer() { spdlog::trace(__FUNCTION__); }
+
+void Renderer::RenderScene(World& world, const Camera& camera) {
+  ProfileScope scope(mCtx->GetProfiler().get(), "Renderer::RenderScene");
+
+  RenderShadows(world, camera, FindDirectionalLight(world));
+  CollectDrawItems(world, camera, false);
+  std::sort(mDrawItems.begin(), mDrawItems.end(),
+            [](const DrawItem& a, const DrawItem& b) {
+              return std::tie(a.shader, a.vertexArray, a.geometry) <
+                     std::tie(b.shader, b.vertexArray, b.geometry);
+            });
+  GatherPointLights(world, camera);
+  UpdateLightClusters(camera);
+  SubmitDrawItems(mDrawItems.data(), mDrawItems.data() + mDrawItems.size());
+}
+
+void Renderer::RenderSceneDeferred(World& world, const Camera& camera) {
+  ProfileScope scope(mCtx->GetProfiler().get(),
+                     "Renderer::RenderSceneDeferred");
+
+  const auto width = static_cast<uint32_t>(mCtx->GetWidth());
+  const auto height = static_cast<uint32_t>(mCtx->GetHeight());
+  if (!mDeferred) {
+    mDeferred = DeferredPipeline::Create(width, height);
+    if (!mDeferred) {
+      return;
+    }
+  }
+  mDeferred->Resize(width, height);
+
+  const auto* light = FindDirectionalLight(world);
+  const bool shadows = RenderShadows(world, camera, light);
+  // without a component the light set on the pipeline stays
+  if (light) {
+    mDeferred->SetDirectionalLight(light->direction,
+                                   light->color * light->intensity);
+  }
+  mDeferred->SetShadows(shadows ? mShadows.get() : nullptr);
+
+  const bool gpuDriven = SyncGpuBatches(world);
+  CollectDrawItems(world, camera, true, gpuDriven);
+  auto firstTransparent = std::partition(
+      mDrawItems.begin(), mDrawItems.end(),
+      [](const DrawItem& item) { return !item.material->transparent; });
+  // every opaque item uses the geometry shader, only buffers can differ
+  std::sort(mDrawItems.begin(), firstTransparent,
+            [](const DrawItem& a, const DrawItem& b) {
+              return std::tie(a.vertexArray, a.geometry) <
+                     std::tie(b.vertexArray, b.geometry);
+            });
+  std::sort(firstTransparent, mDrawItems.end(),
+            [](const DrawItem& a, const DrawItem& b) {
+              return a.distance > b.distance;
+            });
+  const auto* opaque = mDrawItems.data();
+  const auto* transparent = opaque + (firstTransparent - mDrawItems.begin());
+  const auto* end = opaque + mDrawItems.size();
+
+  if (gpuDriven) {
+    CullGpuBatches(camera);
+  }
+  mDeferred->BeginGeometryPass();
+  SubmitDrawItems(opaque, transparent, &mDeferred->GetGeometryShader());
+  if (gpuDriven) {
+    DrawGpuBatches(camera);
+  }
+  mDeferred->EndGeometryPass();
+  if (gpuDriven && mOcclusionCulling) {
+    BuildDepthPyramid(camera);
+  }
+
+  GatherPointLights(world, camera);
+  mDeferred->LightingPass(camera, mLights.data(), mLights.size());
+
+  if (transparent != end) {
+    UpdateLightClusters(camera);
+    mDeferred->BeginForwardPass();
+    SubmitDrawItems(transparent, end);
+    mDeferred->EndForwardPass();
+  }
+}
+
+const DirectionalLightComponent* Renderer::FindDirectionalLight(
+    World& world) {
+  const DirectionalLightComponent* found = nullptr;
+  world.Each<const DirectionalLightComponent>(
+      [&](Entity, const DirectionalLightComponent& light) {
+        if (!found) {
+          found = &light;
+        }
+      });
+  return found;
+}
+
+bool Renderer::RenderShadows(World& world, const Camera& camera,
+                             const DirectionalLightComponent* light) {
+  if (!light || !light->castsShadows) {
+    return false;
+  }
+  ProfileScope scope(mCtx->GetProfiler().get(), "Renderer::RenderShadows");
+
+  if (!mShadows && !mShadowsFailed) {
+    mShadows = ShadowCascades::Create(kShadowResolution);
+    mShadowsFailed = !mShadows;
+  }
+  if (!mShadows) {
+    return false;
+  }
+  if (UpdateStaticCasters(world)) {
+    mShadows->InvalidateCache();
+  }
+  mShadows->Update(camera, light->direction);
+
+  constexpr auto kCascadeCount = ShadowCascades::kCascadeCount;
+  std::array<Frustum, kCascadeCount> frustums;
+  for (uint32_t c = 0; c < kCascadeCount; c++) {
+    frustums[c] = Frustum::FromMatrix(mShadows->GetViewProjection(c));
+    mShadowItems[c].clear();
+    mStaticShadowItems[c].clear();
+  }
+
+  const auto& resources = ResourceManager::Get();
+  std::mutex shadowItemsMutex;
+  world.ParallelEachChunk<const TransformComponent, const MeshComponent,
+                          const ShadowCasterComponent>(
+      [&](const Entity*, size_t count, const TransformComponent* transforms,
+          const MeshComponent* meshes, const ShadowCasterComponent* casters) {
+        struct Caster {
+          uint32_t index;
+          const VertexArray* vertexArray;
+          const Mesh* source;
+        };
+        ArenaScope scratch;
+        FrameVector<Caster> candidates;
+        candidates.reserve(count);
+        auto& cull = Utils::GetChunkCullScratch();
+        for (size_t i = 0; i < count; i++) {
+          const auto& mesh = meshes[i];
+          const auto* source = resources.GetMeshes().Get(mesh.mesh);
+          const VertexArray* vertexArray =
+              source ? source->GetVertexArray().get()
+                     : resources.GetVertexArrays().Get(mesh.vertexArray);
+          if (!vertexArray) {
+            continue;
+          }
+          candidates.push_back(
+              {static_cast<uint32_t>(i), vertexArray, source});
+          cull.bounds.Add(mesh.bounds.Transformed(transforms[i].world));
+        }
+
+        std::array<FrameVector<DrawItem>, kCascadeCount> visible;
+        std::array<FrameVector<DrawItem>, kCascadeCount> visibleStatic;
+        for (uint32_t c = 0; c < kCascadeCount; c++) {
+          if (!mShadows->NeedsRender(c)) {
+            continue;
+          }
+          cull.visible.clear();
+          CullAABBs(frustums[c], cull.bounds, cull.visible);
+          for (const auto k : cull.visible) {
+            const auto& caster = candidates[k];
+            // cached cascades keep static casters in their static layer
+            const bool intoStatic =
+                mShadows->IsCached(c) && casters[caster.index].isStatic;
+            if (intoStatic && !mShadows->NeedsStaticRender(c)) {
+              continue;
+            }
+            const auto& model = transforms[caster.index].world;
+            DrawItem item = {nullptr, caster.vertexArray, nullptr, nullptr,
+                             model, mShadows->GetViewProjection(c) * model};
+            // orthographic, the texel density is the same at any distance
+            ResolveIndexRange(
+                meshes[caster.index], caster.source,
+                mShadows->GetTexelDensity(c) * Utils::GetMaxScale(model),
+                item);
+            (intoStatic ? visibleStatic[c] : visible[c]).push_back(item);
+          }
+        }
+
+        std::lock_guard<std::mutex> lock(shadowItemsMutex);
+        for (uint32_t c = 0; c < kCascadeCount; c++) {
+          mShadowItems[c].insert(mShadowItems[c].end(), visible[c].begin(),
+                                 visible[c].end());
+          mStaticShadowItems[c].insert(mStaticShadowItems[c].end(),
+                                       visibleStatic[c].begin(),
+                                       visibleStatic[c].end());
+        }
+      });
+
+  auto submit = [this](std::vector<DrawItem>& items) {
+    std::sort(items.begin(), items.end(),
+              [](const DrawItem& a, const DrawItem& b) {
+                return std::tie(a.vertexArray, a.geometry) <
+                       std::tie(b.vertexArray, b.geometry);
+              });
+    SubmitDrawItems(items.data(), items.data() + items.size(),
+                    &mShadows->GetDepthShader());
+  };
+  for (uint32_t c = 0; c < kCascadeCount; c++) {
+    if (!mShadows->NeedsRender(c)) {
+      continue;
+    }
+    if (mShadows->NeedsStaticRender(c)) {
+      mShadows->BeginStaticCascade(c);
+      submit(mStaticShadowItems[c]);
+    }
+    // cached cascades start from their static depth
+    mShadows->BeginCascade(c);
+    submit(mShadowItems[c]);
+  }
+  mShadows->EndRender();
+  RenderCall::SetViewport(static_cast<uint32_t>(mCtx->GetWidth()),
+                          static_cast<uint32_t>(mCtx->GetHeight()));
+  mShadows->Bind();
+  return true;
+}
+
+Entity Renderer::Pick(World& world, const Camera& camera, const double x,
+                      const double y) {
+  UpdatePickBvh(world);
+  const auto ray =
+      camera.ScreenPointToRay(x, y, static_cast<float>(mCtx->GetWidth()),
+                              static_cast<float>(mCtx->GetHeight()));
+  const auto hit = mPickBvh.Raycast(ray);
+  return hit.hit ? mPickEntities[hit.userData] : Entity{};
+}
+
+void Renderer::UpdatePickBvh(World& world) {
+  ArenaScope scratch;
+  FrameVector<Entity> entities;
+  mPickBounds.clear();
+  world.Each<const TransformComponent, const MeshComponent>(
+      [&](Entity entity, const TransformComponent& transform,
+          const MeshComponent& mesh) {
+        entities.push_back(entity);
+        mPickBounds.push_back(mesh.bounds.Transformed(transform.world));
+      });
+
+  // iteration order only changes with structural changes, the same
+  // entities in the same order means the tree's topology still fits
+  if (entities.size() == mPickEntities.size() &&
+      std::equal(entities.begin(), entities.end(), mPickEntities.begin())) {
+    for (size_t i = 0; i < mPickProxies.size(); i++) {
+      mPickBvh.SetBounds(mPickProxies[i], mPickBounds[i]);
+    }
+    mPickBvh.Refit();
+    return;
+  }
+
+  mPickEntities.assign(entities.begin(), entities.end());
+  std::vector<uint32_t> userData(mPickEntities.size());
+  for (size_t i = 0; i < userData.size(); i++) {
+    userData[i] = static_cast<uint32_t>(i);
+  }
+  mPickProxies = mPickBvh.Build(mPickBounds, userData);
+}
+
+bool Renderer::UpdateStaticCasters(World& world) {
+  // destroyed meshes stop resolving, taking their casters along
+  const auto meshVersion = ResourceManager::Get().GetMeshes().GetVersion();
+  bool changed = meshVersion != mShadowMeshVersion;
+  mShadowMeshVersion = meshVersion;
+
+  // removed entities leave no stamped chunk behind
+  const auto structureVersion =
+      world.GetStructureVersion<TransformComponent, MeshComponent,
+                                ShadowCasterComponent>();
+  if (structureVersion != mShadowStructureVersion) {
+    for (auto it = mStaticCasters.begin(); it != mStaticCasters.end();) {
+      const Entity entity = {it->first, it->second.generation};
+      if (world.Has<TransformComponent>(entity) &&
+          world.Has<MeshComponent>(entity) &&
+          world.Has<ShadowCasterComponent>(entity)) {
+        ++it;
+        continue;
+      }
+      it = mStaticCasters.erase(it);
+      changed = true;
+    }
+    mShadowStructureVersion = structureVersion;
+  }
+
+  // stamped chunks mostly hold casters that didn't change
+  world.EachChangedChunk<const TransformComponent, const MeshComponent,
+                         const ShadowCasterComponent>(
+      mShadowSyncTick,
+      [&](const Entity* entities, size_t count,
+          const TransformComponent* transforms, const MeshComponent* meshes,
+          const ShadowCasterComponent* casters) {
+        for (size_t i = 0; i < count; i++) {
+          const auto entity = entities[i];
+          auto found = mStaticCasters.find(entity.index);
+          if (!casters[i].isStatic) {
+            if (found != mStaticCasters.end()) {
+              mStaticCasters.erase(found);
+              changed = true;
+            }
+            continue;
+          }
+          const auto& mesh = meshes[i];
+          const StaticCaster caster = {entity.generation, mesh.mesh,
+                                       mesh.vertexArray, mesh.indexCount,
+                                       mesh.bounds, transforms[i].world};
+          if (found == mStaticCasters.end()) {
+            mStaticCasters.emplace(entity.index, caster);
+            changed = true;
+            continue;
+          }
+          auto& known = found->second;
+          if (known.generation != caster.generation ||
+              known.mesh != caster.mesh ||
+              known.vertexArray != caster.vertexArray ||
+              known.indexCount != caster.indexCount ||
+              known.bounds.min != caster.bounds.min ||
+              known.bounds.max != caster.bounds.max ||
+              known.model != caster.model) {
+            known = caster;
+            changed = true;
+          }
+        }
+      });
+  mShadowSyncTick = world.AdvanceChangeTick();
+  return changed;
+}
+
+void Renderer::GatherPointLights(World& world, const Camera& camera) {
+  const auto frustum = Frustum::FromMatrix(camera.GetViewProjectionMatrix());
+  mLights.clear();
+  world.Each<const TransformComponent, const PointLightComponent>(
+      [&](Entity, const TransformComponent& transform,
+          const PointLightComponent& light) {
+        auto position = glm::vec3(transform.world[3]);
+        if (light.radius <= 0.0f ||
+            !frustum.Intersects(BoundingSphere{position, light.radius})) {
+          return;
+        }
+        mLights.push_back({glm::vec4(position, light.radius),
+                           glm::vec4(light.color * light.intensity, 0.0f)});
+      });
+}
+
+void Renderer::UpdateLightClusters(const Camera& camera) {
+  if (!mClusters && !mClustersFailed) {
+    mClusters = LightClusters::Create();
+    mClustersFailed = !mClusters;
+  }
+  if (!mClusters) {
+    return;
+  }
+  mClusters->Update(camera, mLights.data(), mLights.size(),
+                    static_cast<uint32_t>(mCtx->GetWidth()),
+                    static_cast<uint32_t>(mCtx->GetHeight()));
+}
+
+void Renderer::CollectDrawItems(World& world, const Camera& camera,
+                                const bool deferred, const bool gpuDriven) {
+  const auto& viewProjection = camera.GetViewProjectionMatrix();
+  const auto frustum = Frustum::FromMatrix(viewProjection);
+  const auto cameraPosition = camera.GetPosition();
+  const auto viewportHeight = static_cast<float>(mCtx->GetHeight());
+
+  // the pools are only read while culling, resolving handles is safe from
+  // every worker
+  const auto& resources = ResourceManager::Get();
+
+  mDrawItems.clear();
+  std::mutex drawItemsMutex;
+  world.ParallelEachChunk<const TransformComponent, const MeshComponent,
+                          const MaterialComponent>(
+      [&](const Entity*, size_t count, const TransformComponent* transforms,
+          const MeshComponent* meshes, const MaterialComponent* materials) {
+        struct Candidate {
+          uint32_t index;
+          const Shader* shader;
+          const VertexArray* vertexArray;
+          const Mesh* source;
+        };
+        ArenaScope scratch;
+        FrameVector<Candidate> candidates;
+        candidates.reserve(count);
+        auto& cull = Utils::GetChunkCullScratch();
+        for (size_t i = 0; i < count; i++) {
+          const auto& mesh = meshes[i];
+          const auto& material = materials[i];
+          const auto* shader = resources.GetShaders().Get(material.shader);
+          const auto* source = resources.GetMeshes().Get(mesh.mesh);
+          const VertexArray* vertexArray =
+              source ? source->GetVertexArray().get()
+                     : resources.GetVertexArrays().Get(mesh.vertexArray);
+          const bool needsShader = !deferred || material.transparent;
+          if (!vertexArray || (!shader && needsShader) ||
+              (gpuDriven && source && !material.transparent)) {
+            continue;
+          }
+          candidates.push_back(
+              {static_cast<uint32_t>(i), shader, vertexArray, source});
+          cull.bounds.Add(mesh.bounds.Transformed(transforms[i].world));
+        }
+        CullAABBs(frustum, cull.bounds, cull.visible);
+
+        FrameVector<DrawItem> visible;
+        visible.reserve(cull.visible.size());
+        for (const auto k : cull.visible) {
+          const auto& candidate = candidates[k];
+          const auto& mesh = meshes[candidate.index];
+          const auto& model = transforms[candidate.index].world;
+          const glm::vec3 center(cull.bounds.centerX[k],
+                                 cull.bounds.centerY[k],
+                                 cull.bounds.centerZ[k]);
+          const auto toCenter = center - cameraPosition;
+
+          float pixelsPerUnit = 0.0f;
+          if (mesh.lodCount > 0) {
+            float radius = glm::length(glm::vec3(cull.bounds.extentX[k],
+                                                 cull.bounds.extentY[k],
+                                                 cull.bounds.extentZ[k]));
+            float distance = glm::length(toCenter) - radius;
+            pixelsPerUnit = camera.GetPixelsPerUnit(distance, viewportHeight) *
+                            Utils::GetMaxScale(model);
+          }
+          DrawItem item = {candidate.shader, candidate.vertexArray, nullptr,
+                           &materials[candidate.index], model,
+                           viewProjection * model,
+                           glm::dot(toCenter, toCenter)};
+          ResolveIndexRange(mesh, candidate.source, pixelsPerUnit, item);
+          visible.push_back(item);
+        }
+
+        std::lock_guard<std::mutex> lock(drawItemsMutex);
+        mDrawItems.insert(mDrawItems.end(), visible.begin(), visible.end());
+      });
+}
+
+bool Renderer::SyncGpuBatches(World& world) {
+  if (!mGpuCulling) {
+    // changes made meanwhile go unseen, start over when turned back on
+    mGpuBatches.clear();
+    mGpuSlots.clear();
+    mGpuSyncTick = 0;
+    return false;
+  }
+  if (!mDeferred->GetIndirectGeometryShader()) {
+    spdlog::warn("GPU culling needs shader draw parameters, turning it off");
+    mGpuCulling = false;
+    return false;
+  }
+  ProfileScope scope(mCtx->GetProfiler().get(), "Renderer::SyncGpuBatches");
+
+  // Destroyed meshes may have taken their pools along and repacking moves
+  // every allocation, neither leaves anything worth patching. The mesh
+  // version goes first, batch pools are only alive while it holds.
+  const auto meshVersion = ResourceManager::Get().GetMeshes().GetVersion();
+  bool rebuild = meshVersion != mGpuMeshVersion;
+  for (size_t i = 0; i < mGpuBatches.size() && !rebuild; i++) {
+    const auto& batch = mGpuBatches[i];
+    rebuild = batch.geometry->GetRepackCount() != batch.repackCount;
+  }
+  // the old batches keep the shared cull program alive until the new ones
+  // hold it
+  auto previous = std::move(mGpuBatches);
+  if (rebuild) {
+    mGpuSlots.clear();
+    mGpuSyncTick = 0;
+  } else {
+    mGpuBatches = std::move(previous);
+  }
+  mGpuMeshVersion = meshVersion;
+
+  // removed entities leave no stamped chunk behind
+  const auto structureVersion =
+      world.GetStructureVersion<TransformComponent, MeshComponent,
+                                MaterialComponent>();
+  if (structureVersion != mGpuStructureVersion && !rebuild) {
+    ArenaScope scratch;
+    FrameVector<Entity> removed;
+    for (const auto& batch : mGpuBatches) {
+      for (const auto entity : batch.entities) {
+        if (!world.Has<TransformComponent>(entity) ||
+            !world.Has<MeshComponent>(entity) ||
+            !world.Has<MaterialComponent>(entity)) {
+          removed.push_back(entity);
+        }
+      }
+    }
+    for (const auto entity : removed) {
+      RemoveGpuObject(entity);
+    }
+  }
+  mGpuStructureVersion = structureVersion;
+
+  bool created = true;
+  world.EachChangedChunk<const TransformComponent, const MeshComponent,
+                         const MaterialComponent>(
+      mGpuSyncTick,
+      [&](const Entity* entities, size_t count,
+          const TransformComponent* transforms, const MeshComponent* meshes,
+          const MaterialComponent* materials) {
+        for (size_t i = 0; i < count && created; i++) {
+          created = WriteGpuObject(entities[i], transforms[i], meshes[i],
+                                   materials[i]);
+        }
+      });
+  mGpuSyncTick = world.AdvanceChangeTick();
+  if (!created) {
+    mGpuCulling = false;
+    return false;
+  }
+
+  for (auto& batch : mGpuBatches) {
+    const auto count = static_cast<uint32_t>(batch.entities.size());
+    auto& culling = *batch.culling;
+    culling.Reserve(count);
+    const auto capacity = culling.GetMaxObjects() * sizeof(GpuGeometryObject);
+    if (batch.objectBuffer->GetSize() < capacity) {
+      auto grown = StorageBuffer::Create(nullptr, capacity);
+      grown->CopyData(*batch.objectBuffer, 0, 0,
+                      culling.GetObjectCount() * sizeof(GpuGeometryObject));
+      batch.objectBuffer = std::move(grown);
+    }
+    culling.SetObjectCount(count);
+
+    if (batch.uploadedLodTables < batch.lodTables.size()) {
+      culling.UpdateLodTables(
+          batch.uploadedLodTables,
+          static_cast<uint32_t>(batch.lodTables.size()) -
+              batch.uploadedLodTables,
+          batch.lodTables.data() + batch.uploadedLodTables);
+      batch.uploadedLodTables = static_cast<uint32_t>(batch.lodTables.size());
+    }
+
+    // runs of dirty slots, short gaps are cheaper to upload than to split
+    auto& dirty = batch.dirty;
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    dirty.erase(std::lower_bound(dirty.begin(), dirty.end(), count),
+                dirty.end());
+    for (size_t i = 0; i < dirty.size();) {
+      const auto first = dirty[i];
+      auto last = first;
+      for (i++; i < dirty.size() && dirty[i] - last <= 16; i++) {
+        last = dirty[i];
+      }
+      const auto runCount = last - first + 1;
+      culling.UpdateObjects(first, runCount, &batch.bounds[first],
+                            &batch.commands[first]);
+      batch.objectBuffer->SetData(&batch.objects[first],
+                                  runCount * sizeof(GpuGeometryObject),
+                                  first * sizeof(GpuGeometryObject));
+    }
+    dirty.clear();
+  }
+  return true;
+}
+
+bool Renderer::WriteGpuObject(const Entity entity,
+                              const TransformComponent& transform,
+                              const MeshComponent& mesh,
+                              const MaterialComponent& material) {
+  const auto* source = ResourceManager::Get().GetMeshes().Get(mesh.mesh);
+  auto* slot = FindGpuSlot(entity);
+  if (!source || material.transparent) {
+    if (slot) {
+      RemoveGpuObject(entity);
+    }
+    return true;
+  }
+
+  const auto* vertexArray = source->GetVertexArray().get();
+  const auto& allocation = *source->GetGeometry();
+  const auto* geometry = &allocation.GetPool();
+  auto found = std::find_if(mGpuBatches.begin(), mGpuBatches.end(),
+                            [&](const GpuBatch& candidate) {
+                              return candidate.vertexArray == vertexArray &&
+                                     candidate.geometry == geometry;
+                            });
+  if (found == mGpuBatches.end()) {
+    GpuBatch batch;
+    batch.vertexArray = vertexArray;
+    batch.geometry = geometry;
+    batch.repackCount = geometry->GetRepackCount();
+    batch.culling = GpuCulling::Create(256);
+    if (!batch.culling) {
+      return false;
+    }
+    batch.objectBuffer = StorageBuffer::Create(
+        nullptr, batch.culling->GetMaxObjects() * sizeof(GpuGeometryObject));
+    mGpuBatches.push_back(std::move(batch));
+    found = mGpuBatches.end() - 1;
+  }
+  const auto batchIndex = static_cast<uint32_t>(found - mGpuBatches.begin());
+  auto& batch = *found;
+
+  if (slot && slot->batch != batchIndex) {
+    RemoveGpuObject(entity);
+    slot = nullptr;
+  }
+  if (!slot) {
+    if (mGpuSlots.size() <= entity.index) {
+      mGpuSlots.resize(entity.index + 1);
+    }
+    slot = &mGpuSlots[entity.index];
+    *slot = {entity.generation, batchIndex,
+             static_cast<uint32_t>(batch.entities.size())};
+    batch.entities.push_back(entity);
+    batch.bounds.emplace_back();
+    batch.commands.emplace_back();
+    batch.objects.emplace_back();
+    batch.dirty.push_back(slot->slot);
+  }
+
+  const auto& range = allocation.GetRange();
+  auto lodTable = GpuObjectBounds::kNoLodTable;
+  const auto& lods = source->GetLods();
+  if (mesh.lodCount > 0 && !lods.empty()) {
+    auto [table, inserted] = batch.lodTableIndices.try_emplace(
+        mesh.mesh.index, static_cast<uint32_t>(batch.lodTables.size()));
+    if (inserted) {
+      GpuLodTable data;
+      data.lodCount =
+          static_cast<uint32_t>(std::min<size_t>(lods.size(), kMaxMeshLods));
+      for (uint32_t i = 0; i < data.lodCount; i++) {
+        data.lods[i] = {range.firstIndex + lods[i].firstIndex,
+                        lods[i].indexCount, lods[i].error};
+      }
+      batch.lodTables.push_back(data);
+    }
+    lodTable = table->second;
+  }
+
+  const auto& model = transform.world;
+  const auto worldBounds = mesh.bounds.Transformed(model);
+  const GpuObjectBounds bounds = {worldBounds.Center(),
+                                  Utils::GetMaxScale(model),
+                                  worldBounds.Extents(), lodTable};
+  const DrawElementsIndirectCommand command = {
+      mesh.indexCount, 1, range.firstIndex, range.baseVertex, slot->slot};
+  const GpuGeometryObject object = {model, material.albedo,
+                                    glm::vec4(material.roughness)};
+
+  // stamped chunks mostly hold rows that didn't change
+  const auto index = slot->slot;
+  if (std::memcmp(&batch.bounds[index], &bounds, sizeof(bounds)) != 0 ||
+      std::memcmp(&batch.commands[index], &command, sizeof(command)) != 0 ||
+      std::memcmp(&batch.objects[index], &object, sizeof(object)) != 0) {
+    batch.bounds[index] = bounds;
+    batch.commands[index] = command;
+    batch.objects[index] = object;
+    batch.dirty.push_back(index);
+  }
+  return true;
+}
+
+void Renderer::RemoveGpuObject(const Entity entity) {
+  auto* slot = FindGpuSlot(entity);
+  if (!slot) {
+    return;
+  }
+  auto& batch = mGpuBatches[slot->batch];
+  const auto index = slot->slot;
+  const auto last = static_cast<uint32_t>(batch.entities.size() - 1);
+  if (index != last) {
+    const auto moved = batch.entities[last];
+    batch.entities[index] = moved;
+    batch.bounds[index] = batch.bounds[last];
+    batch.commands[index] = batch.commands[last];
+    batch.commands[index].baseInstance = index;
+    batch.objects[index] = batch.objects[last];
+    mGpuSlots[moved.index].slot = index;
+    batch.dirty.push_back(index);
+  }
+  batch.entities.pop_back();
+  batch.bounds.pop_back();
+  batch.commands.pop_back();
+  batch.objects.pop_back();
+  slot->batch = GpuSlot::kNoBatch;
+}
+
+Renderer::GpuSlot* Renderer::FindGpuSlot(const Entity entity) {
+  if (entity.index >= mGpuSlots.size()) {
+    return nullptr;
+  }
+  auto& slot = mGpuSlots[entity.index];
+  if (slot.batch == GpuSlot::kNoBatch ||
+      slot.generation != entity.generation) {
+    return nullptr;
+  }
+  return &slot;
+}
+
+void Renderer::CullGpuBatches(const Camera& camera) {
+  ProfileScope scope(mCtx->GetProfiler().get(), "Renderer::CullGpuBatches");
+  const auto frustum = Frustum::FromMatrix(camera.GetViewProjectionMatrix());
+  const DepthPyramid* occlusion =
+      mOcclusionCulling ? mDepthPyramid.get() : nullptr;
+  const auto selection = GpuLodSelection::FromCamera(
+      camera, static_cast<float>(mCtx->GetHeight()), mLodThreshold);
+  for (auto& batch : mGpuBatches) {
+    if (batch.culling->GetObjectCount() > 0) {
+      batch.culling->SetLodSelection(selection);
+      batch.culling->Cull(frustum, occlusion);
+    }
+  }
+}
+
+void Renderer::DrawGpuBatches(const Camera& camera) const {
+  const auto* shader = mDeferred->GetIndirectGeometryShader();
+  shader->Bind();
+  shader->SetUniform<glm::mat4>("uViewProjection",
+                                camera.GetViewProjectionMatrix());
+  for (const auto& batch : mGpuBatches) {
+    if (batch.culling->GetObjectCount() == 0) {
+      continue;
+    }
+    batch.vertexArray->Bind();
+    batch.geometry->BindBuffers();
+    batch.objectBuffer->BindBase(BufferTarget::ShaderStorage, 0);
+    batch.culling->Draw(batch.geometry->GetIndexType());
+  }
+}
+
+void Renderer::BuildDepthPyramid(const Camera& camera) {
+  const auto& gBuffer = mDeferred->GetGBuffer();
+  if (!mDepthPyramid) {
+    mDepthPyramid =
+        DepthPyramid::Create(gBuffer.GetWidth(), gBuffer.GetHeight());
+    if (!mDepthPyramid) {
+      mOcclusionCulling = false;
+      return;
+    }
+  }
+  mDepthPyramid->Resize(gBuffer.GetWidth(), gBuffer.GetHeight());
+  mDepthPyramid->Build(gBuffer.GetDepthAttachment(),
+                       camera.GetViewProjectionMatrix());
+}
+
+void Renderer::ResolveIndexRange(const MeshComponent& mesh,
+                                 const Mesh* source,
+                                 const float pixelsPerUnit,
+                                 DrawItem& item) const {
+  item.firstIndex = 0;
+  item.indexCount = mesh.indexCount;
+  if (source && mesh.lodCount > 0) {
+    const auto& lods = source->GetLods();
+    const auto lodCount =
+        std::min(mesh.lodCount, static_cast<uint32_t>(lods.size()));
+    const auto& lod =
+        lods[SelectLod(lods.data(), lodCount, pixelsPerUnit, mLodThreshold)];
+    item.firstIndex = lod.firstIndex;
+    item.indexCount = lod.indexCount;
+  }
+  item.geometry = nullptr;
+  item.baseVertex = 0;
+  if (source) {
+    const auto& allocation = *source->GetGeometry();
+    item.geometry = &allocation.GetPool();
+    item.firstIndex += allocation.GetRange().firstIndex;
+    item.baseVertex = allocation.GetRange().baseVertex;
+  }
+}
+
+void Renderer::SubmitDrawItems(const DrawItem* begin, const DrawItem* end,
+                               const Shader* shader) const {
+  const Shader* boundShader = nullptr;
+  const VertexArray* boundVertexArray = nullptr;
+  const GeometryPool* boundGeometry = nullptr;
+  auto indexType = Utils::IndexType::UInt32;
+  for (const auto* item = begin; item != end; item++) {
+    const auto* itemShader = shader ? shader : item->shader;
+    if (itemShader != boundShader) {
+      itemShader->Bind();
+      boundShader = itemShader;
+    }
+    if (item->vertexArray != boundVertexArray) {
+      item->vertexArray->Bind();
+      boundVertexArray = item->vertexArray;
+      const auto& elementBuffer = item->vertexArray->GetElementBuffer();
+      indexType = elementBuffer ? elementBuffer->GetIndexType()
+                                : Utils::IndexType::UInt32;
+      boundGeometry = nullptr;
+    }
+    // meshes in the same pool share its buffers, only the offsets change
+    if (item->geometry && item->geometry != boundGeometry) {
+      item->geometry->BindBuffers();
+      boundGeometry = item->geometry;
+      indexType = item->geometry->GetIndexType();
+    }
+    itemShader->SetUniform<glm::mat4>("uMVP", item->mvp);
+    if (item->material) {
+      itemShader->SetUniform<glm::mat4>("uModel", item->model);
+      if (shader) {
+        shader->SetUniform<glm::mat4>(
+            "uNormalMatrix", glm::transpose(glm::inverse(item->model)));
+        shader->SetUniform<float>("uRoughness", item->material->roughness);
+      }
+      if (shader || item->material->transparent) {
+        itemShader->SetUniform<glm::vec4>("uAlbedo",
+                                          item->material->albedo);
+      }
+    }
+    RenderCall::DrawElementsBaseVertex(item->indexCount, item->firstIndex,
+                                       item->baseVertex, indexType);
+  }
+}
+
+}  // namespace Peridot
@@ -0,0 +1,86 @@
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/Mesh.h"
+#include "Peridot/Resources.h"
+#include "Peridot/Shader.h"
+#include "Peridot/VertexArray.h"
+
+namespace Peridot {
+
+DeletionQueue& DeletionQueue::Get() {
+  static DeletionQueue queue;
+  return queue;
+}
+
+void DeletionQueue::Defer(std::function<void()> destroy) {
+  mCurrent.push_back(std::move(destroy));
+}
+
+void DeletionQueue::EndFrame() {
+  if (!mCurrent.empty()) {
+    Frame frame;
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame.deletions = std::move(mCurrent);
+    mCurrent.clear();
+    mInFlight.push_back(std::move(frame));
+  }
+
+  // frames finish in order, stop at the first one still running
+  while (!mInFlight.empty()) {
+    auto& frame = mInFlight.front();
+    auto fence = static_cast<GLsync>(frame.fence);
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+      break;
+    }
+    glDeleteSync(fence);
+    for (auto& destroy : frame.deletions) {
+      destroy();
+    }
+    mInFlight.pop_front();
+  }
+}
+
+void DeletionQueue::Flush() {
+  spdlog::trace(__FUNCTION__);
+  if (!mInFlight.empty() || !mCurrent.empty()) {
+    glFinish();
+  }
+  for (auto& frame : mInFlight) {
+    glDeleteSync(static_cast<GLsync>(frame.fence));
+    for (auto& destroy : frame.deletions) {
+      destroy();
+    }
+  }
+  mInFlight.clear();
+  // destructions can defer more, run until nothing is left
+  while (!mCurrent.empty()) {
+    auto deletions = std::move(mCurrent);
+    mCurrent.clear();
+    for (auto& destroy : deletions) {
+      destroy();
+    }
+  }
+}
+
+size_t DeletionQueue::GetPendingCount() const {
+  size_t count = mCurrent.size();
+  for (const auto& frame : mInFlight) {
+    count += frame.deletions.size();
+  }
+  return count;
+}
+
+ResourceManager& ResourceManager::Get() {
+  static ResourceManager manager;
+  return manager;
+}
+
+void ResourceManager::Clear() {
+  mMeshes.Clear();
+  mVertexArrays.Clear();
+  mShaders.Clear();
+}
+
+}  // namespace Peridot
@@ -10,6 +10,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Peridot/RenderCalls.h"
+#include "Peridot/RenderStats.h"
 #include "Peridot/Shader.h"
 #include "Peridot/Utils.h"
 
@@ -23,6 +24,8 @@ static GLenum GLShaderType(const ShaderType shaderType) {
       return GL_VERTEX_SHADER;
     case ShaderType::FragmentShader:
       return GL_FRAGMENT_SHADER;
+    case ShaderType::ComputeShader:
+      return GL_COMPUTE_SHADER;
     default:
       throw std::runtime_error("Invalid shader");
   }
@@ -69,14 +72,24 @@ static bool LinkProgram(const uint32_t program) {
 std::shared_ptr<Shader> Shader::Create(
     const std::vector<ShaderSpecification>& shaderSpecs) {
   spdlog::trace(__FUNCTION__);
-  auto shaderObj = std::make_shared<Shader>();
+  std::vector<std::string> sources;
+  sources.reserve(shaderSpecs.size());
+  std::vector<ShaderSourceSpecification> sourceSpecs;
   for (const auto& shaderSpec : shaderSpecs) {
+    sources.push_back(Utils::ReadFileIntoStringBuffer(shaderSpec.filePath));
+    sourceSpecs.push_back({shaderSpec.shaderType, sources.back().c_str()});
+  }
+  return CreateFromSource(sourceSpecs);
+}
+
+std::shared_ptr<Shader> Shader::CreateFromSource(
+    const std::vector<ShaderSourceSpecification>& sourceSpecs) {
+  spdlog::trace(__FUNCTION__);
+  auto shaderObj = std::make_shared<Shader>();
+  for (const auto& shaderSpec : sourceSpecs) {
     uint32_t shader =
         glCreateShader(Utils::GLShaderType(shaderSpec.shaderType));
-    std::string shaderSource =
-        Utils::ReadFileIntoStringBuffer(shaderSpec.filePath);
-    auto shaderSourcePtr = shaderSource.c_str();
-    glShaderSource(shader, 1, &shaderSourcePtr, nullptr);
+    glShaderSource(shader, 1, &shaderSpec.source, nullptr);
 
     if (!Utils::CompileShader(shader)) {
       shaderObj->ShaderCleanup();
@@ -86,6 +99,7 @@ std::shared_ptr<Shader> Shader::Create(
   }
 
   shaderObj->mProgramId = glCreateProgram();
+  RenderStats::RecordObjectCreated(RenderStats::Object::Shader);
 
   for (auto&& [_, shaderId] : shaderObj->mShaderHandles) {
     glAttachShader(shaderObj->mProgramId, shaderId);
@@ -104,15 +118,61 @@ std::shared_ptr<Shader> Shader::Create(
   return shaderObj;
 }
 
-void Shader::Bind() const { glUseProgram(mProgramId); }
+void Shader::Bind() const {
+  glUseProgram(mProgramId);
+  RenderStats::RecordShaderBind(mProgramId);
+}
 
-void Shader::Unbind() const { glUseProgram(0); }
+void Shader::Unbind() const {
+  glUseProgram(0);
+  RenderStats::RecordShaderBind(0);
+}
+
+template <>
+void Shader::SetUniform<int32_t>(const char* name, const int32_t& value) const {
+  auto location = glGetUniformLocation(mProgramId, name);
+  glUniform1i(location, value);
+}
+
+template <>
+void Shader::SetUniform<uint32_t>(const char* name,
+                                  const uint32_t& value) const {
+  auto location = glGetUniformLocation(mProgramId, name);
+  glUniform1ui(location, value);
+}
+
+template <>
+void Shader::SetUniform<float>(const char* name, const float& value) const {
+  auto location = glGetUniformLocation(mProgramId, name);
+  glUniform1f(location, value);
+}
+
+template <>
+void Shader::SetUniform<glm::vec2>(const char* name,
+                                   const glm::vec2& vec) const {
+  auto location = glGetUniformLocation(mProgramId, name);
+  glUniform2fv(location, 1, glm::value_ptr(vec));
+}
+
+template <>
+void Shader::SetUniform<glm::ivec2>(const char* name,
+                                    const glm::ivec2& vec) const {
+  auto location = glGetUniformLocation(mProgramId, name);
+  glUniform2i(location, vec.x, vec.y);
+}
+
+template <>
+void Shader::SetUniform<glm::vec4>(const char* name,
+                                   const glm::vec4& vec) const {
+  auto location = glGetUniformLocation(mProgramId, name);
+  glUniform4fv(location, 1, glm::value_ptr(vec));
+}
 
 template <>
 void Shader::SetUniform<glm::vec3>(const char* name,
                                    const glm::vec3& vec) const {
   auto location = glGetUniformLocation(mProgramId, name);
-  glUniform3fv(location, vec.length(), glm::value_ptr(vec));
+  glUniform3fv(location, 1, glm::value_ptr(vec));
 }
 
 template <>
@@ -141,6 +201,9 @@ Shader::~Shader() {
     glDeleteShader(shaderId);
   }
 
+  if (mProgramId != 0) {
+    RenderStats::RecordObjectDestroyed(RenderStats::Object::Shader);
+  }
   glDeleteProgram(mProgramId);
 }
 
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cmath>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <spdlog/spdlog.h>
+
+#include "Peridot/ShadowCascades.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+// how much larger than their slice cached cascades are rendered, the
+// camera can move this fraction of the radius before they re-render
+static constexpr float kCacheMargin = 0.25f;
+
+// std140 layout of the ShadowCascadeParams block
+struct ShadowParams {
+  glm::mat4 matrices[ShadowCascades::kCascadeCount];
+  glm::mat4 cameraView = glm::mat4(1.0f);
+  glm::vec4 splits = glm::vec4(0.0f);
+  glm::vec4 texelSizes = glm::vec4(0.0f);
+  glm::vec4 lightDirection = glm::vec4(0.0f);
+};
+
+static constexpr const char* kShadowDepthVertexSource = R"(
+#version 450 core
+
+layout (location = 0) in vec3 aPosition;
+
+uniform mat4 uMVP;
+
+void main() {
+  gl_Position = uMVP * vec4(aPosition, 1.0);
+}
+)";
+
+static constexpr const char* kShadowDepthFragmentSource = R"(
+#version 450 core
+
+void main() {}
+)";
+
+static constexpr const char* kShadowSamplingSource = R"(
+layout (binding = 3) uniform sampler2DArrayShadow uShadowMap;
+
+layout (std140, binding = 1) uniform ShadowCascadeParams {
+  // world space to shadow map coordinates in [0, 1]
+  mat4 uShadowMatrices[4];
+  mat4 uShadowCameraView;
+  // view distance each cascade ends at
+  vec4 uShadowSplits;
+  // world units one texel covers in each cascade
+  vec4 uShadowTexelSizes;
+  // xyz direction the light travels in
+  vec4 uShadowLightDirection;
+};
+
+// 1 where the light reaches worldPosition, 0 in full shadow. The position
+// is pushed out along the normal by a texel and a half so surfaces don't
+// shadow themselves, 3x3 hardware PCF softens the edges.
+float GetShadow(vec3 worldPosition, vec3 normal) {
+  float distance = -(uShadowCameraView * vec4(worldPosition, 1.0)).z;
+  int cascade = 0;
+  while (cascade < 4 && distance > uShadowSplits[cascade]) {
+    cascade++;
+  }
+  if (cascade == 4) {
+    return 1.0;
+  }
+  vec3 offset = normal * uShadowTexelSizes[cascade] * 1.5;
+  vec3 coords =
+      (uShadowMatrices[cascade] * vec4(worldPosition + offset, 1.0)).xyz;
+  if (any(lessThan(coords, vec3(0.0))) || any(greaterThan(coords, vec3(1.0)))) {
+    return 1.0;
+  }
+  vec2 texel = 1.0 / vec2(textureSize(uShadowMap, 0).xy);
+  float lit = 0.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      lit += texture(uShadowMap, vec4(coords.xy + vec2(x, y) * texel,
+                                      float(cascade), coords.z));
+    }
+  }
+  return lit / 9.0;
+}
+)";
+
+// view space point distance in front of the camera on the ray through ndc
+static glm::vec3 GetPointAtDistance(const glm::mat4& inverseProjection,
+                                    const glm::vec2& ndc,
+                                    const float distance) {
+  glm::vec4 near = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+  glm::vec4 far = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+  glm::vec3 a = glm::vec3(near) / near.w;
+  glm::vec3 b = glm::vec3(far) / far.w;
+  return glm::mix(a, b, (-distance - a.z) / (b.z - a.z));
+}
+
+}  // namespace Utils
+
+std::shared_ptr<ShadowCascades> ShadowCascades::Create(
+    const uint32_t resolution) {
+  spdlog::trace(__FUNCTION__);
+  auto shadows = std::make_shared<ShadowCascades>();
+  shadows->mDepthShader = Shader::CreateFromSource(
+      {{ShaderType::VertexShader, Utils::kShadowDepthVertexSource},
+       {ShaderType::FragmentShader, Utils::kShadowDepthFragmentSource}});
+  if (!shadows->mDepthShader) {
+    spdlog::error("failed to build shadow depth shader");
+    return nullptr;
+  }
+
+  shadows->mResolution = std::max(1u, resolution);
+  glGenTextures(1, &shadows->mStaticTexture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, shadows->mStaticTexture);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F,
+                 shadows->mResolution, shadows->mResolution,
+                 kCascadeCount - 1);
+
+  glGenTextures(1, &shadows->mTexture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, shadows->mTexture);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F,
+                 shadows->mResolution, shadows->mResolution, kCascadeCount);
+  // linear filtering with compare mode gets 2x2 PCF from the hardware
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+  glGenFramebuffers(1, &shadows->mFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, shadows->mFramebuffer);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  // cascades that haven't rendered yet read as lit
+  for (uint32_t cascade = 0; cascade < kCascadeCount; cascade++) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              shadows->mTexture, 0, cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+  for (uint32_t layer = 0; layer < kCascadeCount - 1; layer++) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                              shadows->mStaticTexture, 0, layer);
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+  auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    spdlog::error("shadow framebuffer incomplete, status: 0x{:x}", status);
+    return nullptr;
+  }
+
+  shadows->mParamsBuffer =
+      StorageBuffer::Create(nullptr, sizeof(Utils::ShadowParams));
+  return shadows;
+}
+
+ShadowCascades::~ShadowCascades() {
+  spdlog::trace(__FUNCTION__);
+  glDeleteFramebuffers(1, &mFramebuffer);
+  glDeleteTextures(1, &mTexture);
+  glDeleteTextures(1, &mStaticTexture);
+}
+
+void ShadowCascades::SetCachedCascadeCount(const uint32_t count) {
+  mCachedCount = std::min(count, kCascadeCount - 1);
+  mCacheInvalid = true;
+  // static layers left from an earlier cached stint don't match anymore
+  for (auto& cascade : mCascades) {
+    cascade.hasStatic = false;
+  }
+}
+
+void ShadowCascades::Update(const Camera& camera,
+                            const glm::vec3& lightDirection) {
+  const auto direction = glm::normalize(lightDirection);
+  if (glm::dot(direction, mLightDirection) < 0.99999f) {
+    mLightDirection = direction;
+    // Only a rotation, cascades place themselves in light space. Keeping
+    // the origin fixed is what makes snapping to texels stable.
+    const auto up = std::abs(direction.y) > 0.99f
+                        ? glm::vec3(0.0f, 0.0f, 1.0f)
+                        : glm::vec3(0.0f, 1.0f, 0.0f);
+    mLightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+    mCacheInvalid = true;
+  }
+  if (mCacheInvalid) {
+    for (uint32_t cascade = 0; cascade < kCascadeCount; cascade++) {
+      mCascades[cascade].valid = false;
+    }
+    mCacheInvalid = false;
+  }
+  mCameraView = camera.GetViewMatrix();
+
+  const bool perspective = camera.GetProjection() == Camera::Perspective;
+  // perspective projections clamp the near plane the same way
+  const float nearPlane =
+      perspective ? std::max(0.1f, camera.GetNearClippingPlane())
+                  : camera.GetNearClippingPlane();
+  const float farPlane =
+      std::max(nearPlane + 1e-3f,
+               std::min(camera.GetFarClippingPlane(), mShadowDistance));
+  const auto& inverseProjection = camera.GetInverseProjectionMatrix();
+  const auto& cameraTransform = camera.GetTransform();
+
+  uint32_t cachedUpdates = 0;
+  float sliceNear = nearPlane;
+  for (uint32_t cascade = 0; cascade < kCascadeCount; cascade++) {
+    auto& current = mCascades[cascade];
+    // practical split scheme, logarithmic splits need a positive near plane
+    const float t = static_cast<float>(cascade + 1) / kCascadeCount;
+    float split = nearPlane + (farPlane - nearPlane) * t;
+    if (nearPlane > 0.0f) {
+      float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+      split = glm::mix(split, logSplit, mSplitBlend);
+    }
+    current.split = split;
+
+    // The slice is rigid in view space, so its bounding sphere keeps its
+    // radius however the camera moves or turns.
+    glm::vec3 corners[8];
+    glm::vec3 center(0.0f);
+    for (int corner = 0; corner < 8; corner++) {
+      glm::vec2 ndc((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f);
+      auto point = Utils::GetPointAtDistance(inverseProjection, ndc,
+                                             (corner & 4) ? split : sliceNear);
+      corners[corner] = glm::vec3(cameraTransform * glm::vec4(point, 1.0f));
+      center += corners[corner] / 8.0f;
+    }
+    float radius = 0.0f;
+    for (const auto& corner : corners) {
+      radius = std::max(radius, glm::length(corner - center));
+    }
+    // rounded so float noise doesn't change the texel size
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    sliceNear = split;
+
+    if (!IsCached(cascade)) {
+      current.center = center;
+      current.radius = radius;
+      current.viewProjection = BuildViewProjection(center, radius);
+      current.valid = true;
+      current.render = true;
+      current.renderStatic = false;
+      continue;
+    }
+
+    const float coverRadius =
+        std::ceil(radius * (1.0f + Utils::kCacheMargin) * 16.0f) / 16.0f;
+    const bool covered =
+        current.valid && current.radius == coverRadius &&
+        glm::length(center - current.center) + radius <= coverRadius;
+    current.renderStatic = false;
+    // dynamic casters are drawn over whatever static depth there is
+    current.render = current.hasStatic;
+    if (covered || cachedUpdates >= mCachedUpdatesPerFrame) {
+      // out of budget, stale cascades keep what they have until their turn
+      continue;
+    }
+    current.center = center;
+    current.radius = coverRadius;
+    current.viewProjection = BuildViewProjection(center, coverRadius);
+    current.valid = true;
+    current.render = true;
+    current.renderStatic = true;
+    current.hasStatic = true;
+    cachedUpdates += 1;
+  }
+
+  // maps clip space to texture coordinates and depth in [0, 1]
+  const auto bias =
+      glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)),
+                 glm::vec3(0.5f));
+  Utils::ShadowParams params;
+  for (uint32_t cascade = 0; cascade < kCascadeCount; cascade++) {
+    const auto& current = mCascades[cascade];
+    params.matrices[cascade] = bias * current.viewProjection;
+    params.splits[cascade] = current.split;
+    params.texelSizes[cascade] = 2.0f * current.radius / mResolution;
+  }
+  params.cameraView = mCameraView;
+  params.lightDirection = glm::vec4(mLightDirection, 0.0f);
+  mParamsBuffer->SetData(&params, sizeof(params));
+}
+
+glm::mat4 ShadowCascades::BuildViewProjection(const glm::vec3& center,
+                                              const float radius) const {
+  auto lightCenter = glm::vec3(mLightView * glm::vec4(center, 1.0f));
+  const float texel = 2.0f * radius / mResolution;
+  lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+  lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+  // casters between the light and the sphere throw shadows into it too,
+  // the near plane reaches back up to the shadow distance for them
+  const float nearDistance = -lightCenter.z - radius - mShadowDistance;
+  const float farDistance = -lightCenter.z + radius;
+  auto projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+                               lightCenter.y - radius, lightCenter.y + radius,
+                               nearDistance, farDistance);
+  return projection * mLightView;
+}
+
+void ShadowCascades::BeginCascade(const uint32_t cascade) const {
+  glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0,
+                            cascade);
+  glViewport(0, 0, mResolution, mResolution);
+  if (IsCached(cascade)) {
+    glCopyImageSubData(mStaticTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0,
+                       cascade - 1, mTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0,
+                       cascade, mResolution, mResolution, 1);
+  } else {
+    glClear(GL_DEPTH_BUFFER_BIT);
+  }
+  // slope scaled, on top of the normal offset the shaders apply
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(2.0f, 4.0f);
+  mDepthShader->Bind();
+}
+
+void ShadowCascades::BeginStaticCascade(const uint32_t cascade) const {
+  glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            mStaticTexture, 0, cascade - 1);
+  glViewport(0, 0, mResolution, mResolution);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  // slope scaled, on top of the normal offset the shaders apply
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(2.0f, 4.0f);
+  mDepthShader->Bind();
+}
+
+void ShadowCascades::EndRender() const {
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowCascades::Bind() const {
+  glActiveTexture(GL_TEXTURE3);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, mTexture);
+  mParamsBuffer->BindBase(BufferTarget::Uniform, 1);
+}
+
+const char* ShadowCascades::GetShaderSource() {
+  return Utils::kShadowSamplingSource;
+}
+
+}  // namespace Peridot
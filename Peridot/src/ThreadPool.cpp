@@ -0,0 +1,129 @@
+#include <algorithm>
+
+#include "Peridot/ThreadPool.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+// set on workers and on a caller while it runs batches, nested loops from
+// either run inline instead of submitting
+static thread_local bool tInsideJob = false;
+
+}  // namespace Utils
+
+ThreadPool& ThreadPool::Get() {
+  static ThreadPool pool(
+      std::max(1u, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+ThreadPool::ThreadPool(const uint32_t workerCount) {
+  mWorkers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; i++) {
+    mWorkers.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mWakeWorkers.notify_all();
+  for (auto& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::RunBatches(const std::function<void(size_t, size_t)>& fn,
+                            const size_t count, const size_t batchSize) {
+  while (true) {
+    size_t begin = mNextIndex.fetch_add(batchSize);
+    if (begin >= count) {
+      return;
+    }
+    size_t end = std::min(count, begin + batchSize);
+    fn(begin, end);
+    mPendingBatches.fetch_sub(1);
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  Utils::tInsideJob = true;
+  uint64_t seenGeneration = 0;
+  while (true) {
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t count = 0;
+    size_t batchSize = 1;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeWorkers.wait(lock, [&] {
+        return mStopping || mGeneration != seenGeneration;
+      });
+      if (mStopping) {
+        return;
+      }
+      seenGeneration = mGeneration;
+      // woke too late, the caller finished the loop on its own
+      if (!mJob) {
+        continue;
+      }
+      // copied under the lock: the caller can't publish another loop until
+      // this worker left, so mNextIndex stays this loop's counter
+      job = mJob;
+      count = mCount;
+      batchSize = mBatchSize;
+      mActiveWorkers += 1;
+    }
+
+    RunBatches(*job, count, batchSize);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mActiveWorkers -= 1;
+    }
+    mJobDone.notify_one();
+  }
+}
+
+void ThreadPool::ParallelFor(const size_t count, const size_t batchSize,
+                             const std::function<void(size_t, size_t)>& fn) {
+  if (count == 0) {
+    return;
+  }
+  const size_t batch = std::max<size_t>(1, batchSize);
+  if (mWorkers.empty() || Utils::tInsideJob || count <= batch) {
+    for (size_t begin = 0; begin < count; begin += batch) {
+      fn(begin, std::min(count, begin + batch));
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> submitLock(mSubmitMutex);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJob = &fn;
+    mCount = count;
+    mBatchSize = batch;
+    mNextIndex.store(0);
+    mPendingBatches.store((count + batch - 1) / batch);
+    mGeneration += 1;
+  }
+  mWakeWorkers.notify_all();
+
+  Utils::tInsideJob = true;
+  RunBatches(fn, count, batch);
+  Utils::tInsideJob = false;
+
+  // wait for stragglers, and for every worker to leave RunBatches before the
+  // job pointer goes out of scope; clearing it under the same lock turns
+  // away workers that only wake up now
+  std::unique_lock<std::mutex> lock(mMutex);
+  mJobDone.wait(lock, [&] {
+    return mPendingBatches.load() == 0 && mActiveWorkers == 0;
+  });
+  mJob = nullptr;
+}
+
+}  // namespace Peridot
@@ -1,21 +1,23 @@
-#include <GLFW/glfw3.h>
-
 #include "Peridot/TimeTracker.h"
 
 namespace Peridot {
 
 TimeTracker::TimeTracker()
-    : mCurrentTime(static_cast<float>(glfwGetTime())),
-      mPreviousTime(static_cast<float>(glfwGetTime())) {}
+    : mStartTime(Clock::now()),
+      mCurrentTime(mStartTime),
+      mPreviousTime(mStartTime) {}
 
 void TimeTracker::Update() {
-  mCurrentTime = static_cast<float>(glfwGetTime());
+  mPreviousTime = mCurrentTime;
+  mCurrentTime = Clock::now();
 }
 
-float TimeTracker::Delta() {
-  auto delta = mCurrentTime - mPreviousTime;
-  mPreviousTime = mCurrentTime;
-  return delta;
+double TimeTracker::Delta() const {
+  return std::chrono::duration<double>(mCurrentTime - mPreviousTime).count();
+}
+
+double TimeTracker::Elapsed() const {
+  return std::chrono::duration<double>(mCurrentTime - mStartTime).count();
 }
 
-}  // namespace Peridot
\ No newline at end of file
+}  // namespace Peridot
@@ -0,0 +1,332 @@
+#include <algorithm>
+
+#if defined(__AVX__)
+#define PERIDOT_TRANSFORM_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERIDOT_TRANSFORM_SSE 1
+#include <emmintrin.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "Peridot/ThreadPool.h"
+#include "Peridot/TransformHierarchy.h"
+
+namespace Peridot {
+
+namespace Utils {
+
+// levels smaller than this are updated on the calling thread
+static constexpr size_t kMinNodesPerTask = 2048;
+
+static glm::mat4 ComposeTransform(const glm::vec3& position,
+                                  const glm::vec3& rotation,
+                                  const glm::vec3& scale) {
+  const float cx = glm::cos(rotation.x), sx = glm::sin(rotation.x);
+  const float cy = glm::cos(rotation.y), sy = glm::sin(rotation.y);
+  const float cz = glm::cos(rotation.z), sz = glm::sin(rotation.z);
+  return glm::mat4(
+      glm::vec4(cz * cy, sz * cy, -sy, 0.0f) * scale.x,
+      glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx,
+                0.0f) *
+          scale.y,
+      glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx,
+                0.0f) *
+          scale.z,
+      glm::vec4(position, 1.0f));
+}
+
+// out = a * b for column major matrices, out must not alias a or b
+static void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b,
+                             glm::mat4& out) {
+  const float* pa = &a[0][0];
+  const float* pb = &b[0][0];
+  float* po = &out[0][0];
+#if defined(PERIDOT_TRANSFORM_AVX)
+  // two result columns per iteration, a's columns repeated in both lanes
+  const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa));
+  const __m256 a1 =
+      _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 4));
+  const __m256 a2 =
+      _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 8));
+  const __m256 a3 =
+      _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pa + 12));
+  for (int column = 0; column < 4; column += 2) {
+    const __m256 bc = _mm256_loadu_ps(pb + column * 4);
+    __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(bc, bc, 0x00));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(bc, bc, 0x55)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(bc, bc, 0xAA)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(bc, bc, 0xFF)));
+    _mm256_storeu_ps(po + column * 4, r);
+  }
+#elif defined(PERIDOT_TRANSFORM_SSE)
+  const __m128 a0 = _mm_loadu_ps(pa);
+  const __m128 a1 = _mm_loadu_ps(pa + 4);
+  const __m128 a2 = _mm_loadu_ps(pa + 8);
+  const __m128 a3 = _mm_loadu_ps(pa + 12);
+  for (int column = 0; column < 4; column++) {
+    const float* bc = pb + column * 4;
+    __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+    r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+    _mm_storeu_ps(po + column * 4, r);
+  }
+#else
+  out = a * b;
+#endif
+}
+
+// keeps the entries listed in order, in that order
+template <typename T>
+static void ApplyOrder(std::vector<T>& values,
+                       const std::vector<uint32_t>& order) {
+  std::vector<T> ordered;
+  ordered.reserve(order.size());
+  for (auto index : order) {
+    ordered.push_back(values[index]);
+  }
+  values.swap(ordered);
+}
+
+}  // namespace Utils
+
+uint32_t TransformHierarchy::Create(const uint32_t parent) {
+  uint32_t node;
+  if (!mFreeHandles.empty()) {
+    node = mFreeHandles.back();
+    mFreeHandles.pop_back();
+  } else {
+    node = static_cast<uint32_t>(mDenseIndex.size());
+    mDenseIndex.push_back(kNullNode);
+  }
+
+  mDenseIndex[node] = static_cast<uint32_t>(mHandles.size());
+  mHandles.push_back(node);
+  mParent.push_back(parent == kNullNode ? kNullNode : mDenseIndex[parent]);
+  mPosition.emplace_back(0.0f);
+  mRotation.emplace_back(0.0f);
+  mScale.emplace_back(1.0f);
+  mLocal.emplace_back(1.0f);
+  mWorld.emplace_back(1.0f);
+  mDirty.push_back(1);
+  mUpdated.push_back(0);
+  mNeedsSort = true;
+  return node;
+}
+
+void TransformHierarchy::Destroy(const uint32_t node) {
+  if (!IsValid(node)) {
+    return;
+  }
+  if (mNeedsSort) {
+    SortByDepth();
+  }
+
+  // parents come first, so one pass finds the whole subtree
+  const auto root = mDenseIndex[node];
+  std::vector<uint8_t> removed(mHandles.size(), 0);
+  removed[root] = 1;
+  for (size_t i = root + 1; i < mHandles.size(); i++) {
+    if (mParent[i] != kNullNode && removed[mParent[i]]) {
+      removed[i] = 1;
+    }
+  }
+
+  std::vector<uint32_t> order;
+  order.reserve(mHandles.size());
+  for (uint32_t i = 0; i < mHandles.size(); i++) {
+    if (removed[i]) {
+      mDenseIndex[mHandles[i]] = kNullNode;
+      mFreeHandles.push_back(mHandles[i]);
+    } else {
+      order.push_back(i);
+    }
+  }
+
+  std::vector<uint32_t> newIndex(mHandles.size(), kNullNode);
+  for (uint32_t i = 0; i < order.size(); i++) {
+    newIndex[order[i]] = i;
+  }
+  Utils::ApplyOrder(mHandles, order);
+  Utils::ApplyOrder(mParent, order);
+  Utils::ApplyOrder(mPosition, order);
+  Utils::ApplyOrder(mRotation, order);
+  Utils::ApplyOrder(mScale, order);
+  Utils::ApplyOrder(mLocal, order);
+  Utils::ApplyOrder(mWorld, order);
+  Utils::ApplyOrder(mDirty, order);
+  Utils::ApplyOrder(mUpdated, order);
+  for (uint32_t i = 0; i < mHandles.size(); i++) {
+    mDenseIndex[mHandles[i]] = i;
+    if (mParent[i] != kNullNode) {
+      mParent[i] = newIndex[mParent[i]];
+    }
+  }
+  // depth order is kept, only the level boundaries moved
+  mNeedsSort = true;
+}
+
+void TransformHierarchy::Clear() {
+  mDenseIndex.clear();
+  mHandles.clear();
+  mFreeHandles.clear();
+  mParent.clear();
+  mPosition.clear();
+  mRotation.clear();
+  mScale.clear();
+  mLocal.clear();
+  mWorld.clear();
+  mDirty.clear();
+  mUpdated.clear();
+  mLevelOffsets.clear();
+  mNeedsSort = false;
+}
+
+bool TransformHierarchy::SetParent(const uint32_t node, const uint32_t parent) {
+  const auto dense = mDenseIndex[node];
+  const auto parentDense =
+      parent == kNullNode ? kNullNode : mDenseIndex[parent];
+  for (auto ancestor = parentDense; ancestor != kNullNode;
+       ancestor = mParent[ancestor]) {
+    if (ancestor == dense) {
+      spdlog::error("transform node {} can't be parented to {}, a descendant",
+                    node, parent);
+      return false;
+    }
+  }
+
+  mParent[dense] = parentDense;
+  mDirty[dense] = 1;
+  mNeedsSort = true;
+  return true;
+}
+
+uint32_t TransformHierarchy::GetParent(const uint32_t node) const {
+  const auto parent = mParent[mDenseIndex[node]];
+  return parent == kNullNode ? kNullNode : mHandles[parent];
+}
+
+void TransformHierarchy::SetPosition(const uint32_t node,
+                                     const glm::vec3& position) {
+  mPosition[mDenseIndex[node]] = position;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetRotation(const uint32_t node,
+                                     const glm::vec3& rotation) {
+  mRotation[mDenseIndex[node]] = rotation;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SetScale(const uint32_t node,
+                                  const glm::vec3& scale) {
+  mScale[mDenseIndex[node]] = scale;
+  MarkDirty(node);
+}
+
+void TransformHierarchy::SortByDepth() {
+  const auto count = mHandles.size();
+  constexpr uint32_t kUnknown = kNullNode;
+
+  // depth of every node, walking up until a known depth or a root
+  std::vector<uint32_t> depth(count, kUnknown);
+  std::vector<uint32_t> chain;
+  uint32_t maxDepth = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    auto current = i;
+    while (current != kNullNode && depth[current] == kUnknown) {
+      chain.push_back(current);
+      current = mParent[current];
+    }
+    auto next = current == kNullNode ? 0 : depth[current] + 1;
+    while (!chain.empty()) {
+      depth[chain.back()] = next++;
+      chain.pop_back();
+    }
+    maxDepth = std::max(maxDepth, depth[i]);
+  }
+
+  // stable counting sort, keeps siblings in creation order
+  mLevelOffsets.assign(count == 0 ? 1 : maxDepth + 2, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    mLevelOffsets[depth[i] + 1] += 1;
+  }
+  for (size_t level = 1; level < mLevelOffsets.size(); level++) {
+    mLevelOffsets[level] += mLevelOffsets[level - 1];
+  }
+  std::vector<uint32_t> order(count);
+  std::vector<size_t> cursor(mLevelOffsets.begin(), mLevelOffsets.end() - 1);
+  for (uint32_t i = 0; i < count; i++) {
+    order[cursor[depth[i]]++] = i;
+  }
+
+  std::vector<uint32_t> newIndex(count);
+  for (uint32_t i = 0; i < count; i++) {
+    newIndex[order[i]] = i;
+  }
+  Utils::ApplyOrder(mHandles, order);
+  Utils::ApplyOrder(mParent, order);
+  Utils::ApplyOrder(mPosition, order);
+  Utils::ApplyOrder(mRotation, order);
+  Utils::ApplyOrder(mScale, order);
+  Utils::ApplyOrder(mLocal, order);
+  Utils::ApplyOrder(mWorld, order);
+  Utils::ApplyOrder(mDirty, order);
+  Utils::ApplyOrder(mUpdated, order);
+  for (uint32_t i = 0; i < count; i++) {
+    mDenseIndex[mHandles[i]] = i;
+    if (mParent[i] != kNullNode) {
+      mParent[i] = newIndex[mParent[i]];
+    }
+  }
+  mNeedsSort = false;
+}
+
+void TransformHierarchy::UpdateRange(const size_t begin, const size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    const auto parent = mParent[i];
+    const bool parentUpdated = parent != kNullNode && mUpdated[parent] != 0;
+    if (mDirty[i]) {
+      mLocal[i] =
+          Utils::ComposeTransform(mPosition[i], mRotation[i], mScale[i]);
+    }
+    if (mDirty[i] || parentUpdated) {
+      if (parent == kNullNode) {
+        mWorld[i] = mLocal[i];
+      } else {
+        Utils::MultiplyMatrices(mWorld[parent], mLocal[i], mWorld[i]);
+      }
+      mUpdated[i] = 1;
+    } else {
+      mUpdated[i] = 0;
+    }
+    mDirty[i] = 0;
+  }
+}
+
+void TransformHierarchy::Update() {
+  if (mNeedsSort) {
+    SortByDepth();
+  }
+
+  // a level only reads the level above it, so nodes within a level are
+  // independent
+  for (size_t level = 0; level + 1 < mLevelOffsets.size(); level++) {
+    const auto begin = mLevelOffsets[level];
+    const auto end = mLevelOffsets[level + 1];
+    if (end - begin < 2 * Utils::kMinNodesPerTask) {
+      UpdateRange(begin, end);
+      continue;
+    }
+    ThreadPool::Get().ParallelFor(
+        end - begin, Utils::kMinNodesPerTask,
+        [this, begin](size_t first, size_t last) {
+          UpdateRange(begin + first, begin + last);
+        });
+  }
+}
+
+}  // namespace Peridot
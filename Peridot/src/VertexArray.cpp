@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cassert>
 
 #include <glad/glad.h>
 #include <spdlog/spdlog.h>
 
+#include "Peridot/RenderStats.h"
 #include "Peridot/Utils.h"
 #include "Peridot/VertexArray.h"
 
@@ -29,6 +31,24 @@ inline static GLenum GLDataType(const Type elementType) {
     case Type::Mat4x3:
     case Type::Mat4x4:
       return GL_FLOAT;
+    case Type::Vec2h:
+    case Type::Vec3h:
+    case Type::Vec4h:
+      return GL_HALF_FLOAT;
+    case Type::Vec4b:
+      return GL_BYTE;
+    case Type::Vec4ub:
+      return GL_UNSIGNED_BYTE;
+    case Type::Vec2s:
+    case Type::Vec4s:
+      return GL_SHORT;
+    case Type::Vec2us:
+    case Type::Vec4us:
+      return GL_UNSIGNED_SHORT;
+    case Type::Packed1010102:
+      return GL_INT_2_10_10_10_REV;
+    case Type::PackedU1010102:
+      return GL_UNSIGNED_INT_2_10_10_10_REV;
     case Type::None:
     default:
       assert(false && "None or Invalid type not supported");
@@ -39,48 +59,96 @@ inline static GLenum GLDataType(const Type elementType) {
 }
 }  // namespace Utils
 
+std::shared_ptr<VertexArray> VertexArray::Create(const BufferLayout& format) {
+  auto vertexArray = Create();
+  vertexArray->SetFormat(0, format);
+  vertexArray->mBindingCount = 1;
+  vertexArray->mFormat = format;
+  return vertexArray;
+}
+
 std::shared_ptr<VertexArray> VertexArray::Create() {
   auto vertexArray = std::make_shared<VertexArray>();
   glGenVertexArrays(1, &vertexArray->mRendererId);
   glBindVertexArray(vertexArray->mRendererId);
+  RenderStats::RecordObjectCreated(RenderStats::Object::VertexArray);
+  RenderStats::RecordVertexArrayBind(vertexArray->mRendererId);
   spdlog::trace(__FUNCTION__ " creating handle: {}", vertexArray->mRendererId);
   return vertexArray;
 }
 
 VertexArray::~VertexArray() {
   spdlog::trace(__FUNCTION__ " destroying handle: {}", mRendererId);
+  if (mRendererId != 0) {
+    RenderStats::RecordObjectDestroyed(RenderStats::Object::VertexArray);
+  }
   glDeleteVertexArrays(1, &mRendererId);
 }
 
-void VertexArray::Bind() const { glBindVertexArray(mRendererId); }
+void VertexArray::Bind() const {
+  glBindVertexArray(mRendererId);
+  RenderStats::RecordVertexArrayBind(mRendererId);
+}
 
-void VertexArray::Unbind() const { glBindVertexArray(0); }
+void VertexArray::Unbind() const {
+  glBindVertexArray(0);
+  RenderStats::RecordVertexArrayBind(0);
+}
 
+// Uses the separate attribute format (GL 4.3): the format lives in the VAO
+// and each buffer gets its own binding point, so the buffer behind a
+// binding can be swapped later without redoing the attribute setup.
 void VertexArray::AddVertexBuffer(
     const std::shared_ptr<VertexBuffer>& vertexBuffer) {
+  if (!vertexBuffer || std::find(mVertexBuffers.begin(), mVertexBuffers.end(),
+                                 vertexBuffer) != mVertexBuffers.end()) {
+    return;
+  }
   Bind();
-  vertexBuffer->Bind();
-  uint32_t index = 0;
+  const uint32_t binding = mBindingCount++;
   const auto& bufferLayout = vertexBuffer->GetBufferLayout();
-  for (const auto& item : bufferLayout.layout) {
-    glVertexAttribPointer(index, (int32_t)Utils::TypeSize(item.elementType),
-                          Utils::GLDataType(item.elementType), GL_FALSE,
-                          bufferLayout.stride, (const void*)item.offset);
-    glEnableVertexAttribArray(index);
-    index += 1;
+  SetFormat(binding, bufferLayout);
+  glBindVertexBuffer(binding, vertexBuffer->GetRendererId(), 0,
+                     static_cast<int32_t>(bufferLayout.stride));
+  mVertexBuffers.resize(mBindingCount);
+  mVertexBuffers[binding] = vertexBuffer;
+}
+
+void VertexArray::SetFormat(const uint32_t binding,
+                            const BufferLayout& layout) {
+  for (const auto& item : layout.layout) {
+    glVertexAttribFormat(mAttributeCount,
+                         (int32_t)Utils::TypeSize(item.elementType),
+                         Utils::GLDataType(item.elementType),
+                         item.normalized ? GL_TRUE : GL_FALSE,
+                         static_cast<uint32_t>(item.offset));
+    glVertexAttribBinding(mAttributeCount, binding);
+    glEnableVertexAttribArray(mAttributeCount);
+    mAttributeCount += 1;
   }
-  mVertexBuffers.insert(vertexBuffer);
+}
+
+void VertexArray::BindBuffers(const StorageBuffer& vertexBuffer,
+                              const StorageBuffer& elementBuffer) const {
+  glBindVertexBuffer(0, vertexBuffer.GetRendererId(), 0,
+                     static_cast<int32_t>(mFormat.stride));
+  RenderStats::RecordVertexBufferBind(vertexBuffer.GetRendererId());
+  // the element buffer binding is vertex array state
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer.GetRendererId());
 }
 
 void VertexArray::RemoveVertexBuffer(
     const std::shared_ptr<VertexBuffer>& vertexBuffer) {
   Bind();
-  auto it = mVertexBuffers.find(vertexBuffer);
-  if (it == mVertexBuffers.end()) {
+  auto it = std::find(mVertexBuffers.begin(), mVertexBuffers.end(),
+                      vertexBuffer);
+  if (!vertexBuffer || it == mVertexBuffers.end()) {
     return;
   }
-  (*it)->Unbind();
-  mVertexBuffers.erase(it);
+  // the attributes stay set up, only the buffer is detached
+  glBindVertexBuffer(static_cast<uint32_t>(it - mVertexBuffers.begin()), 0, 0,
+                     0);
+  *it = nullptr;
 }
 
 void VertexArray::SetElementBuffer(
@@ -96,4 +164,33 @@ void VertexArray::UnsetElementBuffer() {
   mElementBuffer = nullptr;
 }
 
-}  // namespace Peridot
\ No newline at end of file
+VertexArrayCache& VertexArrayCache::Get() {
+  static VertexArrayCache cache;
+  return cache;
+}
+
+std::shared_ptr<VertexArray> VertexArrayCache::Acquire(
+    const BufferLayout& layout) {
+  auto& bucket = mVertexArrays[layout.Hash()];
+  for (const auto& vertexArray : bucket) {
+    if (vertexArray->GetFormat() == layout) {
+      return vertexArray;
+    }
+  }
+  bucket.push_back(VertexArray::Create(layout));
+  return bucket.back();
+}
+
+size_t VertexArrayCache::GetSize() const {
+  size_t size = 0;
+  for (const auto& [hash, bucket] : mVertexArrays) {
+    size += bucket.size();
+  }
+  return size;
+}
+
+void VertexArrayCache::Clear() {
+  mVertexArrays.clear();
+}
+
+}  // namespace Peridot
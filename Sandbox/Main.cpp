@@ -5,13 +5,21 @@
 
 #include <Peridot/OrthographicCamController.h>
 #include <Peridot/PerspectiveCamController.h>
+#include <Peridot/Components.h>
 #include <Peridot/Core.h>
+#include <Peridot/Ecs.h>
 #include <Peridot/Input.h>
+#include <Peridot/Renderer.h>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <spdlog/spdlog.h>
 
+// radians per second around the local y axis
+struct Spin {
+  float speed = 1.0f;
+};
+
 struct App {
   App() = default;
   ~App() { spdlog::trace(__FUNCTION__); }
@@ -36,7 +44,10 @@ struct App {
       return nullptr;
     }
 
-    app->shader = shader;
+    app->renderer = Peridot::Renderer::Create(ctx);
+    if (!app->renderer) {
+      return nullptr;
+    }
 
     auto vertexBuffer = Peridot::VertexBuffer::Create(
         app->vertices.data(), app->vertices.size() * sizeof(float));
@@ -48,12 +59,36 @@ struct App {
     auto elementBuffer = Peridot::ElementBuffer::Create(
         app->indices.data(), app->indices.size() * sizeof(uint32_t));
 
-    app->vertexArray = Peridot::VertexArray::Create();
+    auto vertexArray = Peridot::VertexArray::Create();
 
-    app->vertexArray->AddVertexBuffer(vertexBuffer);
-    app->vertexArray->SetElementBuffer(elementBuffer);
+    vertexArray->AddVertexBuffer(vertexBuffer);
+    vertexArray->SetElementBuffer(elementBuffer);
     Peridot::RenderCall::SetClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
+    // one cube at the origin and a block of them stretching away from the
+    // camera, parented to a spinning pivot in the middle of the block
+    auto& resources = Peridot::ResourceManager::Get();
+    Peridot::MeshComponent mesh{resources.GetVertexArrays().Add(vertexArray),
+                                static_cast<uint32_t>(app->indices.size()),
+                                {glm::vec3(-0.5f), glm::vec3(0.5f)}};
+    Peridot::MaterialComponent material{resources.GetShaders().Add(shader)};
+    app->world.Create(Peridot::TransformComponent{app->transforms.Create()},
+                      mesh, material);
+
+    auto pivot = app->transforms.Create();
+    app->transforms.SetPosition(pivot, {0.0f, 0.0f, -24.0f});
+    app->world.Create(Peridot::TransformComponent{pivot}, Spin{});
+    for (int x = -10; x <= 10; x += 2) {
+      for (int y = -10; y <= 10; y += 2) {
+        for (int z = -20; z <= 20; z += 2) {
+          auto node = app->transforms.Create(pivot);
+          app->transforms.SetPosition(node, glm::vec3(x, y, z));
+          app->transforms.SetScale(node, glm::vec3(0.5f));
+          app->world.Create(Peridot::TransformComponent{node}, mesh, material);
+        }
+      }
+    }
+
     app->controller = std::make_shared<Peridot::PerspectiveCameraController>(
         1.0f, 2.0f, 3.0f);
 
@@ -112,6 +147,21 @@ struct App {
         app->controller->MoveWithCursor(prevX, prevY, newX, newY);
       });
     }
+    // left click logs the entity under the cursor
+    app->input->RegisterMouseCallback(
+        Peridot::MouseCode::ButtonLeft,
+        [app, wasPressed = false](Peridot::ButtonState state) mutable {
+          bool pressed = state == Peridot::ButtonState::Pressed;
+          if (pressed && !wasPressed) {
+            auto [x, y] = app->input->GetCurrentCursorPos();
+            auto entity = app->renderer->Pick(
+                app->world, app->controller->GetCamera(), x, y);
+            if (entity.IsValid()) {
+              spdlog::info("picked entity {}", entity.index);
+            }
+          }
+          wasPressed = pressed;
+        });
     return app;
   }
 
@@ -121,14 +171,16 @@ struct App {
     controller->SetDelta(delta);
     controller->GetCamera().SetAspectRatio(ctx->GetAspectRatio());
 
-    shader->Bind();
-    shader->SetUniform<glm::mat4>(
-        "uMVP", controller->GetCamera().GetProjectionMatrix() *
-                    controller->GetCamera().GetViewMatrix());
-
-    vertexArray->Bind();
-
-    Peridot::RenderCall::DrawElements(indices.size());
+    world.Each<const Peridot::TransformComponent, const Spin>(
+        [this, delta](Peridot::Entity,
+                      const Peridot::TransformComponent& transform,
+                      const Spin& spin) {
+          auto rotation = transforms.GetRotation(transform.node);
+          rotation.y += spin.speed * delta;
+          transforms.SetRotation(transform.node, rotation);
+        });
+    Peridot::UpdateWorldTransforms(world, transforms);
+    renderer->RenderScene(world, controller->GetCamera());
     input->PollAndInvokeCallbacks();
   }
 
@@ -155,8 +207,9 @@ struct App {
 
                                    1, 5, 6, 1, 2, 6};
 
-  std::shared_ptr<Peridot::VertexArray> vertexArray;
-  std::shared_ptr<Peridot::Shader> shader;
+  Peridot::World world;
+  Peridot::TransformHierarchy transforms;
+  std::shared_ptr<Peridot::Renderer> renderer;
   std::shared_ptr<Peridot::PollModeInput> input;
 };
 
@@ -0,0 +1,39 @@
+#include <glm/glm.hpp>
+#include <gtest/gtest.h>
+
+#include <Peridot/Bvh.h>
+
+namespace {
+
+Peridot::Bvh MakeUnitBox() {
+  Peridot::Bvh bvh;
+  bvh.Insert({glm::vec3(0.0f), glm::vec3(1.0f)}, 7);
+  return bvh;
+}
+
+}  // namespace
+
+TEST(BvhRaycast, HitsAlongAFacePlane) {
+  auto bvh = MakeUnitBox();
+  // parallel to x and y with the origin on the box's min planes, where an
+  // infinite inverse direction times zero used to make NaN
+  Peridot::Ray ray{glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+  auto hit = bvh.Raycast(ray);
+  ASSERT_TRUE(hit.hit);
+  EXPECT_EQ(hit.userData, 7u);
+  EXPECT_FLOAT_EQ(hit.distance, 4.0f);
+}
+
+TEST(BvhRaycast, MissesOutsideAParallelSlab) {
+  auto bvh = MakeUnitBox();
+  Peridot::Ray ray{glm::vec3(2.0f, 0.5f, 5.0f), glm::vec3(0.0f, 0.0f, -1.0f)};
+  EXPECT_FALSE(bvh.Raycast(ray).hit);
+}
+
+TEST(BvhRaycast, StartsInsideTheBox) {
+  auto bvh = MakeUnitBox();
+  Peridot::Ray ray{glm::vec3(0.5f), glm::vec3(1.0f, 0.0f, 0.0f)};
+  auto hit = bvh.Raycast(ray);
+  ASSERT_TRUE(hit.hit);
+  EXPECT_FLOAT_EQ(hit.distance, 0.0f);
+}
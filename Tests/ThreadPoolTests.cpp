@@ -0,0 +1,52 @@
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <Peridot/ThreadPool.h>
+
+TEST(ThreadPool, CoversEveryIndexOnce) {
+  Peridot::ThreadPool pool(3);
+  std::vector<std::atomic<int>> hits(1000);
+  pool.ParallelFor(hits.size(), 7, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      hits[i].fetch_add(1);
+    }
+  });
+  for (const auto& hit : hits) {
+    EXPECT_EQ(hit.load(), 1);
+  }
+}
+
+// every batch of the outer loop runs a whole loop of its own, which has to
+// run inline on whichever thread picked the batch up, the caller included
+TEST(ThreadPool, NestedParallelForCompletes) {
+  Peridot::ThreadPool pool(3);
+  constexpr size_t kCount = 64;
+  for (int round = 0; round < 100; round++) {
+    std::atomic<size_t> total{0};
+    pool.ParallelFor(kCount, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        pool.ParallelFor(kCount, 4, [&](size_t innerBegin, size_t innerEnd) {
+          total.fetch_add(innerEnd - innerBegin);
+        });
+      }
+    });
+    ASSERT_EQ(total.load(), kCount * kCount);
+  }
+}
+
+// Back to back loops with changing sizes, so workers waking up late for a
+// loop the caller already finished meet the next one being set up.
+TEST(ThreadPool, BackToBackLoopsWithChangingBatches) {
+  Peridot::ThreadPool pool(7);
+  for (size_t round = 0; round < 20000; round++) {
+    const size_t count = 2 + round % 37;
+    std::atomic<size_t> total{0};
+    pool.ParallelFor(count, 1 + round % 5, [&](size_t begin, size_t end) {
+      total.fetch_add(end - begin);
+    });
+    ASSERT_EQ(total.load(), count);
+  }
+}
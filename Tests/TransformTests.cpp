@@ -0,0 +1,132 @@
+#include <glm/glm.hpp>
+#include <gtest/gtest.h>
+
+#include <Peridot/Components.h>
+#include <Peridot/Ecs.h>
+#include <Peridot/TransformHierarchy.h>
+
+namespace {
+
+glm::mat4 Translation(const float x) {
+  glm::mat4 matrix(1.0f);
+  matrix[3] = glm::vec4(x, 0.0f, 0.0f, 1.0f);
+  return matrix;
+}
+
+}  // namespace
+
+TEST(UpdateWorldTransforms, CopiesMovedNodes) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto node = hierarchy.Create();
+  auto entity = world.Create(Peridot::TransformComponent{node});
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  hierarchy.SetPosition(node, glm::vec3(3.0f, 0.0f, 0.0f));
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(world.Get<Peridot::TransformComponent>(entity)->world,
+            Translation(3.0f));
+}
+
+// systems like the GPU batches only revisit chunks stamped after their tick
+TEST(UpdateWorldTransforms, StampsOnlyChangedChunks) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto node = hierarchy.Create();
+  world.Create(Peridot::TransformComponent{node});
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  auto countChanged = [&world](const uint64_t tick) {
+    size_t chunks = 0;
+    world.EachChangedChunk<const Peridot::TransformComponent>(
+        tick, [&chunks](const Peridot::Entity*, size_t,
+                        const Peridot::TransformComponent*) { chunks++; });
+    return chunks;
+  };
+  auto tick = world.AdvanceChangeTick();
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(countChanged(tick), 0u);
+
+  hierarchy.SetPosition(node, glm::vec3(1.0f, 0.0f, 0.0f));
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(countChanged(tick), 1u);
+}
+
+// attached after the node's last change, the node won't report an update
+TEST(UpdateWorldTransforms, CopiesIntoLateComponents) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto node = hierarchy.Create();
+  hierarchy.SetPosition(node, glm::vec3(2.0f, 0.0f, 0.0f));
+  world.Create(Peridot::TransformComponent{node});
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  auto late = world.Create(Peridot::TransformComponent{node});
+  auto added = world.Create();
+  world.Add<Peridot::TransformComponent>(added).node = node;
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(world.Get<Peridot::TransformComponent>(late)->world,
+            Translation(2.0f));
+  EXPECT_EQ(world.Get<Peridot::TransformComponent>(added)->world,
+            Translation(2.0f));
+}
+
+TEST(UpdateWorldTransforms, CopiesIntoEveryEntityOfASharedNode) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto node = hierarchy.Create();
+  auto first = world.Create(Peridot::TransformComponent{node});
+  auto second = world.Create(Peridot::TransformComponent{node});
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  hierarchy.SetPosition(node, glm::vec3(5.0f, 0.0f, 0.0f));
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(world.Get<Peridot::TransformComponent>(first)->world,
+            Translation(5.0f));
+  EXPECT_EQ(world.Get<Peridot::TransformComponent>(second)->world,
+            Translation(5.0f));
+}
+
+TEST(UpdateWorldTransforms, SkipsUnchangedNodes) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto node = hierarchy.Create();
+  auto entity = world.Create(Peridot::TransformComponent{node});
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  // only a copy would overwrite it
+  world.Get<Peridot::TransformComponent>(entity)->world = Translation(9.0f);
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(world.Get<Peridot::TransformComponent>(entity)->world,
+            Translation(9.0f));
+}
+
+TEST(UpdateWorldTransforms, CopiesAfterRetargetingAStaleComponent) {
+  Peridot::TransformHierarchy hierarchy;
+  Peridot::World world;
+  auto first = hierarchy.Create();
+  auto second = hierarchy.Create();
+  hierarchy.SetPosition(second, glm::vec3(4.0f, 0.0f, 0.0f));
+  auto entity = world.Create(Peridot::TransformComponent{first});
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+
+  auto* transform = world.Get<Peridot::TransformComponent>(entity);
+  transform->node = second;
+  transform->stale = true;
+  Peridot::UpdateWorldTransforms(world, hierarchy);
+  EXPECT_EQ(transform->world, Translation(4.0f));
+}
+
+TEST(TransformHierarchy, DestroyIgnoresInvalidNodes) {
+  Peridot::TransformHierarchy hierarchy;
+  auto root = hierarchy.Create();
+  auto child = hierarchy.Create(root);
+  hierarchy.Destroy(root);
+  EXPECT_FALSE(hierarchy.IsValid(root));
+  EXPECT_FALSE(hierarchy.IsValid(child));
+
+  hierarchy.Destroy(root);
+  hierarchy.Destroy(Peridot::TransformHierarchy::kNullNode);
+  hierarchy.Destroy(1000);
+  EXPECT_EQ(hierarchy.GetNodeCount(), 0u);
+}
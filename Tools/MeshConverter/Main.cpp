@@ -0,0 +1,29 @@
+#include <Peridot/MeshFile.h>
+#include <Peridot/MeshLoader.h>
+#include <Peridot/MeshOptimizer.h>
+
+#include <spdlog/spdlog.h>
+
+// Converts OBJ and binary glTF meshes into .pmesh files offline, so the
+// runtime only has to map them. A LOD chain is generated and every LOD is
+// optimized for the vertex cache, overdraw and vertex fetch on the way.
+// Needs no window or GL context.
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    spdlog::error("usage: {} <input.obj|input.glb> <output.pmesh>", argv[0]);
+    return 1;
+  }
+
+  Peridot::MeshData meshData;
+  if (!Peridot::LoadMeshData(argv[1], meshData)) {
+    return 1;
+  }
+  Peridot::GenerateLods(meshData);
+  Peridot::OptimizeMesh(meshData);
+  if (!Peridot::WriteMeshFile(argv[2], meshData)) {
+    return 1;
+  }
+  spdlog::info("wrote {}: {} vertices, {} triangles", argv[2],
+               meshData.vertices.size(), meshData.indices.size() / 3);
+  return 0;
+}